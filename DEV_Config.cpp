@@ -1,4 +1,110 @@
 #include "DEV_Config.h"
+#include "driver/spi_master.h"
+#include "esp_attr.h"
+#include "esp_task_wdt.h"
+
+// Each bus carries two handles, one per clock profile: register/command
+// traffic stays on the conservative clock, DTM pixel blocks use the bulk one.
+// In EPD_DUAL_BUS builds the slave controller gets its own bus (HSPI).
+#ifdef EPD_DUAL_BUS
+  #define DEV_SPI_BUS_COUNT 2
+#else
+  #define DEV_SPI_BUS_COUNT 1
+#endif
+
+typedef struct {
+  spi_host_device_t host;
+  int sck_pin;
+  int mosi_pin;
+  spi_device_handle_t cmd_dev;
+  spi_device_handle_t bulk_dev;
+  spi_transaction_t block_trans[2];
+  UBYTE block_active;   // Block currently being filled
+  UDOUBLE block_len;
+  UBYTE in_flight;      // Blocks queued but not yet reaped
+} DEV_SPI_Bus;
+
+static DEV_SPI_Bus spi_bus[DEV_SPI_BUS_COUNT] = {
+  { SPI3_HOST, EPD_SCK_PIN, EPD_MOSI_PIN, NULL, NULL, {}, 0, 0, 0 },
+#ifdef EPD_DUAL_BUS
+  { SPI2_HOST, EPD_S_SCK_PIN, EPD_S_MOSI_PIN, NULL, NULL, {}, 0, 0, 0 },
+#endif
+};
+
+static UDOUBLE spi_cmd_hz = SPI_CMD_SPEED_HZ;
+static UDOUBLE spi_bulk_hz = SPI_BULK_SPEED_HZ;
+static UBYTE spi_target = DEV_BUS_ALL;
+static bool spi_ready = false;  // Buses initialised by DEV_Module_Init
+
+// Ping-pong staging blocks for the bulk path, two per bus. One is filled by
+// the CPU while the other is on the wire. Must live in internal RAM and be
+// word aligned, otherwise the SPI driver bounces them through a malloc'd copy.
+WORD_ALIGNED_ATTR DMA_ATTR static UBYTE spi_block[DEV_SPI_BUS_COUNT][2][SPI_DMA_BLOCK_SIZE];
+
+static DEV_SPI_Stats spi_stats = {0, 0};
+
+#ifdef DEV_TRACE_ENABLED
+// Bus events go to the recorder in DEV_Trace.cpp
+void DEV_Digital_Write(UWORD pin, UBYTE val)
+{
+  digitalWrite(pin, val);
+  if (pin == EPD_CS_M_PIN || pin == EPD_CS_S_PIN || pin == EPD_DC_PIN || pin == EPD_RST_PIN) {
+    DEV_TRACE(DEV_TRACE_GPIO, (UBYTE)(pin | (val ? 0x80 : 0)), 0, NULL);
+  }
+}
+#endif
+
+// Chip selects are driven by hand: the driver needs CS_M and CS_S together
+static esp_err_t DEV_SPI_AddDevice(spi_host_device_t host, UDOUBLE hz, int queue_size,
+                                   spi_device_handle_t *dev)
+{
+  spi_device_interface_config_t dev_cfg = {};
+  dev_cfg.clock_speed_hz = hz;
+  dev_cfg.mode = 0;
+  dev_cfg.spics_io_num = -1;
+  dev_cfg.queue_size = queue_size;
+  return spi_bus_add_device(host, &dev_cfg, dev);
+}
+
+static esp_err_t DEV_SPI_AddDevices(DEV_SPI_Bus *bus)
+{
+  esp_err_t err = DEV_SPI_AddDevice(bus->host, spi_cmd_hz, 1, &bus->cmd_dev);
+  if (err != ESP_OK) return err;
+  err = DEV_SPI_AddDevice(bus->host, spi_bulk_hz, 2, &bus->bulk_dev);
+  if (err != ESP_OK) {
+    spi_bus_remove_device(bus->cmd_dev);
+    bus->cmd_dev = NULL;
+  }
+  return err;
+}
+
+// Also safe on a bus whose re-add failed half way
+static void DEV_SPI_RemoveDevices(DEV_SPI_Bus *bus)
+{
+  if (bus->bulk_dev) spi_bus_remove_device(bus->bulk_dev);
+  if (bus->cmd_dev) spi_bus_remove_device(bus->cmd_dev);
+  bus->bulk_dev = NULL;
+  bus->cmd_dev = NULL;
+}
+
+static esp_err_t DEV_SPI_BusInit(DEV_SPI_Bus *bus)
+{
+  spi_bus_config_t bus_cfg = {};
+  bus_cfg.mosi_io_num = bus->mosi_pin;
+  bus_cfg.miso_io_num = -1;
+  bus_cfg.sclk_io_num = bus->sck_pin;
+  bus_cfg.quadwp_io_num = -1;
+  bus_cfg.quadhd_io_num = -1;
+  bus_cfg.max_transfer_sz = SPI_DMA_BLOCK_SIZE;
+  esp_err_t err = spi_bus_initialize(bus->host, &bus_cfg, SPI_DMA_CH_AUTO);
+  if (err != ESP_OK) return err;
+
+  err = DEV_SPI_AddDevices(bus);
+  if (err != ESP_OK) {
+    spi_bus_free(bus->host);
+  }
+  return err;
+}
 
 int DEV_Module_Init(void)
 {
@@ -14,33 +120,235 @@ int DEV_Module_Init(void)
     DEV_Digital_Write(EPD_PWR_PIN, HIGH); // HAT rev 2.3
   #endif
 
-  // SPI matériel (VSPI)
-  #ifdef EPD_MISO_PIN
-    SPI.begin(EPD_SCK_PIN, EPD_MISO_PIN, EPD_MOSI_PIN);
-  #else
-    SPI.begin(EPD_SCK_PIN, -1,            EPD_MOSI_PIN);
-  #endif
-  SPI.beginTransaction(SPISettings(SPI_SPEED_HZ, MSBFIRST, SPI_MODE0));
+  // SPI matériel (VSPI, + HSPI en mode double bus) via le driver IDF pour le DMA
+  for (int b = 0; b < DEV_SPI_BUS_COUNT; b++) {
+    if (DEV_SPI_BusInit(&spi_bus[b]) != ESP_OK) {
+      while (--b >= 0) {
+        DEV_SPI_RemoveDevices(&spi_bus[b]);
+        spi_bus_free(spi_bus[b].host);
+      }
+      return -1;
+    }
+  }
+  spi_ready = true;
   return 0;
 }
 
 void DEV_Module_Exit(void)
 {
-  SPI.endTransaction();
-  SPI.end();
+  DEV_SPI_Bulk_Flush();
+  if (spi_ready) {
+    for (int b = 0; b < DEV_SPI_BUS_COUNT; b++) {
+      DEV_SPI_RemoveDevices(&spi_bus[b]);
+      spi_bus_free(spi_bus[b].host);
+    }
+    spi_ready = false;
+  }
   DEV_Digital_Write(EPD_CS_M_PIN, HIGH);
   DEV_Digital_Write(EPD_CS_S_PIN, HIGH);
 }
 
+// Re-add every bus's devices at the current spi_cmd_hz/spi_bulk_hz
+static bool DEV_SPI_ReAddDevices(void)
+{
+  bool ok = true;
+  for (int b = 0; b < DEV_SPI_BUS_COUNT; b++) {
+    DEV_SPI_RemoveDevices(&spi_bus[b]);
+    if (DEV_SPI_AddDevices(&spi_bus[b]) != ESP_OK) ok = false;
+  }
+  return ok;
+}
+
+bool DEV_SPI_SetClockProfile(UDOUBLE cmd_hz, UDOUBLE bulk_hz)
+{
+  UDOUBLE prev_cmd_hz = spi_cmd_hz;
+  UDOUBLE prev_bulk_hz = spi_bulk_hz;
+  spi_cmd_hz = constrain(cmd_hz, (UDOUBLE)SPI_MIN_SPEED_HZ, (UDOUBLE)SPI_MAX_SPEED_HZ);
+  spi_bulk_hz = constrain(bulk_hz, (UDOUBLE)SPI_MIN_SPEED_HZ, (UDOUBLE)SPI_MAX_SPEED_HZ);
+
+  // Before DEV_Module_Init the values are simply picked up by AddDevices
+  if (!spi_ready) return true;
+  DEV_SPI_Bulk_Flush();
+  if (DEV_SPI_ReAddDevices()) {
+    DEV_TRACE(DEV_TRACE_CLOCK, 0, (UWORD)(spi_cmd_hz / 1000), NULL);
+    DEV_TRACE(DEV_TRACE_CLOCK, 1, (UWORD)(spi_bulk_hz / 1000), NULL);
+    return true;
+  }
+
+  // A bus left without devices would drop every later write: go back to
+  // the clocks that were working
+  spi_cmd_hz = prev_cmd_hz;
+  spi_bulk_hz = prev_bulk_hz;
+  DEV_SPI_ReAddDevices();
+  return false;
+}
+
+// Long panel operations (BUSY waits, frame pushes) must keep feeding the task WDT.
+// Helper tasks that are not subscribed (frame receiver) may call it too.
+void DEV_Watchdog_Reset(void)
+{
+  if (esp_task_wdt_status(NULL) == ESP_OK) {
+    esp_task_wdt_reset();
+  }
+}
+
 // ========== SPI low-level utilisés par le driver ==========
+
+// Buses addressed by the current target; a single-bus build sends everything
+// once on VSPI and lets the chip selects pick the controller(s)
+static UBYTE DEV_SPI_TargetBuses(void)
+{
+#ifdef EPD_DUAL_BUS
+  return spi_target;
+#else
+  return 0x01;
+#endif
+}
+
+static DEV_SPI_Bus *DEV_SPI_BusFor(UBYTE target)
+{
+#ifdef EPD_DUAL_BUS
+  return (target & DEV_BUS_M) ? &spi_bus[0] : &spi_bus[1];
+#else
+  (void)target;
+  return &spi_bus[0];
+#endif
+}
+
+void DEV_SPI_SetTarget(UBYTE target)
+{
+  DEV_SPI_Bulk_Flush();
+  spi_target = target & DEV_BUS_ALL;
+}
+
+static void DEV_SPI_ReapOne(DEV_SPI_Bus *bus)
+{
+  spi_transaction_t *done;
+  spi_device_get_trans_result(bus->bulk_dev, &done, portMAX_DELAY);
+  bus->in_flight--;
+}
+
+// Queue the active block for DMA and switch to the other one
+static void DEV_SPI_QueueBlock(DEV_SPI_Bus *bus)
+{
+  if (bus->block_len == 0) return;
+
+  UBYTE *block = spi_block[bus - spi_bus][bus->block_active];
+  spi_transaction_t *t = &bus->block_trans[bus->block_active];
+  memset(t, 0, sizeof(*t));
+  t->length = bus->block_len * 8;
+  t->tx_buffer = block;
+  DEV_TRACE(DEV_TRACE_DATA, (UBYTE)((bus - spi_bus) | DEV_TRACE_BULK), bus->block_len, block);
+  spi_device_queue_trans(bus->bulk_dev, t, portMAX_DELAY);
+  spi_stats.transactions++;
+  spi_stats.bytes += bus->block_len;
+  bus->in_flight++;
+
+  bus->block_active ^= 1;
+  bus->block_len = 0;
+
+  // The block we switched to may still be on the wire (queued two rounds ago)
+  if (bus->in_flight == 2) {
+    DEV_SPI_ReapOne(bus);
+  }
+}
+
+UBYTE *DEV_SPI_Bulk_ReserveOn(UBYTE target, UDOUBLE len)
+{
+  DEV_SPI_Bus *bus = DEV_SPI_BusFor(target);
+  if (len > SPI_DMA_BLOCK_SIZE) return NULL;
+  if (bus->block_len + len > SPI_DMA_BLOCK_SIZE) {
+    DEV_SPI_QueueBlock(bus);
+  }
+  return spi_block[bus - spi_bus][bus->block_active] + bus->block_len;
+}
+
+void DEV_SPI_Bulk_CommitOn(UBYTE target, UDOUBLE len)
+{
+  DEV_SPI_Bus *bus = DEV_SPI_BusFor(target);
+  bus->block_len += len;
+  if (bus->block_len == SPI_DMA_BLOCK_SIZE) {
+    DEV_SPI_QueueBlock(bus);
+  }
+}
+
+void DEV_SPI_Bulk_Flush(void)
+{
+  for (int b = 0; b < DEV_SPI_BUS_COUNT; b++) {
+    DEV_SPI_QueueBlock(&spi_bus[b]);
+  }
+  for (int b = 0; b < DEV_SPI_BUS_COUNT; b++) {
+    while (spi_bus[b].in_flight > 0) {
+      DEV_SPI_ReapOne(&spi_bus[b]);
+    }
+  }
+}
+
+void DEV_SPI_Bulk_Write(const UBYTE *data, UDOUBLE len)
+{
+  UBYTE buses = DEV_SPI_TargetBuses();
+  for (int b = 0; b < DEV_SPI_BUS_COUNT; b++) {
+    if (!(buses & (1 << b))) continue;
+    UBYTE target = (UBYTE)(1 << b);
+    const UBYTE *src = data;
+    UDOUBLE remaining = len;
+    while (remaining > 0) {
+      UDOUBLE chunk = SPI_DMA_BLOCK_SIZE - DEV_SPI_BusFor(target)->block_len;
+      if (chunk > remaining) chunk = remaining;
+      memcpy(DEV_SPI_Bulk_ReserveOn(target, chunk), src, chunk);
+      DEV_SPI_Bulk_CommitOn(target, chunk);
+      src += chunk;
+      remaining -= chunk;
+    }
+  }
+}
+
+// Register payloads are traced per bus, like the DMA blocks
+static void DEV_SPI_Poll(spi_transaction_t *t, UDOUBLE len, bool payload)
+{
+  UBYTE buses = DEV_SPI_TargetBuses();
+  for (int b = 0; b < DEV_SPI_BUS_COUNT; b++) {
+    if (!(buses & (1 << b))) continue;
+    if (payload) {
+      DEV_TRACE(DEV_TRACE_DATA, (UBYTE)b, len, (const UBYTE *)t->tx_buffer);
+    }
+    spi_device_polling_transmit(spi_bus[b].cmd_dev, t);
+    spi_stats.transactions++;
+    spi_stats.bytes += len;
+  }
+}
+
 void DEV_SPI_WriteByte(UBYTE data)
 {
-  SPI.transfer(data);
+  DEV_SPI_Bulk_Flush();  // Polling and queued transfers must not interleave
+
+  spi_transaction_t t = {};
+  t.flags = SPI_TRANS_USE_TXDATA;
+  t.length = 8;
+  t.tx_data[0] = data;
+  DEV_TRACE(DEV_TRACE_CMD, data, 1, &data);
+  DEV_SPI_Poll(&t, 1, false);
 }
 
+// Register payloads: short, so sent on the command clock without staging
 void DEV_SPI_Write_nByte(UBYTE *data, UDOUBLE len)
 {
-  while (len--) {
-    SPI.transfer(*data++);
-  }
+  if (len == 0) return;
+  DEV_SPI_Bulk_Flush();
+
+  spi_transaction_t t = {};
+  t.length = len * 8;
+  t.tx_buffer = data;
+  DEV_SPI_Poll(&t, len, true);
+}
+
+void DEV_SPI_ResetStats(void)
+{
+  spi_stats.transactions = 0;
+  spi_stats.bytes = 0;
+}
+
+DEV_SPI_Stats DEV_SPI_GetStats(void)
+{
+  return spi_stats;
 }
\ No newline at end of file
@@ -11,8 +11,19 @@
  */
 
 #pragma once
-#include <Arduino.h>
-#include <SPI.h>
+#ifdef DEV_HOST
+  // Host build (CMakeLists.txt): same interface, implemented in host/DEV_Host.cpp
+  #include <stdint.h>
+  #include <stddef.h>
+  #include <stdio.h>
+  #include <stdlib.h>
+  #include <string.h>
+  #include <algorithm>
+  using std::min;
+  using std::max;
+#else
+  #include <Arduino.h>
+#endif
 
 // Data type definitions
 typedef uint8_t  UBYTE;
@@ -21,6 +32,11 @@ typedef uint32_t UDOUBLE;
 
 // SPI Configuration
 #define SPI_SPEED_HZ    10000000  // 10MHz - tested stable with long cables
+#define SPI_CMD_SPEED_HZ   SPI_SPEED_HZ  // Default clock for commands and registers
+#define SPI_BULK_SPEED_HZ  SPI_SPEED_HZ  // Default clock for DTM pixel data (raise for short cables)
+#define SPI_MIN_SPEED_HZ    1000000
+#define SPI_MAX_SPEED_HZ   40000000      // GPIO matrix limit (SCK/MOSI are not VSPI IOMUX pins)
+#define SPI_DMA_BLOCK_SIZE  2400  // DMA staging block (x2): 8 panel lines of 300 bytes
 
 // Hardware SPI pins (HUZZAH32 Feather)
 #define EPD_SCK_PIN      5    // Hardware SCK
@@ -36,13 +52,118 @@ typedef uint32_t UDOUBLE;
 // Optional power control - can be tied to VCC for always-on operation
 #define EPD_PWR_PIN     21    // Power control (GPIO21)
 
-// Hardware abstraction macros
-#define DEV_Digital_Write(pin, val) digitalWrite((pin), (val))
-#define DEV_Digital_Read(_pin) digitalRead(_pin)
-#define DEV_Delay_ms(__xms) delay(__xms)
+// Optional dual-bus mode: the slave controller on its own SPI host (HSPI) so
+// both halves stream at once. The HAT shares SCK/DIN between controllers, so
+// this needs the slave's SCK/DIN wired separately to the pins below.
+// #define EPD_DUAL_BUS
+#ifdef EPD_DUAL_BUS
+  #define EPD_S_SCK_PIN   26  // Slave SCK (GPIO26 / A0)
+  #define EPD_S_MOSI_PIN  25  // Slave MOSI (GPIO25 / A1)
+#endif
+
+// Uncomment to record every bus event (CS/DC/RST edges, command bytes, data
+// blocks, clock changes) into an 8 KB RAM trace that can be dumped over
+// Serial. Host builds always record it (CMakeLists.txt).
+// #define DEV_TRACE_ENABLED
+
+// Hardware abstraction macros (functions in host builds)
+#if defined(DEV_TRACE_ENABLED) || defined(DEV_HOST)
+  void DEV_Digital_Write(UWORD pin, UBYTE val);
+#else
+  #define DEV_Digital_Write(pin, val) digitalWrite((pin), (val))
+#endif
+#ifdef DEV_HOST
+  UBYTE DEV_Digital_Read(UWORD pin);
+  void DEV_Delay_ms(UDOUBLE ms);
+  UDOUBLE DEV_Time_ms(void);
+  UDOUBLE DEV_Time_us(void);
+#else
+  #define DEV_Digital_Read(_pin) digitalRead(_pin)
+  #define DEV_Delay_ms(__xms) delay(__xms)
+  #define DEV_Time_ms() millis()
+  #define DEV_Time_us() micros()
+#endif
+
+// Bus targets: which controller(s) the next command/data bytes are for
+#define DEV_BUS_M    0x01
+#define DEV_BUS_S    0x02
+#define DEV_BUS_ALL  (DEV_BUS_M | DEV_BUS_S)
+
+// Bus statistics (reset before a frame push, read back for throughput logs)
+typedef struct {
+  UDOUBLE transactions;  // DMA/polling transactions queued on the bus
+  UDOUBLE bytes;         // Payload bytes clocked out
+} DEV_SPI_Stats;
 
 // Function declarations
 int DEV_Module_Init(void);
 void DEV_Module_Exit(void);
+void DEV_Watchdog_Reset(void);
 void DEV_SPI_Write_nByte(UBYTE* pData, uint32_t len);
-void DEV_SPI_WriteByte(UBYTE data);
\ No newline at end of file
+void DEV_SPI_WriteByte(UBYTE data);
+
+// Bulk path: stages data into ping-pong DMA blocks and queues each block
+// asynchronously once full. DEV_SPI_Bulk_Flush() is the fence: it queues the
+// partial block and waits for the bus to drain. Call it before toggling CS.
+void DEV_SPI_Bulk_Write(const UBYTE* pData, uint32_t len);
+void DEV_SPI_Bulk_Flush(void);
+
+// Route subsequent writes to DEV_BUS_M/S/ALL. Single-bus builds send once on
+// VSPI regardless (CS does the selection); dual-bus builds pick the host(s).
+void DEV_SPI_SetTarget(UBYTE target);
+UBYTE* DEV_SPI_Bulk_ReserveOn(UBYTE target, uint32_t len);  // Zero-copy slot on one bus, len <= SPI_DMA_BLOCK_SIZE
+void DEV_SPI_Bulk_CommitOn(UBYTE target, uint32_t len);
+
+// Clock profiles: command/register writes and pixel bulk run at separate
+// rates. Safe to call before or after DEV_Module_Init (bus must be idle).
+// False if the SPI driver refused the new clocks; the previous ones stay.
+bool DEV_SPI_SetClockProfile(uint32_t cmd_hz, uint32_t bulk_hz);
+
+void DEV_SPI_ResetStats(void);
+DEV_SPI_Stats DEV_SPI_GetStats(void);
+
+// Bus trace: fixed-size little-endian records, header first. Timestamps are
+// microseconds since DEV_Trace_Begin(). The data CRC32 covers every payload
+// byte in order, so two traces of the same frame match byte for byte.
+#define DEV_TRACE_MAGIC       "EPDT"
+#define DEV_TRACE_MAX_EVENTS  1024
+#define DEV_TRACE_VERSION     2
+#define DEV_TRACE_BULK        0x80  // DATA sent on the bulk (pixel) clock
+
+enum {
+  DEV_TRACE_GPIO  = 1,  // value = pin | (level << 7)
+  DEV_TRACE_CMD   = 2,  // value = command byte
+  DEV_TRACE_DATA  = 3,  // value = bus index | DEV_TRACE_BULK, len = payload bytes in one transaction
+  DEV_TRACE_CLOCK = 4   // value = 0 command / 1 bulk clock, len = new rate in kHz
+};
+
+typedef struct __attribute__((packed)) {
+  uint32_t t_us;
+  UBYTE    type;
+  UBYTE    value;
+  UWORD    len;
+} DEV_TraceEvent;
+
+typedef struct __attribute__((packed)) {
+  char     magic[4];   // DEV_TRACE_MAGIC
+  UWORD    version;
+  UWORD    count;      // Events stored
+  UDOUBLE  dropped;    // Events lost once the buffer was full
+  UDOUBLE  data_crc;   // CRC32 of all DATA/CMD payload bytes
+} DEV_TraceHeader;
+
+#ifdef DEV_TRACE_ENABLED
+  void DEV_Trace_Begin(void);
+  void DEV_Trace_End(void);    // Stops recording and prints a summary
+  void DEV_Trace_Dump(void);   // Header + events as "TRACE <hex>" lines
+  // Events recorded so far (header->count of them); NULL before the first Begin
+  const DEV_TraceEvent* DEV_Trace_Get(DEV_TraceHeader* header);
+  // For the DEV layer implementations (DEV_Config.cpp, host/DEV_Host.cpp)
+  void DEV_Trace_Record(UBYTE type, UBYTE value, UWORD len, const UBYTE* data);
+  #define DEV_TRACE(type, value, len, data) DEV_Trace_Record(type, value, len, data)
+#else
+  #define DEV_Trace_Begin()
+  #define DEV_Trace_End()
+  #define DEV_Trace_Dump()
+  #define DEV_TRACE(type, value, len, data)
+#endif
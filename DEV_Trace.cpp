@@ -0,0 +1,106 @@
+/**
+ * Bus Trace Recorder
+ *
+ * Shared by DEV_Config.cpp and the host layer (host/DEV_Host.cpp): both
+ * report their bus events through DEV_Trace_Record(), so a host run and a
+ * device run of the same panel operation produce comparable traces.
+ *
+ * @author Stephane Bhiri
+ * @version 2.0
+ * @date January 2025
+ */
+
+#include "DEV_Config.h"
+
+#ifdef DEV_TRACE_ENABLED
+#include "esp_rom_crc.h"
+#include <inttypes.h>
+
+static DEV_TraceEvent *trace_events = NULL;
+static DEV_TraceHeader trace_header;
+static uint32_t trace_start_us = 0;
+static bool trace_active = false;
+
+void DEV_Trace_Record(UBYTE type, UBYTE value, UWORD len, const UBYTE *data)
+{
+  if (!trace_active) return;
+  if (data) {
+    trace_header.data_crc = esp_rom_crc32_le(trace_header.data_crc, data, len);
+  }
+  if (trace_header.count >= DEV_TRACE_MAX_EVENTS) {
+    trace_header.dropped++;
+    return;
+  }
+  DEV_TraceEvent *e = &trace_events[trace_header.count++];
+  e->t_us = DEV_Time_us() - trace_start_us;
+  e->type = type;
+  e->value = value;
+  e->len = len;
+}
+
+void DEV_Trace_Begin(void)
+{
+  if (!trace_events) {
+    trace_events = (DEV_TraceEvent *)malloc(DEV_TRACE_MAX_EVENTS * sizeof(DEV_TraceEvent));
+    if (!trace_events) return;
+  }
+  memcpy(trace_header.magic, DEV_TRACE_MAGIC, 4);
+  trace_header.version = DEV_TRACE_VERSION;
+  trace_header.count = 0;
+  trace_header.dropped = 0;
+  trace_header.data_crc = 0;
+  trace_start_us = DEV_Time_us();
+  trace_active = true;
+}
+
+void DEV_Trace_End(void)
+{
+  if (!trace_active) return;
+  trace_active = false;
+
+  UDOUBLE bytes = 0, cs_selects = 0;
+  for (UWORD i = 0; i < trace_header.count; i++) {
+    const DEV_TraceEvent *e = &trace_events[i];
+    if (e->type == DEV_TRACE_DATA) bytes += e->len;
+    if (e->type == DEV_TRACE_CMD) bytes++;
+    UBYTE pin = e->value & 0x7F;
+    if (e->type == DEV_TRACE_GPIO && !(e->value & 0x80) &&
+        (pin == EPD_CS_M_PIN || pin == EPD_CS_S_PIN)) {
+      cs_selects++;
+    }
+  }
+  uint32_t elapsed_us = DEV_Time_us() - trace_start_us;
+  printf("Trace: %u events (%" PRIu32 " dropped), %" PRIu32 " bytes, %" PRIu32 " CS selects, "
+         "%" PRIu32 " us, %" PRIu32 " KB/s, crc %08" PRIx32 "\n",
+         trace_header.count, trace_header.dropped, bytes, cs_selects, elapsed_us,
+         elapsed_us ? (UDOUBLE)((uint64_t)bytes * 1000 / elapsed_us) : 0,
+         trace_header.data_crc);
+}
+
+const DEV_TraceEvent *DEV_Trace_Get(DEV_TraceHeader *header)
+{
+  *header = trace_header;
+  return trace_events;
+}
+
+static void DEV_Trace_DumpHex(const UBYTE *data, UDOUBLE len)
+{
+  while (len > 0) {
+    UDOUBLE chunk = len > 32 ? 32 : len;
+    printf("TRACE ");
+    for (UDOUBLE i = 0; i < chunk; i++) {
+      printf("%02x", data[i]);
+    }
+    printf("\n");
+    data += chunk;
+    len -= chunk;
+  }
+}
+
+void DEV_Trace_Dump(void)
+{
+  if (!trace_events) return;
+  DEV_Trace_DumpHex((const UBYTE *)&trace_header, sizeof(trace_header));
+  DEV_Trace_DumpHex((const UBYTE *)trace_events, trace_header.count * sizeof(DEV_TraceEvent));
+}
+#endif
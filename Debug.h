@@ -12,13 +12,21 @@
 #ifndef DEBUG_H
 #define DEBUG_H
 
-#include <Arduino.h>
+#ifdef DEV_HOST
+  #include <stdio.h>
+#else
+  #include <Arduino.h>
+#endif
 
 // Enable/disable debug output
 #define DEBUG_ENABLED
 
 #ifdef DEBUG_ENABLED
-  #define Debug(...) do { Serial.printf(__VA_ARGS__); } while(0)
+  #ifdef DEV_HOST
+    #define Debug(...) do { printf(__VA_ARGS__); } while(0)
+  #else
+    #define Debug(...) do { Serial.printf(__VA_ARGS__); } while(0)
+  #endif
 #else
   #define Debug(...)
 #endif
@@ -10,28 +10,87 @@
 
 #include "EPD_13in3e.h"
 #include "Debug.h"
-#include <WiFi.h>
-#include "esp_task_wdt.h"
 
 // SPI Configuration Constants
-const UBYTE PSR_V[2] = {0xDF, 0x69};
-const UBYTE PWR_V[6] = {0x0F, 0x00, 0x28, 0x2C, 0x28, 0x38};
-const UBYTE POF_V[1] = {0x00};
-const UBYTE DRF_V[1] = {0x00};
-const UBYTE CDI_V[1] = {0xF7};
-const UBYTE TCON_V[2] = {0x03, 0x03};
-const UBYTE TRES_V[4] = {0x04, 0xB0, 0x06, 0x40};  // 1200x1600 (was 1200x800)
-const UBYTE CMD66_V[6] = {0x49, 0x55, 0x13, 0x5D, 0x05, 0x10};
-const UBYTE EN_BUF_V[1] = {0x07};
-const UBYTE CCSET_V[1] = {0x01};
-const UBYTE PWS_V[1] = {0x22};
-const UBYTE AN_TM_V[9] = {0xC0, 0x1C, 0x1C, 0xCC, 0xCC, 0xCC, 0x15, 0x15, 0x55};
-const UBYTE AGID_V[1] = {0x10};
-const UBYTE BTST_P_V[2] = {0xE8, 0x28};
-const UBYTE BOOST_VDDP_EN_V[1] = {0x01};
-const UBYTE BTST_N_V[2] = {0xE8, 0x28};
-const UBYTE BUCK_BOOST_VDDN_V[1] = {0x01};
-const UBYTE TFT_VCOM_POWER_V[1] = {0x02};
+constexpr UBYTE PSR_V[2] = {0xDF, 0x69};
+constexpr UBYTE PWR_V[6] = {0x0F, 0x00, 0x28, 0x2C, 0x28, 0x38};
+constexpr UBYTE POF_V[1] = {0x00};
+constexpr UBYTE DRF_V[1] = {0x00};
+constexpr UBYTE CDI_V[1] = {0xF7};
+constexpr UBYTE TCON_V[2] = {0x03, 0x03};
+constexpr UBYTE TRES_V[4] = {0x04, 0xB0, 0x06, 0x40};  // 1200x1600 (was 1200x800)
+constexpr UBYTE CMD66_V[6] = {0x49, 0x55, 0x13, 0x5D, 0x05, 0x10};
+constexpr UBYTE EN_BUF_V[1] = {0x07};
+constexpr UBYTE CCSET_V[1] = {0x01};
+constexpr UBYTE PWS_V[1] = {0x22};
+constexpr UBYTE AN_TM_V[9] = {0xC0, 0x1C, 0x1C, 0xCC, 0xCC, 0xCC, 0x15, 0x15, 0x55};
+constexpr UBYTE AGID_V[1] = {0x10};
+constexpr UBYTE BTST_P_V[2] = {0xE8, 0x28};
+constexpr UBYTE BOOST_VDDP_EN_V[1] = {0x01};
+constexpr UBYTE BTST_N_V[2] = {0xE8, 0x28};
+constexpr UBYTE BUCK_BOOST_VDDN_V[1] = {0x01};
+constexpr UBYTE TFT_VCOM_POWER_V[1] = {0x02};
+
+// Init command table: register, payload and which controller(s) receive it.
+// The controllers frame each command with its own CS pulse (DC is not used),
+// so the replay engine issues one CS assert/deassert per entry.
+enum : UBYTE {
+    EPD_TARGET_M   = DEV_BUS_M,  // Master only (analog/booster block lives here)
+    EPD_TARGET_S   = DEV_BUS_S,
+    EPD_TARGET_ALL = DEV_BUS_ALL
+};
+
+struct EPD_13IN3E_Cmd {
+    UBYTE reg;
+    UBYTE target;
+    const UBYTE *data;
+    UBYTE len;
+};
+
+#define EPD_CMD(reg, target, values) { reg, target, values, sizeof(values) }
+
+static constexpr EPD_13IN3E_Cmd EPD_13IN3E_INIT_SEQ[] = {
+    EPD_CMD(AN_TM,           EPD_TARGET_M,   AN_TM_V),
+    EPD_CMD(CMD66,           EPD_TARGET_ALL, CMD66_V),
+    EPD_CMD(PSR,             EPD_TARGET_ALL, PSR_V),
+    EPD_CMD(CDI,             EPD_TARGET_ALL, CDI_V),
+    EPD_CMD(TCON,            EPD_TARGET_ALL, TCON_V),
+    EPD_CMD(AGID,            EPD_TARGET_ALL, AGID_V),
+    EPD_CMD(PWS,             EPD_TARGET_ALL, PWS_V),
+    EPD_CMD(CCSET,           EPD_TARGET_ALL, CCSET_V),
+    EPD_CMD(TRES,            EPD_TARGET_ALL, TRES_V),
+    EPD_CMD(PWR_epd,         EPD_TARGET_M,   PWR_V),
+    EPD_CMD(EN_BUF,          EPD_TARGET_M,   EN_BUF_V),
+    EPD_CMD(BTST_P,          EPD_TARGET_M,   BTST_P_V),
+    EPD_CMD(BOOST_VDDP_EN,   EPD_TARGET_M,   BOOST_VDDP_EN_V),
+    EPD_CMD(BTST_N,          EPD_TARGET_M,   BTST_N_V),
+    EPD_CMD(BUCK_BOOST_VDDN, EPD_TARGET_M,   BUCK_BOOST_VDDN_V),
+    EPD_CMD(TFT_VCOM_POWER,  EPD_TARGET_M,   TFT_VCOM_POWER_V),
+};
+
+static constexpr size_t EPD_13IN3E_INIT_COUNT =
+    sizeof(EPD_13IN3E_INIT_SEQ) / sizeof(EPD_13IN3E_INIT_SEQ[0]);
+
+// Every entry needs a payload and a valid target, and no register may be
+// programmed twice (a duplicate would silently override the earlier value)
+static constexpr bool EPD_13IN3E_SeqValid(const EPD_13IN3E_Cmd *seq, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        if (seq[i].data == nullptr || seq[i].len == 0) return false;
+        if (seq[i].target == 0 || (seq[i].target & ~EPD_TARGET_ALL)) return false;
+        for (size_t j = 0; j < i; j++) {
+            if (seq[j].reg == seq[i].reg) return false;
+        }
+    }
+    return true;
+}
+
+static_assert(EPD_13IN3E_SeqValid(EPD_13IN3E_INIT_SEQ, EPD_13IN3E_INIT_COUNT),
+              "EPD init table has an empty payload, bad target or duplicate register");
+static_assert(EPD_13IN3E_INIT_SEQ[0].reg == AN_TM && EPD_13IN3E_INIT_SEQ[0].target == EPD_TARGET_M,
+              "AN_TM must be the first command after reset, master only");
+static_assert(((TRES_V[0] << 8) | TRES_V[1]) == EPD_13IN3E_WIDTH &&
+              ((TRES_V[2] << 8) | TRES_V[3]) == EPD_13IN3E_HEIGHT,
+              "TRES payload does not match the panel resolution");
 
 // Ultra-light font table - Only essential characters for boot splash
 // 0-9 (10 chars) + A-Z (26 chars) + space, period, colon, dash, percent (5 chars) = 41 chars total
@@ -96,17 +155,37 @@ static int getEssentialCharIndex(char c) {
     return 36; // Default to space for unsupported characters
 }
 
+// Set by Init, cleared once the controllers lose their register state
+static bool epd_initialized = false;
+
 // Helper functions
 static void EPD_13IN3E_CS_ALL(UBYTE Value) {
+    DEV_SPI_Bulk_Flush();  // Staged pixel data must reach the bus before CS moves
     DEV_Digital_Write(EPD_CS_M_PIN, Value);
     DEV_Digital_Write(EPD_CS_S_PIN, Value);
 }
 
+// Assert CS for the target controller(s) and point the bus layer at them
+static void EPD_13IN3E_Select(UBYTE target) {
+    DEV_SPI_SetTarget(target);
+    if (target & EPD_TARGET_M) DEV_Digital_Write(EPD_CS_M_PIN, 0);
+    if (target & EPD_TARGET_S) DEV_Digital_Write(EPD_CS_S_PIN, 0);
+}
+
 static void EPD_13IN3E_SPI_Sand(UBYTE Cmd, const UBYTE *buf, UDOUBLE Len) {
     DEV_SPI_WriteByte(Cmd);
     DEV_SPI_Write_nByte((UBYTE *)buf,Len);
 }
 
+static void EPD_13IN3E_RunSequence(const EPD_13IN3E_Cmd *seq, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        const EPD_13IN3E_Cmd &cmd = seq[i];
+        EPD_13IN3E_Select(cmd.target);
+        EPD_13IN3E_SPI_Sand(cmd.reg, cmd.data, cmd.len);
+        EPD_13IN3E_CS_ALL(1);
+    }
+}
+
 static void EPD_13IN3E_Reset(void) {
     // Official Waveshare double reset sequence for dual-controller initialization
     DEV_Digital_Write(EPD_RST_PIN, 1);
@@ -129,111 +208,60 @@ static void EPD_13IN3E_SendData(UBYTE Reg) {
     DEV_SPI_WriteByte(Reg);
 }
 
-static void EPD_13IN3E_SendData2(const UBYTE *buf, uint32_t Len) {
-    if (!buf || Len == 0) return;
-    DEV_SPI_Write_nByte((UBYTE *)buf,Len);
-}
-
 static void EPD_13IN3E_ReadBusyH(void) {
     Debug("e-Paper busy\r\n");
     while(!DEV_Digital_Read(EPD_BUSY_PIN)) {
         DEV_Delay_ms(10);
-        esp_task_wdt_reset();  // Reset watchdog during long e-ink operations
+        DEV_Watchdog_Reset();  // Reset watchdog during long e-ink operations
     }
     DEV_Delay_ms(20);
     Debug("e-Paper busy release\r\n");
 }
 
-static void EPD_13IN3E_TurnOnDisplay(void) {
+// Power on and start the refresh (DRF); BUSY stays low while it runs
+static void EPD_13IN3E_StartRefresh(void) {
     printf("Write PON \r\n");
-    EPD_13IN3E_CS_ALL(0);
+    EPD_13IN3E_Select(EPD_TARGET_ALL);
     EPD_13IN3E_SendCommand(0x04);
     EPD_13IN3E_CS_ALL(1);
     EPD_13IN3E_ReadBusyH();
 
     printf("Write DRF \r\n");
     DEV_Delay_ms(50);
-    EPD_13IN3E_CS_ALL(0);
+    EPD_13IN3E_Select(EPD_TARGET_ALL);
     EPD_13IN3E_SPI_Sand(DRF, DRF_V, sizeof(DRF_V));
     EPD_13IN3E_CS_ALL(1);
+}
+
+static void EPD_13IN3E_FinishRefresh(void) {
     EPD_13IN3E_ReadBusyH();
     printf("Write POF \r\n");
-    EPD_13IN3E_CS_ALL(0);
+    EPD_13IN3E_Select(EPD_TARGET_ALL);
     EPD_13IN3E_SPI_Sand(POF, POF_V, sizeof(POF_V));
     EPD_13IN3E_CS_ALL(1);
     // Critical: Official driver does NOT wait for busy after POF - timing sensitive
     printf("Display Done!! \r\n");
 }
 
+static void EPD_13IN3E_TurnOnDisplay(void) {
+    EPD_13IN3E_StartRefresh();
+    EPD_13IN3E_FinishRefresh();
+}
+
 /******************************************************************************
  * Display Initialization and Control Functions
  ******************************************************************************/
 void EPD_13IN3E_Init(void) {
-    EPD_13IN3E_Reset();
-
-    DEV_Digital_Write(EPD_CS_M_PIN, 0);
-    EPD_13IN3E_SPI_Sand(AN_TM, AN_TM_V, sizeof(AN_TM_V));
-    EPD_13IN3E_CS_ALL(1);
-
-    EPD_13IN3E_CS_ALL(0);
-    EPD_13IN3E_SPI_Sand(CMD66, CMD66_V, sizeof(CMD66_V));
-    EPD_13IN3E_CS_ALL(1);
-
-    EPD_13IN3E_CS_ALL(0);
-    EPD_13IN3E_SPI_Sand(PSR, PSR_V, sizeof(PSR_V));
-    EPD_13IN3E_CS_ALL(1);
-
-    EPD_13IN3E_CS_ALL(0);
-    EPD_13IN3E_SPI_Sand(CDI, CDI_V, sizeof(CDI_V));
-    EPD_13IN3E_CS_ALL(1);
-
-    EPD_13IN3E_CS_ALL(0);
-    EPD_13IN3E_SPI_Sand(TCON, TCON_V, sizeof(TCON_V));
-    EPD_13IN3E_CS_ALL(1);
-
-    EPD_13IN3E_CS_ALL(0);
-    EPD_13IN3E_SPI_Sand(AGID, AGID_V, sizeof(AGID_V));
-    EPD_13IN3E_CS_ALL(1);
-
-    EPD_13IN3E_CS_ALL(0);
-    EPD_13IN3E_SPI_Sand(PWS, PWS_V, sizeof(PWS_V));
-    EPD_13IN3E_CS_ALL(1);
-
-    EPD_13IN3E_CS_ALL(0);
-    EPD_13IN3E_SPI_Sand(CCSET, CCSET_V, sizeof(CCSET_V));
-    EPD_13IN3E_CS_ALL(1);
-
-    EPD_13IN3E_CS_ALL(0);
-    EPD_13IN3E_SPI_Sand(TRES, TRES_V, sizeof(TRES_V));
-    EPD_13IN3E_CS_ALL(1);
-
-    DEV_Digital_Write(EPD_CS_M_PIN, 0);
-    EPD_13IN3E_SPI_Sand(PWR_epd, PWR_V, sizeof(PWR_V));
-    EPD_13IN3E_CS_ALL(1);
-
-    DEV_Digital_Write(EPD_CS_M_PIN, 0);
-    EPD_13IN3E_SPI_Sand(EN_BUF, EN_BUF_V, sizeof(EN_BUF_V));
-    EPD_13IN3E_CS_ALL(1);
-
-    DEV_Digital_Write(EPD_CS_M_PIN, 0);
-    EPD_13IN3E_SPI_Sand(BTST_P, BTST_P_V, sizeof(BTST_P_V));
-    EPD_13IN3E_CS_ALL(1);
-
-    DEV_Digital_Write(EPD_CS_M_PIN, 0);
-    EPD_13IN3E_SPI_Sand(BOOST_VDDP_EN, BOOST_VDDP_EN_V, sizeof(BOOST_VDDP_EN_V));
-    EPD_13IN3E_CS_ALL(1);
-
-    DEV_Digital_Write(EPD_CS_M_PIN, 0);
-    EPD_13IN3E_SPI_Sand(BTST_N, BTST_N_V, sizeof(BTST_N_V));
-    EPD_13IN3E_CS_ALL(1);
-
-    DEV_Digital_Write(EPD_CS_M_PIN, 0);
-    EPD_13IN3E_SPI_Sand(BUCK_BOOST_VDDN, BUCK_BOOST_VDDN_V, sizeof(BUCK_BOOST_VDDN_V));
-    EPD_13IN3E_CS_ALL(1);
+    // Registers survive until the controllers are put to sleep or powered off,
+    // so a second Init (e.g. from the splash path) would only repeat the reset
+    if (epd_initialized) {
+        Debug("e-Paper already initialized, skipping reset\r\n");
+        return;
+    }
 
-    DEV_Digital_Write(EPD_CS_M_PIN, 0);
-    EPD_13IN3E_SPI_Sand(TFT_VCOM_POWER, TFT_VCOM_POWER_V, sizeof(TFT_VCOM_POWER_V));
-    EPD_13IN3E_CS_ALL(1);
+    EPD_13IN3E_Reset();
+    EPD_13IN3E_RunSequence(EPD_13IN3E_INIT_SEQ, EPD_13IN3E_INIT_COUNT);
+    epd_initialized = true;
 }
 
 /******************************************************************************
@@ -257,18 +285,18 @@ void EPD_13IN3E_Clear(UBYTE color) {
     }
 
     // Send to Master controller (left half)
-    DEV_Digital_Write(EPD_CS_M_PIN, 0);
+    EPD_13IN3E_Select(EPD_TARGET_M);
     EPD_13IN3E_SendCommand(0x10);
     for (UDOUBLE j = 0; j < Height; j++) {
-        EPD_13IN3E_SendData2(line_buffer, line_size);
+        DEV_SPI_Bulk_Write(line_buffer, line_size);
     }
     EPD_13IN3E_CS_ALL(1);
 
     // Send to Slave controller (right half)
-    DEV_Digital_Write(EPD_CS_S_PIN, 0);
+    EPD_13IN3E_Select(EPD_TARGET_S);
     EPD_13IN3E_SendCommand(0x10);
     for (UDOUBLE j = 0; j < Height; j++) {
-        EPD_13IN3E_SendData2(line_buffer, line_size);
+        DEV_SPI_Bulk_Write(line_buffer, line_size);
     }
     EPD_13IN3E_CS_ALL(1);
 
@@ -278,83 +306,13 @@ void EPD_13IN3E_Clear(UBYTE color) {
 /******************************************************************************
  * Boot Splash Display Function
  ******************************************************************************/
-void EPD_13IN3E_DisplayTextScreen(const char* ssid, uint16_t port, int battery_pct) {
-    Serial.println("*** e-Frame with Color Bands + Text ***");
-    
-    // Access global server config
-    extern char server_host[48];
-    extern char server_port[8];
+void EPD_13IN3E_DisplayTextScreen(const char* const band_texts[6]) {
+    Debug("*** e-Frame with Color Bands + Text ***\r\n");
     
     // Line buffer for rendering
     static const int BYTES_PER_LINE_HALF = EPD_13IN3E_WIDTH / 4; // 300 bytes per half line
     uint8_t line[BYTES_PER_LINE_HALF];
     
-    // Get WiFi info for display - convert to uppercase for better font rendering
-    char ip_line[64];
-    char wifi_line[64];
-    char battery_line[64];
-    char server_line[64];
-    char ssid_upper[32];
-    
-    // Special config mode display (battery_pct == -2)
-    if (battery_pct == -2) {
-        strcpy(battery_line, "CONFIG MODE");
-        snprintf(wifi_line, sizeof(wifi_line), "WIFI: %s", ssid);  // ssid = "E-Ink-Setup"
-        strcpy(ip_line, "OPEN BROWSER");
-    } else if (battery_pct < 0) {
-        strcpy(battery_line, "USB POWER");
-    } else {
-        // Get voltage for display (re-read ADC quickly)
-        int raw = analogRead(35);  // Quick read
-        float voltage = (raw / 4095.0) * 3.3 * 2.0;
-        snprintf(battery_line, sizeof(battery_line), "BATTERY: %.1fV (%d%%)", voltage, battery_pct);
-    }
-    
-    if (battery_pct != -2) {  // Normal mode (not config)
-        if (WiFi.status() == WL_CONNECTED) {
-            // Show only local IP (no port)
-            snprintf(ip_line, sizeof(ip_line), "IP: %s", WiFi.localIP().toString().c_str());
-            
-            // Show server host and port
-            snprintf(server_line, sizeof(server_line), "SERVER: %s:%s", server_host, server_port);
-            
-            // Convert actual connected SSID to uppercase
-            String connected_ssid = WiFi.SSID();
-            strncpy(ssid_upper, connected_ssid.c_str(), sizeof(ssid_upper) - 1);
-            ssid_upper[sizeof(ssid_upper) - 1] = '\0';
-            for (int i = 0; ssid_upper[i]; i++) {
-                ssid_upper[i] = toupper(ssid_upper[i]);
-            }
-            snprintf(wifi_line, sizeof(wifi_line), "WIFI: %s", ssid_upper);
-        } else {
-            strcpy(ip_line, "NO WIFI CONNECTION");
-            strcpy(wifi_line, "OFFLINE MODE");
-            strcpy(server_line, "NO SERVER");
-        }
-    }
-    
-    // MAX 30 CHARACTERS (1200px / 40px per char = 30 chars)
-    // Each line below is <= 30 chars for perfect fit
-    const char* band_texts[6];
-    
-    if (battery_pct == -2) {
-        // Config mode display - 4 lines of text
-        band_texts[0] = battery_line;               // "CONFIG MODE"
-        band_texts[1] = wifi_line;                  // "WIFI: E-Ink-Setup"
-        band_texts[2] = ip_line;                    // "OPEN BROWSER"
-        band_texts[3] = "192.168.4.1";              // IP address
-        band_texts[4] = "TIMEOUT: 3 MINUTES";       // Info
-        band_texts[5] = "DOUBLE RESET TO RETRY";    // Help
-    } else {
-        // Normal mode display with server info
-        band_texts[0] = "E-INK FRAME (C) 2025";     // Band 0 (black)
-        band_texts[1] = wifi_line;                  // Band 1 (white) - Actual WiFi
-        band_texts[2] = ip_line;                    // Band 2 (yellow) - Local IP only
-        band_texts[3] = server_line;                // Band 3 (red) - Server info
-        band_texts[4] = battery_line;               // Band 4 (blue) - Battery
-        band_texts[5] = "READY FOR YOUR IMAGES";    // Band 5 (green)
-    }
-    
     // Initialize the display (same as working code)
     EPD_13IN3E_Init();
     
@@ -429,7 +387,7 @@ void EPD_13IN3E_DisplayTextScreen(const char* ssid, uint16_t port, int battery_p
         EPD_13IN3E_WriteLineM(line);
         
         if ((y % 100) == 0) {
-            Serial.printf("M line %d/%d\r", y, EPD_13IN3E_HEIGHT);
+            Debug("M line %d/%d\r", y, EPD_13IN3E_HEIGHT);
         }
     }
     EPD_13IN3E_EndFrameM();
@@ -521,22 +479,18 @@ void EPD_13IN3E_DisplayTextScreen(const char* ssid, uint16_t port, int battery_p
         EPD_13IN3E_WriteLineS(line);
         
         if ((y % 100) == 0) {
-            Serial.printf("S line %d/%d\r", y, EPD_13IN3E_HEIGHT);
+            Debug("S line %d/%d\r", y, EPD_13IN3E_HEIGHT);
         }
     }
     EPD_13IN3E_EndFrameS();
     
-    Serial.println("\nRefreshing display...");
+    Debug("\nRefreshing display...\r\n");
     EPD_13IN3E_RefreshNow();
     
-    Serial.println("Boot splash complete");
+    Debug("Boot splash complete\r\n");
 }
 
 
-void EPD_13IN3E_ShowBootSplash(const char* ssid, uint16_t port, int battery_pct) {
-    EPD_13IN3E_DisplayTextScreen(ssid, port, battery_pct);
-}
-
 /******************************************************************************
  * Power Management Functions
  ******************************************************************************/
@@ -564,25 +518,26 @@ void EPD_13IN3E_PowerOff(void) {
 }
 
 void EPD_13IN3E_Sleep(void) {
-    EPD_13IN3E_CS_ALL(0);
+    EPD_13IN3E_Select(EPD_TARGET_ALL);
     EPD_13IN3E_SendCommand(0x07);
     EPD_13IN3E_SendData(0XA5);
     EPD_13IN3E_CS_ALL(1);
     DEV_Delay_ms(100);
+    epd_initialized = false;  // Deep sleep needs a hardware reset to wake up
 }
 
 /******************************************************************************
  * TCP Streaming Functions
  ******************************************************************************/
 void EPD_13IN3E_BeginFrameM(void) {
-    DEV_Digital_Write(EPD_CS_M_PIN, 0);
+    EPD_13IN3E_Select(EPD_TARGET_M);
     EPD_13IN3E_SendCommand(0x10);
 }
 
 void EPD_13IN3E_WriteLineM(const UBYTE *p300) {
     if (!p300) return;
-    // Master handles left half - send all 300 bytes
-    EPD_13IN3E_SendData2(p300, EPD_13IN3E_WIDTH/4);
+    // Master handles left half - staged into DMA blocks, flushed at EndFrame
+    DEV_SPI_Bulk_Write(p300, EPD_13IN3E_WIDTH/4);
 }
 
 void EPD_13IN3E_EndFrameM(void) {
@@ -592,21 +547,71 @@ void EPD_13IN3E_EndFrameM(void) {
 void EPD_13IN3E_BeginFrameS(void) {
     // Ensure Master is deselected before selecting Slave
     EPD_13IN3E_CS_ALL(1);  // Deselect all first
-    DEV_Digital_Write(EPD_CS_S_PIN, 0);  // Select only Slave
+    EPD_13IN3E_Select(EPD_TARGET_S);  // Select only Slave
     EPD_13IN3E_SendCommand(0x10);
 }
 
 void EPD_13IN3E_WriteLineS(const UBYTE *p300) {
     if (!p300) return;
-    // Master handles left half - send all 300 bytes
-    EPD_13IN3E_SendData2(p300, EPD_13IN3E_WIDTH/4);
+    // Slave handles right half - staged into DMA blocks, flushed at EndFrame
+    DEV_SPI_Bulk_Write(p300, EPD_13IN3E_WIDTH/4);
 }
 
 void EPD_13IN3E_EndFrameS(void) {
     EPD_13IN3E_CS_ALL(1);
 }
 
+#ifdef EPD_DUAL_BUS
+/******************************************************************************
+ * Dual-bus Streaming (both controllers at once, row-major input)
+ ******************************************************************************/
+void EPD_13IN3E_BeginFrameDual(void) {
+    EPD_13IN3E_CS_ALL(1);
+    EPD_13IN3E_Select(EPD_TARGET_ALL);  // DTM goes out on both hosts
+    EPD_13IN3E_SendCommand(DTM);
+}
+
+void EPD_13IN3E_AcquireRow(UBYTE **left, UBYTE **right) {
+    *left = DEV_SPI_Bulk_ReserveOn(EPD_TARGET_M, EPD_13IN3E_WIDTH/4);
+    *right = DEV_SPI_Bulk_ReserveOn(EPD_TARGET_S, EPD_13IN3E_WIDTH/4);
+}
+
+void EPD_13IN3E_SubmitRow(void) {
+    DEV_SPI_Bulk_CommitOn(EPD_TARGET_M, EPD_13IN3E_WIDTH/4);
+    DEV_SPI_Bulk_CommitOn(EPD_TARGET_S, EPD_13IN3E_WIDTH/4);
+}
+
+void EPD_13IN3E_WriteRow(const UBYTE *p600) {
+    if (!p600) return;
+    UBYTE *left, *right;
+    EPD_13IN3E_AcquireRow(&left, &right);
+    memcpy(left, p600, EPD_13IN3E_WIDTH/4);
+    memcpy(right, p600 + EPD_13IN3E_WIDTH/4, EPD_13IN3E_WIDTH/4);
+    EPD_13IN3E_SubmitRow();
+}
+
+void EPD_13IN3E_EndFrameDual(void) {
+    EPD_13IN3E_CS_ALL(1);
+}
+#endif
+
+void EPD_13IN3E_Fence(void) {
+    DEV_SPI_Bulk_Flush();
+}
+
 void EPD_13IN3E_RefreshNow(void) {
     EPD_13IN3E_TurnOnDisplay();
 }
 
+void EPD_13IN3E_RefreshStart(void) {
+    EPD_13IN3E_StartRefresh();
+}
+
+bool EPD_13IN3E_Busy(void) {
+    return !DEV_Digital_Read(EPD_BUSY_PIN);
+}
+
+void EPD_13IN3E_RefreshWait(void) {
+    EPD_13IN3E_FinishRefresh();
+}
+
@@ -61,6 +61,11 @@ void EPD_13IN3E_Sleep(void);
 
 // Display control functions
 void EPD_13IN3E_RefreshNow(void);
+// RefreshNow in two halves: the panel SPI bus must stay idle in between,
+// but the CPU and the radio are free while BUSY is held (about 20 s)
+void EPD_13IN3E_RefreshStart(void);
+bool EPD_13IN3E_Busy(void);
+void EPD_13IN3E_RefreshWait(void);
 void EPD_13IN3E_Clear(UBYTE color);
 
 // Frame buffer functions for dual-controller architecture
@@ -72,7 +77,22 @@ void EPD_13IN3E_BeginFrameS(void);    // Slave controller (right half)
 void EPD_13IN3E_EndFrameS(void);
 void EPD_13IN3E_WriteLineS(const UBYTE* line_data);
 
-// Boot splash screen
-void EPD_13IN3E_ShowBootSplash(const char* ssid, uint16_t port, int battery_level);
+#ifdef EPD_DUAL_BUS
+// Both controllers at once on separate SPI hosts. Input is row-major: each
+// 600-byte panel row is split into its left (master) and right (slave) half.
+// AcquireRow/SubmitRow are the zero-copy form of WriteRow.
+void EPD_13IN3E_BeginFrameDual(void);
+void EPD_13IN3E_WriteRow(const UBYTE* row_data);
+void EPD_13IN3E_AcquireRow(UBYTE** left, UBYTE** right);
+void EPD_13IN3E_SubmitRow(void);
+void EPD_13IN3E_EndFrameDual(void);
+#endif
+
+// Lines are queued while earlier ones are still on the wire; Fence waits for
+// the bus to drain before EndFrame
+void EPD_13IN3E_Fence(void);
+
+// Text screen: six colour bands with one line of text each (max 30 chars)
+void EPD_13IN3E_DisplayTextScreen(const char* const band_texts[6]);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,103 @@
+#include "FrameCheck.h"
+#include "Debug.h"
+#include "esp_rom_crc.h"
+#include <ctype.h>
+#include <inttypes.h>
+
+// Copy a hex digest lowercased; false if it is too short, too long or not hex
+static bool FrameCheck_CopyHex(char *dst, size_t size, const char *src)
+{
+  size_t n = 0;
+  for (; src[n]; n++) {
+    if (n >= size - 1 || !isxdigit((unsigned char)src[n])) return false;
+    dst[n] = tolower((unsigned char)src[n]);
+  }
+  dst[n] = '\0';
+  return n >= FRAME_CHECK_MIN_HEX;
+}
+
+// 1..8 hex digits, nothing else
+static bool FrameCheck_ParseCrc(const char *hex, uint32_t *crc)
+{
+  size_t n = strlen(hex);
+  if (n == 0 || n > 8) return false;
+  for (size_t i = 0; i < n; i++) {
+    if (!isxdigit((unsigned char)hex[i])) return false;
+  }
+  *crc = strtoul(hex, NULL, 16);
+  return true;
+}
+
+bool FrameCheck_Begin(FrameCheck *fc, const char *md5_hex, const char *crc32_hex)
+{
+  fc->bytes = 0;
+  fc->busy_us = 0;
+  fc->crc = 0;
+  fc->expected[0] = '\0';
+  fc->mode = FRAME_CHECK_NONE;
+
+  if (crc32_hex && crc32_hex[0]) {
+    if (!FrameCheck_ParseCrc(crc32_hex, &fc->expected_crc)) {
+      Debug("Malformed crc32 \"%s\"\r\n", crc32_hex);
+      return false;
+    }
+    fc->mode = FRAME_CHECK_CRC32;
+  } else if (md5_hex && md5_hex[0] && FrameCheck_CopyHex(fc->expected, sizeof(fc->expected), md5_hex)) {
+    fc->mode = FRAME_CHECK_MD5;
+    fc->md5.begin();
+  } else if (md5_hex && md5_hex[0]) {
+    Debug("Hash \"%s\" is not an MD5 hex digest, frame not verified\r\n", md5_hex);
+  } else {
+    Debug("No digest advertised, frame not verified\r\n");
+  }
+  return true;
+}
+
+void FrameCheck_Update(FrameCheck *fc, const UBYTE *data, UDOUBLE len)
+{
+  if (fc->mode == FRAME_CHECK_NONE) return;
+  UDOUBLE start = DEV_Time_us();
+  if (fc->mode == FRAME_CHECK_CRC32) {
+    fc->crc = esp_rom_crc32_le(fc->crc, data, len);
+  } else {
+    fc->md5.add(data, len);
+  }
+  fc->busy_us += DEV_Time_us() - start;
+  fc->bytes += len;
+}
+
+bool FrameCheck_Verify(FrameCheck *fc)
+{
+  char actual[33];
+  switch (fc->mode) {
+  case FRAME_CHECK_CRC32:
+    if (fc->crc != fc->expected_crc) {
+      Debug("Frame CRC32 mismatch: got %08" PRIx32 ", expected %08" PRIx32 "\r\n",
+            fc->crc, fc->expected_crc);
+      return false;
+    }
+    return true;
+  case FRAME_CHECK_MD5:
+    fc->md5.calculate();
+    fc->md5.getChars(actual);
+    break;
+  default:
+    return true;
+  }
+
+  // The server may advertise a truncated digest; compare its prefix only
+  bool match = strncmp(actual, fc->expected, strlen(fc->expected)) == 0;
+  if (!match) {
+    Debug("Frame digest mismatch: got %s, expected %s\r\n", actual, fc->expected);
+  }
+  return match;
+}
+
+const char *FrameCheck_ModeName(const FrameCheck *fc)
+{
+  switch (fc->mode) {
+  case FRAME_CHECK_CRC32: return "CRC32";
+  case FRAME_CHECK_MD5:   return "MD5";
+  default:                return "none";
+  }
+}
\ No newline at end of file
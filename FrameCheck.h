@@ -0,0 +1,52 @@
+/**
+ * Streamed Frame Integrity Check
+ *
+ * Running digest over the frame bytes as they come off the socket, compared
+ * against the value advertised by /api/image/info before the panel is
+ * refreshed. MD5 matches the existing server (hex digest, usually truncated
+ * to 12 characters); CRC32 is used instead when the server also sends a
+ * "crc32" field, as it is several times cheaper per byte. A hash that is
+ * not a hex digest (an opaque ETag) leaves the frame unverified, which is
+ * logged; a malformed crc32 is an error.
+ *
+ * @author Stephane Bhiri
+ * @version 2.0
+ * @date January 2025
+ */
+
+#ifndef FRAME_CHECK_H
+#define FRAME_CHECK_H
+
+#include "DEV_Config.h"
+#include <MD5Builder.h>
+
+#define FRAME_CHECK_MIN_HEX  8   // Shortest advertised digest accepted
+
+typedef enum {
+  FRAME_CHECK_NONE = 0,          // Nothing advertised, frame is not verified
+  FRAME_CHECK_MD5,
+  FRAME_CHECK_CRC32,
+} FrameCheckMode;
+
+typedef struct {
+  FrameCheckMode mode;
+  MD5Builder md5;
+  uint32_t crc;
+  uint32_t expected_crc;
+  UDOUBLE  bytes;                // Bytes fed so far
+  UDOUBLE  busy_us;              // Time spent hashing (per-byte cost in logs)
+  char     expected[33];         // Advertised MD5 hex digest (lowercase)
+} FrameCheck;
+
+// Pick the mode from the info fields (either may be NULL/empty) and reset.
+// False if crc32_hex is present but not 1..8 hex digits.
+bool FrameCheck_Begin(FrameCheck* fc, const char* md5_hex, const char* crc32_hex);
+
+void FrameCheck_Update(FrameCheck* fc, const UBYTE* data, UDOUBLE len);
+
+// True when the digest matches, or when nothing was advertised
+bool FrameCheck_Verify(FrameCheck* fc);
+
+const char* FrameCheck_ModeName(const FrameCheck* fc);
+
+#endif
\ No newline at end of file
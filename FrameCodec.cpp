@@ -0,0 +1,207 @@
+#include "FrameCodec.h"
+#include <string.h>
+
+enum {
+  FRAME_CODEC_STATE_OP = 0,   // Expecting an op byte
+  FRAME_CODEC_STATE_EXT,      // Expecting the extended length byte
+  FRAME_CODEC_STATE_VALUE,    // Expecting the FILL byte
+  FRAME_CODEC_STATE_LITERAL,  // Copying literal bytes
+};
+
+void FrameCodec_DecoderInit(FrameCodec_Decoder *d, uint16_t width)
+{
+  d->width = width;
+  d->pos = 0;
+  d->run = 0;
+  d->op = 0;
+  d->state = FRAME_CODEC_STATE_OP;
+  d->repeat = 0;
+  d->error = width == 0 || width > FRAME_CODEC_MAX_WIDTH;
+  d->rows = 0;
+  memset(d->prev, 0, sizeof(d->prev));
+}
+
+bool FrameCodec_Pending(const FrameCodec_Decoder *d)
+{
+  return d->repeat > 0 && !d->error;
+}
+
+// Called after every op; a full row becomes the reference for the next one
+static void FrameCodec_EndOp(FrameCodec_Decoder *d, uint8_t *row, bool *row_done)
+{
+  d->state = FRAME_CODEC_STATE_OP;
+  if (d->pos == d->width) {
+    memcpy(d->prev, row, d->width);
+    d->pos = 0;
+    d->rows++;
+    *row_done = true;
+  }
+}
+
+// Length known: COPY completes at once, FILL/LITERAL wait for their bytes
+static void FrameCodec_StartRun(FrameCodec_Decoder *d, uint8_t *row, bool *row_done)
+{
+  if (d->pos + d->run > d->width) {
+    d->error = true;
+    return;
+  }
+  switch (d->op) {
+  case FRAME_CODEC_COPY:
+    memcpy(row + d->pos, d->prev + d->pos, d->run);
+    d->pos += d->run;
+    d->run = 0;
+    FrameCodec_EndOp(d, row, row_done);
+    break;
+  case FRAME_CODEC_FILL:
+    d->state = FRAME_CODEC_STATE_VALUE;
+    break;
+  default:
+    d->state = FRAME_CODEC_STATE_LITERAL;
+    break;
+  }
+}
+
+size_t FrameCodec_Decode(FrameCodec_Decoder *d, const uint8_t *in, size_t len,
+                         uint8_t *row, bool *row_done)
+{
+  size_t used = 0;
+  *row_done = false;
+  if (d->error) return 0;
+
+  if (d->repeat > 0) {
+    memcpy(row, d->prev, d->width);
+    d->repeat--;
+    d->rows++;
+    *row_done = true;
+    return 0;
+  }
+
+  while (!*row_done && !d->error) {
+    switch (d->state) {
+    case FRAME_CODEC_STATE_OP: {
+      if (used == len) return used;
+      uint8_t byte = in[used++];
+      d->op = byte & 0xC0;
+      d->run = byte & 0x3F;
+      if (d->op == FRAME_CODEC_REPEAT) {
+        if (d->run == 0 || d->pos != 0) {
+          d->error = true;
+          break;
+        }
+        memcpy(row, d->prev, d->width);
+        d->repeat = d->run - 1;
+        d->run = 0;
+        d->rows++;
+        *row_done = true;
+      } else if (d->run == 0) {
+        d->state = FRAME_CODEC_STATE_EXT;
+      } else {
+        FrameCodec_StartRun(d, row, row_done);
+      }
+      break;
+    }
+    case FRAME_CODEC_STATE_EXT:
+      if (used == len) return used;
+      d->run = 64 + in[used++];
+      FrameCodec_StartRun(d, row, row_done);
+      break;
+    case FRAME_CODEC_STATE_VALUE:
+      if (used == len) return used;
+      memset(row + d->pos, in[used++], d->run);
+      d->pos += d->run;
+      d->run = 0;
+      FrameCodec_EndOp(d, row, row_done);
+      break;
+    default: {
+      size_t n = len - used;
+      if (n > d->run) n = d->run;
+      memcpy(row + d->pos, in + used, n);
+      used += n;
+      d->pos += n;
+      d->run -= n;
+      if (d->run > 0) return used;
+      FrameCodec_EndOp(d, row, row_done);
+      break;
+    }
+    }
+  }
+  return used;
+}
+
+void FrameCodec_EncoderInit(FrameCodec_Encoder *e, uint16_t width)
+{
+  e->width = width;
+  e->repeat = 0;
+  memset(e->prev, 0, sizeof(e->prev));
+}
+
+// Op byte(s) for a run, split at the longest encodable length. FILL repeats
+// its value after each op byte, LITERAL its slice of the data.
+static size_t FrameCodec_EmitRun(uint8_t *out, uint8_t op, const uint8_t *data, size_t len)
+{
+  size_t o = 0;
+  while (len > 0) {
+    size_t n = len < FRAME_CODEC_MAX_RUN ? len : FRAME_CODEC_MAX_RUN;
+    if (n < 64) {
+      out[o++] = op | n;
+    } else {
+      out[o++] = op;
+      out[o++] = n - 64;
+    }
+    if (op == FRAME_CODEC_FILL) {
+      out[o++] = data[0];
+    } else if (op == FRAME_CODEC_LITERAL) {
+      memcpy(out + o, data, n);
+      o += n;
+      data += n;
+    }
+    len -= n;
+  }
+  return o;
+}
+
+size_t FrameCodec_EncodeFinish(FrameCodec_Encoder *e, uint8_t *out)
+{
+  if (e->repeat == 0) return 0;
+  out[0] = FRAME_CODEC_REPEAT | e->repeat;
+  e->repeat = 0;
+  return 1;
+}
+
+size_t FrameCodec_EncodeRow(FrameCodec_Encoder *e, const uint8_t *row, uint8_t *out)
+{
+  const uint16_t width = e->width;
+  if (memcmp(row, e->prev, width) == 0) {
+    if (++e->repeat < FRAME_CODEC_MAX_REPEAT) return 0;
+    return FrameCodec_EncodeFinish(e, out);
+  }
+
+  size_t o = FrameCodec_EncodeFinish(e, out);
+  uint16_t literal = 0;
+  uint16_t pos = 0;
+  while (pos < width) {
+    uint16_t fill = 1;
+    while (pos + fill < width && row[pos + fill] == row[pos]) fill++;
+    uint16_t copy = 0;
+    while (pos + copy < width && row[pos + copy] == e->prev[pos + copy]) copy++;
+
+    // COPY pays off from 2 bytes (1 op byte), FILL from 3 (op + value)
+    if (copy >= 2 && copy >= fill) {
+      o += FrameCodec_EmitRun(out + o, FRAME_CODEC_LITERAL, row + literal, pos - literal);
+      o += FrameCodec_EmitRun(out + o, FRAME_CODEC_COPY, NULL, copy);
+      pos += copy;
+      literal = pos;
+    } else if (fill >= 3) {
+      o += FrameCodec_EmitRun(out + o, FRAME_CODEC_LITERAL, row + literal, pos - literal);
+      o += FrameCodec_EmitRun(out + o, FRAME_CODEC_FILL, row + pos, fill);
+      pos += fill;
+      literal = pos;
+    } else {
+      pos++;
+    }
+  }
+  o += FrameCodec_EmitRun(out + o, FRAME_CODEC_LITERAL, row + literal, width - literal);
+
+  memcpy(e->prev, row, width);
+  return o;
+}
\ No newline at end of file
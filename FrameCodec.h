@@ -0,0 +1,85 @@
+/**
+ * Row-Opcode Frame Codec
+ *
+ * Streaming compression for the 4bpp panel format. The frame is coded row by
+ * row (one row = one stream record, 300 or 600 bytes) against the previous
+ * row, which suits flat-colour dashboards and posters. Every op stays inside
+ * its row, so the decoder only keeps the previous row and writes straight
+ * into the caller's line buffer. Plain C/C++ with no Arduino dependency, so
+ * the encoder also builds on a server or a host tool.
+ *
+ * Op byte: top two bits select the op, low six bits are the length (1-63;
+ * 0 means one extension byte follows and the length is 64 + that byte).
+ *   00 LITERAL  length bytes follow verbatim
+ *   01 FILL     one byte follows, repeated length times
+ *   10 COPY     length bytes from the previous row at the same position
+ *   11 REPEAT   at the start of a row: the previous row length times (1-63)
+ * The previous row is all zeros before the first row.
+ *
+ * @author Stephane Bhiri
+ * @version 2.0
+ * @date January 2025
+ */
+
+#ifndef FRAME_CODEC_H
+#define FRAME_CODEC_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define FRAME_CODEC_NAME       "rowop"   // Query value and X-Frame-Codec header
+#define FRAME_CODEC_MAX_WIDTH  600       // Widest row (dual-bus row layout)
+
+#define FRAME_CODEC_LITERAL    0x00
+#define FRAME_CODEC_FILL       0x40
+#define FRAME_CODEC_COPY       0x80
+#define FRAME_CODEC_REPEAT     0xC0
+#define FRAME_CODEC_MAX_RUN    (64 + 255)
+#define FRAME_CODEC_MAX_REPEAT 63
+
+// Worst-case encoded size of one row. The encoder only leaves a literal for
+// a COPY of 2 or a FILL of 3, so the costliest row is 64 literal bytes (two
+// op bytes) plus a 2-byte COPY (one op byte), repeated: one byte over per 66.
+// On top come the op bytes of the trailing literal and a pending REPEAT.
+#define FRAME_CODEC_ROW_BOUND(width) \
+  ((width) + 2 + ((width) + 2) / 66)
+
+typedef struct {
+  uint16_t width;                        // Bytes per row
+  uint16_t pos;                          // Bytes of the current row decoded
+  uint16_t run;                          // Bytes left in the current op
+  uint8_t  op;
+  uint8_t  state;
+  uint8_t  repeat;                       // Rows still owed by a REPEAT op
+  bool     error;                        // Malformed stream, decoding stopped
+  uint32_t rows;                         // Rows completed
+  uint8_t  prev[FRAME_CODEC_MAX_WIDTH];
+} FrameCodec_Decoder;
+
+typedef struct {
+  uint16_t width;
+  uint8_t  repeat;                       // Identical rows not yet emitted
+  uint8_t  prev[FRAME_CODEC_MAX_WIDTH];
+} FrameCodec_Encoder;
+
+void FrameCodec_DecoderInit(FrameCodec_Decoder* d, uint16_t width);
+
+// Decode from in into row until the row is complete or the input runs out.
+// Returns the input bytes used; *row_done is set once row holds a whole row.
+// row must be the same buffer across calls until then. Check d->error.
+size_t FrameCodec_Decode(FrameCodec_Decoder* d, const uint8_t* in, size_t len,
+                         uint8_t* row, bool* row_done);
+
+// True while a REPEAT op can still produce rows without more input
+bool FrameCodec_Pending(const FrameCodec_Decoder* d);
+
+void FrameCodec_EncoderInit(FrameCodec_Encoder* e, uint16_t width);
+
+// Encode one row into out (at least FRAME_CODEC_ROW_BOUND(width) bytes).
+// Returns the bytes written; 0 when the row was folded into a pending REPEAT.
+size_t FrameCodec_EncodeRow(FrameCodec_Encoder* e, const uint8_t* row, uint8_t* out);
+
+// Emit a pending REPEAT after the last row (at most 1 byte)
+size_t FrameCodec_EncodeFinish(FrameCodec_Encoder* e, uint8_t* out);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,190 @@
+#include "FrameInflate.h"
+#include "Debug.h"
+#include <inttypes.h>
+
+// gzip member header (RFC 1952): fixed part, then optional fields by flag
+#define GZIP_FEXTRA   0x04
+#define GZIP_FNAME    0x08
+#define GZIP_FCOMMENT 0x10
+#define GZIP_FHCRC    0x02
+
+enum {
+  GZIP_FIXED = 0,     // ID1 ID2 CM FLG MTIME(4) XFL OS
+  GZIP_EXTRA_LO,      // Little-endian length of FEXTRA
+  GZIP_EXTRA_HI,
+  GZIP_EXTRA,
+  GZIP_NAME,          // NUL-terminated
+  GZIP_COMMENT,       // NUL-terminated
+  GZIP_HCRC,
+  ZLIB_CMF,           // deflate: zlib CMF, or the first raw deflate byte
+  ZLIB_FLG,
+  GZIP_BODY,
+};
+
+bool FrameInflate_Begin(FrameInflate *z, FrameInflateFormat format)
+{
+  z->state = (tinfl_decompressor *)malloc(sizeof(tinfl_decompressor));
+  z->window = (UBYTE *)malloc(TINFL_LZ_DICT_SIZE);
+  if (!z->state || !z->window) {
+    FrameInflate_End(z);
+    return false;
+  }
+  tinfl_init(z->state);
+  z->window_pos = 0;
+  z->out_pos = 0;
+  z->out_len = 0;
+  z->format = format;
+  z->header_state = format == FRAME_INFLATE_GZIP ? GZIP_FIXED : ZLIB_CMF;
+  z->header_flags = 0;
+  z->header_skip = 10;
+  z->probe_len = 0;
+  z->done = false;
+  z->error = false;
+  z->in_total = 0;
+  z->out_total = 0;
+  return true;
+}
+
+void FrameInflate_End(FrameInflate *z)
+{
+  free(z->state);
+  free(z->window);
+  z->state = NULL;
+  z->window = NULL;
+}
+
+UDOUBLE FrameInflate_Footprint(void)
+{
+  return sizeof(tinfl_decompressor) + TINFL_LZ_DICT_SIZE;
+}
+
+// First optional header field present after the given one
+static UBYTE FrameInflate_NextField(FrameInflate *z, UBYTE after)
+{
+  if (after < GZIP_EXTRA_LO && (z->header_flags & GZIP_FEXTRA)) return GZIP_EXTRA_LO;
+  if (after < GZIP_NAME && (z->header_flags & GZIP_FNAME)) return GZIP_NAME;
+  if (after < GZIP_COMMENT && (z->header_flags & GZIP_FCOMMENT)) return GZIP_COMMENT;
+  if (after < GZIP_HCRC && (z->header_flags & GZIP_FHCRC)) {
+    z->header_skip = 2;
+    return GZIP_HCRC;
+  }
+  return GZIP_BODY;
+}
+
+// Walk the gzip or zlib header byte by byte; it may be split across reads
+static UDOUBLE FrameInflate_SkipHeader(FrameInflate *z, const UBYTE *in, UDOUBLE len)
+{
+  static const UBYTE magic[3] = {0x1F, 0x8B, 8};  // ID1, ID2, CM = deflate
+  UDOUBLE used = 0;
+  while (used < len && z->header_state != GZIP_BODY) {
+    UBYTE b = in[used++];
+    switch (z->header_state) {
+    case GZIP_FIXED: {
+      UWORD index = 10 - z->header_skip;
+      if (index < 3 && b != magic[index]) {
+        Debug("Not a gzip body\r\n");
+        z->error = true;
+        return used;
+      }
+      if (index == 3) z->header_flags = b;
+      if (--z->header_skip == 0) z->header_state = FrameInflate_NextField(z, GZIP_FIXED);
+      break;
+    }
+    case GZIP_EXTRA_LO:
+      z->header_skip = b;
+      z->header_state = GZIP_EXTRA_HI;
+      break;
+    case GZIP_EXTRA_HI:
+      z->header_skip |= b << 8;
+      z->header_state = z->header_skip ? (UBYTE)GZIP_EXTRA : FrameInflate_NextField(z, GZIP_EXTRA);
+      break;
+    case GZIP_EXTRA:
+      if (--z->header_skip == 0) z->header_state = FrameInflate_NextField(z, GZIP_EXTRA);
+      break;
+    case GZIP_NAME:
+    case GZIP_COMMENT:
+      if (b == 0) z->header_state = FrameInflate_NextField(z, z->header_state);
+      break;
+    case GZIP_HCRC:
+      if (--z->header_skip == 0) z->header_state = GZIP_BODY;
+      break;
+    case ZLIB_CMF:
+      z->probe[0] = b;
+      z->header_state = ZLIB_FLG;
+      break;
+    default: {  // ZLIB_FLG
+      // A zlib header is CM 8, a window of at most 32 KB and a multiple of 31
+      UBYTE cmf = z->probe[0];
+      z->probe[1] = b;
+      z->header_state = GZIP_BODY;
+      if ((cmf & 0x0F) != 8 || (cmf >> 4) > 7 || ((cmf << 8) | b) % 31 != 0) {
+        z->probe_len = 2;  // Raw deflate: both bytes belong to the stream
+      } else if (b & 0x20) {
+        Debug("zlib preset dictionary not supported\r\n");
+        z->error = true;
+      }
+      break;
+    }
+    }
+  }
+  return used;
+}
+
+UDOUBLE FrameInflate_Run(FrameInflate *z, const UBYTE *in, UDOUBLE in_len,
+                         UBYTE *out, UDOUBLE *out_len)
+{
+  UDOUBLE used = 0;
+  UDOUBLE want = *out_len;
+  *out_len = 0;
+
+  while (*out_len < want && !z->error) {
+    // Hand out what the window already holds before inflating more into it
+    if (z->out_len > 0) {
+      UDOUBLE n = want - *out_len;
+      if (n > z->out_len) n = z->out_len;
+      memcpy(out + *out_len, z->window + z->out_pos, n);
+      z->out_pos += n;
+      z->out_len -= n;
+      *out_len += n;
+      continue;
+    }
+    if (z->done) break;
+
+    if (z->header_state != GZIP_BODY) {
+      UDOUBLE n = FrameInflate_SkipHeader(z, in + used, in_len - used);
+      used += n;
+      z->in_total += n;
+      if (z->header_state != GZIP_BODY || z->error) break;
+    }
+
+    // Both wrappers were parsed above, so tinfl only ever sees raw deflate;
+    // bytes held by the zlib probe go in before the new input
+    bool probe = z->probe_len > 0;
+    const UBYTE *src = probe ? z->probe + sizeof(z->probe) - z->probe_len : in + used;
+    size_t in_bytes = probe ? z->probe_len : in_len - used;
+    size_t out_bytes = TINFL_LZ_DICT_SIZE - z->window_pos;
+    tinfl_status status = tinfl_decompress(z->state, src, &in_bytes, z->window,
+                                           z->window + z->window_pos, &out_bytes,
+                                           TINFL_FLAG_HAS_MORE_INPUT);
+    if (probe) {
+      z->probe_len -= in_bytes;  // Counted in in_total when they were read
+    } else {
+      used += in_bytes;
+      z->in_total += in_bytes;
+    }
+    z->out_total += out_bytes;
+    z->out_pos = z->window_pos;
+    z->out_len = out_bytes;
+    z->window_pos = (z->window_pos + out_bytes) & (TINFL_LZ_DICT_SIZE - 1);
+
+    if (status < TINFL_STATUS_DONE) {
+      Debug("Inflate failed (%d) after %" PRIu32 " bytes\r\n", (int)status, z->out_total);
+      z->error = true;
+    } else if (status == TINFL_STATUS_DONE) {
+      z->done = true;  // gzip/zlib trailer is left unread; the frame digest covers it
+    } else if (status == TINFL_STATUS_NEEDS_MORE_INPUT && out_bytes == 0 && !probe) {
+      break;
+    }
+  }
+  return used;
+}
\ No newline at end of file
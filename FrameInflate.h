@@ -0,0 +1,57 @@
+/**
+ * Streaming Inflate for Compressed Frame Bodies
+ *
+ * Decodes a gzip or deflate Content-Encoding on the fly with the tinfl
+ * inflater from the ESP32 ROM, so no decompressor is linked in. "deflate"
+ * is meant to be zlib-wrapped, but some servers send raw deflate; the first
+ * two bytes tell them apart, as browsers do. The
+ * working set is fixed: the 32 KB LZ window, which doubles as the output
+ * buffer, plus the inflater state, both allocated per frame.
+ *
+ * @author Stephane Bhiri
+ * @version 2.0
+ * @date January 2025
+ */
+
+#ifndef FRAME_INFLATE_H
+#define FRAME_INFLATE_H
+
+#include "DEV_Config.h"
+#include "rom/miniz.h"
+
+typedef enum {
+  FRAME_INFLATE_GZIP = 0,        // Content-Encoding: gzip (RFC 1952)
+  FRAME_INFLATE_ZLIB,            // Content-Encoding: deflate (RFC 1950, or raw RFC 1951)
+} FrameInflateFormat;
+
+typedef struct {
+  tinfl_decompressor* state;
+  UBYTE*   window;               // TINFL_LZ_DICT_SIZE bytes, circular
+  UDOUBLE  window_pos;           // Where tinfl writes next
+  UDOUBLE  out_pos;              // Inflated bytes not yet handed out
+  UDOUBLE  out_len;
+  UBYTE    format;
+  UBYTE    header_state;         // gzip header parser position
+  UBYTE    header_flags;
+  UWORD    header_skip;          // Bytes left in the current header field
+  UBYTE    probe[2];             // First deflate bytes, held while the wrapper is unknown
+  UBYTE    probe_len;            // Held bytes not yet given to the inflater
+  bool     done;                 // End of the deflate stream reached
+  bool     error;
+  UDOUBLE  in_total;             // Compressed bytes consumed, headers included
+  UDOUBLE  out_total;            // Bytes inflated
+} FrameInflate;
+
+bool FrameInflate_Begin(FrameInflate* z, FrameInflateFormat format);
+void FrameInflate_End(FrameInflate* z);
+
+// Consume compressed input and copy up to *out_len inflated bytes to out.
+// Returns the input bytes used and sets *out_len to the bytes written.
+// Call again with the remaining input; check z->error and z->done.
+UDOUBLE FrameInflate_Run(FrameInflate* z, const UBYTE* in, UDOUBLE in_len,
+                         UBYTE* out, UDOUBLE* out_len);
+
+// Bytes held for the whole frame (window + inflater state)
+UDOUBLE FrameInflate_Footprint(void);
+
+#endif
\ No newline at end of file
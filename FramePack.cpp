@@ -0,0 +1,43 @@
+#include "FramePack.h"
+
+// Six packed bits (two pixels) to one panel byte: 00aaabbb -> 0aaa0bbb
+static const uint8_t frame_pack_lut[64] = {
+  0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+  0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17,
+  0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27,
+  0x30, 0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x37,
+  0x40, 0x41, 0x42, 0x43, 0x44, 0x45, 0x46, 0x47,
+  0x50, 0x51, 0x52, 0x53, 0x54, 0x55, 0x56, 0x57,
+  0x60, 0x61, 0x62, 0x63, 0x64, 0x65, 0x66, 0x67,
+  0x70, 0x71, 0x72, 0x73, 0x74, 0x75, 0x76, 0x77,
+};
+
+void FramePack_Unpack(const uint8_t *in, uint8_t *out, size_t width)
+{
+  for (size_t i = 0; i < width; i += 4) {
+    uint32_t w = ((uint32_t)in[0] << 16) | ((uint32_t)in[1] << 8) | in[2];
+    out[0] = frame_pack_lut[(w >> 18) & 0x3F];
+    out[1] = frame_pack_lut[(w >> 12) & 0x3F];
+    out[2] = frame_pack_lut[(w >> 6) & 0x3F];
+    out[3] = frame_pack_lut[w & 0x3F];
+    in += 3;
+    out += 4;
+  }
+}
+
+bool FramePack_Pack(const uint8_t *in, uint8_t *out, size_t width)
+{
+  for (size_t i = 0; i < width; i += 4) {
+    uint32_t w = 0;
+    for (int k = 0; k < 4; k++) {
+      if (in[k] & 0x88) return false;  // Nibble code above 7
+      w = (w << 6) | ((in[k] >> 1) & 0x38) | (in[k] & 0x07);
+    }
+    out[0] = w >> 16;
+    out[1] = w >> 8;
+    out[2] = w;
+    in += 4;
+    out += 3;
+  }
+  return true;
+}
\ No newline at end of file
@@ -0,0 +1,34 @@
+/**
+ * 3-Bit Packed Frame Format
+ *
+ * Spectra 6 only uses nibble codes 0-6, so the wire can carry 3 bits per
+ * pixel instead of 4: every 8 pixels (4 panel bytes) travel as 3 bytes, a
+ * 300-byte line as 225 bytes and a frame as 720,000 bytes. Each 3-byte
+ * group is a big-endian 24-bit word with the leftmost pixel in the top
+ * three bits; a pixel's 3-bit value is its panel nibble code unchanged.
+ * Plain C/C++ with no Arduino dependency, so the packer also builds on a
+ * server or a host tool.
+ *
+ * @author Stephane Bhiri
+ * @version 2.0
+ * @date January 2025
+ */
+
+#ifndef FRAME_PACK_H
+#define FRAME_PACK_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define FRAME_PACK_NAME  "packed3"   // Query value and X-Frame-Codec header
+
+// Packed size of a panel line/row of the given byte width (multiple of 4)
+#define FRAME_PACK_BYTES(width)  ((width) / 4 * 3)
+
+// Expand packed bytes into width panel bytes (2 pixels per byte)
+void FramePack_Unpack(const uint8_t* in, uint8_t* out, size_t width);
+
+// Pack width panel bytes; false if a pixel code does not fit in 3 bits
+bool FramePack_Pack(const uint8_t* in, uint8_t* out, size_t width);
+
+#endif
\ No newline at end of file
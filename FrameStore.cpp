@@ -0,0 +1,293 @@
+#include "FrameStore.h"
+#include "FramePack.h"
+#include "Debug.h"
+#include "esp_partition.h"
+#include "esp_rom_crc.h"
+
+#define FRAME_STORE_ERASE_CHUNK  0x10000    // Erase ahead of the writes in 64 KB steps
+#define FRAME_STORE_IO           1536       // Packed bytes per read (2048 frame bytes)
+
+static const esp_partition_t *store_part = NULL;
+static FrameStore_Dir store_dir;
+static UBYTE store_slots = 0;
+static UWORD store_record = 0;
+static UBYTE store_selected = FRAME_STORE_NONE;   // Frame Read serves
+
+// Staging state: packed bytes go out to flash in buffer-sized pieces
+static UBYTE store_buf[3 * 1024];
+static UDOUBLE store_buf_len = 0;
+static UDOUBLE store_staged = 0;            // Packed bytes flushed to the staging slot
+static UDOUBLE store_erased = 0;            // Staging bytes already erased
+static UBYTE store_staging = FRAME_STORE_NONE;
+
+// Read side
+static UBYTE store_io[FRAME_STORE_IO];
+static UBYTE store_unpacked[FRAME_STORE_IO / 3 * 4];
+
+static UDOUBLE FrameStore_DirCrc(const FrameStore_Dir *dir)
+{
+  return esp_rom_crc32_le(0, (const uint8_t *)dir, offsetof(FrameStore_Dir, crc));
+}
+
+static UDOUBLE FrameStore_SlotOffset(UBYTE slot)
+{
+  return FRAME_STORE_SLOT_BASE + slot * FRAME_STORE_SLOT_SIZE;
+}
+
+static bool FrameStore_WriteDir(void)
+{
+  store_dir.seq++;
+  store_dir.crc = FrameStore_DirCrc(&store_dir);
+  UDOUBLE sector = (store_dir.seq % FRAME_STORE_DIR_SECTORS) * FRAME_STORE_SECTOR;
+  return esp_partition_erase_range(store_part, sector, FRAME_STORE_SECTOR) == ESP_OK &&
+         esp_partition_write(store_part, sector, &store_dir, sizeof(store_dir)) == ESP_OK;
+}
+
+static int FrameStore_Find(const char *hash)
+{
+  if (!hash || !hash[0]) return -1;
+  for (UBYTE i = 0; i < store_slots; i++) {
+    if (store_dir.slot[i].valid && strcasecmp(store_dir.slot[i].hash, hash) == 0) return i;
+  }
+  return -1;
+}
+
+bool FrameStore_Init(UWORD record_bytes)
+{
+  memset(&store_dir, 0, sizeof(store_dir));
+  store_dir.current = FRAME_STORE_NONE;
+  store_selected = FRAME_STORE_NONE;
+  store_part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                        (esp_partition_subtype_t)FRAME_STORE_SUBTYPE,
+                                        FRAME_STORE_LABEL);
+  store_slots = 0;
+  store_record = record_bytes;
+  if (store_part && store_part->size > FRAME_STORE_SLOT_BASE) {
+    store_slots = (store_part->size - FRAME_STORE_SLOT_BASE) / FRAME_STORE_SLOT_SIZE;
+    if (store_slots > FRAME_STORE_MAX_SLOTS) store_slots = FRAME_STORE_MAX_SLOTS;
+  }
+  if (store_slots < 2) {
+    Debug("Frame store: no \"%s\" partition\r\n", FRAME_STORE_LABEL);
+    store_part = NULL;
+    return false;
+  }
+
+  // Newest valid directory in the ring
+  static FrameStore_Dir dir;
+  bool found = false;
+  for (UBYTE i = 0; i < FRAME_STORE_DIR_SECTORS; i++) {
+    if (esp_partition_read(store_part, i * FRAME_STORE_SECTOR, &dir, sizeof(dir)) != ESP_OK) continue;
+    if (dir.magic != FRAME_STORE_MAGIC || dir.crc != FrameStore_DirCrc(&dir)) continue;
+    if (!found || (int32_t)(dir.seq - store_dir.seq) > 0) {
+      store_dir = dir;
+      found = true;
+    }
+  }
+  store_dir.magic = FRAME_STORE_MAGIC;
+
+  // Frames stored by a build with another stream layout are not usable
+  for (UBYTE i = 0; i < FRAME_STORE_MAX_SLOTS; i++) {
+    FrameStore_Slot *slot = &store_dir.slot[i];
+    slot->hash[sizeof(slot->hash) - 1] = '\0';
+    if (i >= store_slots || slot->record != record_bytes || slot->length % 4 ||
+        slot->length / 4 * 3 > FRAME_STORE_SLOT_SIZE) {
+      slot->valid = 0;
+    }
+  }
+  if (store_dir.current >= store_slots || !store_dir.slot[store_dir.current].valid) {
+    store_dir.current = FRAME_STORE_NONE;
+  }
+  store_selected = store_dir.current;
+  Debug("Frame store: %u slots, %u cached\r\n", store_slots, FrameStore_Cached());
+  return true;
+}
+
+bool FrameStore_Ready(void)
+{
+  return store_part != NULL;
+}
+
+const char *FrameStore_Hash(void)
+{
+  return store_selected != FRAME_STORE_NONE ? store_dir.slot[store_selected].hash : "";
+}
+
+UDOUBLE FrameStore_Length(void)
+{
+  return store_selected != FRAME_STORE_NONE ? store_dir.slot[store_selected].length : 0;
+}
+
+bool FrameStore_Contains(const char *hash)
+{
+  return FrameStore_Find(hash) >= 0;
+}
+
+bool FrameStore_Select(const char *hash)
+{
+  int i = FrameStore_Find(hash);
+  if (i < 0) return false;
+  store_selected = i;
+  return true;
+}
+
+bool FrameStore_MarkCurrent(void)
+{
+  if (!store_part || store_selected == FRAME_STORE_NONE) return false;
+  if (store_dir.current == store_selected) return true;
+  store_dir.current = store_selected;
+  store_dir.slot[store_selected].last_used = store_dir.seq + 1;
+  return FrameStore_WriteDir();
+}
+
+UBYTE FrameStore_Slots(void)
+{
+  return store_slots;
+}
+
+UBYTE FrameStore_Cached(void)
+{
+  UBYTE n = 0;
+  for (UBYTE i = 0; i < store_slots; i++) {
+    n += store_dir.slot[i].valid ? 1 : 0;
+  }
+  return n;
+}
+
+bool FrameStore_BeginStaging(void)
+{
+  if (!store_part) return false;
+
+  // Free slot with the fewest erases, else the least recently used frame
+  UBYTE victim = FRAME_STORE_NONE;
+  for (UBYTE i = 0; i < store_slots; i++) {
+    if (i == store_dir.current || i == store_selected) continue;
+    if (victim == FRAME_STORE_NONE) {
+      victim = i;
+      continue;
+    }
+    const FrameStore_Slot *a = &store_dir.slot[i];
+    const FrameStore_Slot *b = &store_dir.slot[victim];
+    if (a->valid != b->valid) {
+      if (!a->valid) victim = i;
+    } else if (a->valid && a->last_used != b->last_used) {
+      if ((int32_t)(a->last_used - b->last_used) < 0) victim = i;
+    } else if (a->erases < b->erases) {
+      victim = i;
+    }
+  }
+
+  if (victim == FRAME_STORE_NONE) return false;
+
+  // The slot stops being valid before its first sector is erased
+  FrameStore_Slot *slot = &store_dir.slot[victim];
+  if (slot->valid) {
+    Debug("Frame store: evicting %s from slot %u\r\n", slot->hash, victim);
+  }
+  slot->valid = 0;
+  slot->erases++;
+  if (!FrameStore_WriteDir()) return false;
+
+  store_staging = victim;
+  store_buf_len = 0;
+  store_staged = 0;
+  store_erased = 0;
+  return true;
+}
+
+static bool FrameStore_Flush(void)
+{
+  UDOUBLE base = FrameStore_SlotOffset(store_staging);
+  if (store_staged + store_buf_len > FRAME_STORE_SLOT_SIZE) return false;
+  while (store_erased < store_staged + store_buf_len) {
+    UDOUBLE n = FRAME_STORE_SLOT_SIZE - store_erased;
+    if (n > FRAME_STORE_ERASE_CHUNK) n = FRAME_STORE_ERASE_CHUNK;
+    if (esp_partition_erase_range(store_part, base + store_erased, n) != ESP_OK) return false;
+    store_erased += n;
+  }
+  if (esp_partition_write(store_part, base + store_staged, store_buf, store_buf_len) != ESP_OK) {
+    return false;
+  }
+  store_staged += store_buf_len;
+  store_buf_len = 0;
+  return true;
+}
+
+bool FrameStore_Write(const UBYTE *data, UDOUBLE len)
+{
+  if (store_staging == FRAME_STORE_NONE || len % 4) return false;
+  while (len > 0) {
+    UDOUBLE n = (sizeof(store_buf) - store_buf_len) / 3 * 4;
+    if (n > len) n = len;
+    if (!FramePack_Pack(data, store_buf + store_buf_len, n)) {
+      Debug("Frame store: pixel code above 7, frame not storable\r\n");
+      store_staging = FRAME_STORE_NONE;
+      return false;
+    }
+    store_buf_len += n / 4 * 3;
+    data += n;
+    len -= n;
+    if (store_buf_len + 3 > sizeof(store_buf) && !FrameStore_Flush()) {
+      store_staging = FRAME_STORE_NONE;
+      return false;
+    }
+  }
+  return true;
+}
+
+bool FrameStore_Commit(const char *hash, bool select)
+{
+  // The last partial buffer goes out while the staging slot is still known
+  UBYTE staged = store_staging;
+  bool flushed = staged != FRAME_STORE_NONE && (!store_buf_len || FrameStore_Flush());
+  store_staging = FRAME_STORE_NONE;
+  if (!flushed) return false;
+
+  // Content-addressed: one copy per hash. A copy on screen or selected is
+  // kept and the staged one (invalid since BeginStaging) is dropped instead
+  int dup = FrameStore_Find(hash);
+  if (dup >= 0 && (dup == store_dir.current || dup == store_selected)) {
+    if (select) store_selected = dup;
+    return true;
+  }
+  if (dup >= 0) store_dir.slot[dup].valid = 0;
+
+  FrameStore_Slot *slot = &store_dir.slot[staged];
+  memset(slot->hash, 0, sizeof(slot->hash));
+  strncpy(slot->hash, hash, sizeof(slot->hash) - 1);
+  slot->valid = 1;
+  slot->record = store_record;
+  slot->length = store_staged / 3 * 4;
+  slot->last_used = store_dir.seq + 1;
+  if (select) {
+    store_selected = staged;
+  }
+  return FrameStore_WriteDir();
+}
+
+bool FrameStore_Read(UDOUBLE offset, UBYTE *dst, UDOUBLE len)
+{
+  if (!store_part || offset + len > FrameStore_Length()) return false;
+  UDOUBLE base = FrameStore_SlotOffset(store_selected);
+
+  // Whole 3-byte groups are read and expanded; unaligned edges via a bounce buffer
+  while (len > 0) {
+    UDOUBLE skip = offset & 3;
+    UDOUBLE span = (skip + len + 3) & ~3;
+    if (span > sizeof(store_unpacked)) span = sizeof(store_unpacked);
+    if (esp_partition_read(store_part, base + (offset - skip) / 4 * 3, store_io, span / 4 * 3) != ESP_OK) {
+      return false;
+    }
+    UDOUBLE n = span - skip;
+    if (n > len) n = len;
+    if (skip == 0 && n == span) {
+      FramePack_Unpack(store_io, dst, span);
+    } else {
+      FramePack_Unpack(store_io, store_unpacked, span);
+      memcpy(dst, store_unpacked + skip, n);
+    }
+    offset += n;
+    dst += n;
+    len -= n;
+  }
+  return true;
+}
\ No newline at end of file
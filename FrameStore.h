@@ -0,0 +1,89 @@
+/**
+ * Flash Frame Store
+ *
+ * Content-addressed cache of frames in the "frames" data partition (see
+ * partitions.csv), keyed by the hash from /api/image/info. One slot holds
+ * the frame on screen; the others keep recently shown frames so a rotation
+ * back to one of them needs no download, and one of them takes the next
+ * download (staging). Frames are stored 3-bit packed (FramePack.h), 720,000
+ * bytes for a 960,000-byte frame, which fits three in the partition.
+ *
+ * A directory record (slots, hashes, LRU stamps, erase counts) is the only
+ * thing that makes a slot valid or current. Each update goes to the next
+ * of FRAME_STORE_DIR_SECTORS sectors in turn and the newest valid record
+ * wins, so a power cut at any point leaves the old or the new state, and
+ * directory wear is spread over the ring.
+ *
+ * Partition layout:
+ *   0x00000  directory ring (FRAME_STORE_DIR_SECTORS sectors)
+ *   0x08000  slot 0, slot 1, ... (FRAME_STORE_SLOT_SIZE each)
+ *
+ * @author Stephane Bhiri
+ * @version 2.0
+ * @date January 2025
+ */
+
+#ifndef FRAME_STORE_H
+#define FRAME_STORE_H
+
+#include "DEV_Config.h"
+
+#define FRAME_STORE_LABEL       "frames"
+#define FRAME_STORE_SUBTYPE     0x40
+#define FRAME_STORE_MAGIC       0x32535045   // "EPS2"
+#define FRAME_STORE_SECTOR      0x1000
+#define FRAME_STORE_DIR_SECTORS 8
+#define FRAME_STORE_SLOT_BASE   (FRAME_STORE_DIR_SECTORS * FRAME_STORE_SECTOR)
+#define FRAME_STORE_SLOT_SIZE   0xB0000      // 720,000 packed bytes, sector aligned
+#define FRAME_STORE_MAX_SLOTS   8
+#define FRAME_STORE_NONE        0xFF
+
+typedef struct {
+  char    hash[33];          // As advertised by /api/image/info
+  UBYTE   valid;
+  UWORD   record;            // Stream record size the frame was stored with
+  UDOUBLE length;            // Frame bytes (unpacked)
+  UDOUBLE last_used;         // Directory seq when last made current (LRU)
+  UDOUBLE erases;            // Times the slot was rewritten (wear levelling)
+} FrameStore_Slot;
+
+typedef struct {
+  UDOUBLE magic;
+  UDOUBLE seq;               // Bumped on every directory write
+  UBYTE   current;           // Slot on screen, FRAME_STORE_NONE if none
+  UBYTE   reserved[3];
+  FrameStore_Slot slot[FRAME_STORE_MAX_SLOTS];
+  UDOUBLE crc;               // CRC32 of the fields above
+} FrameStore_Dir;
+
+// Find the partition and load the newest valid directory. False if the
+// partition is missing (old partition table): callers stream directly.
+bool FrameStore_Init(UWORD record_bytes);
+bool FrameStore_Ready(void);
+
+// Hash and length of the selected frame, "" / 0 if there is none. After
+// Init the selected frame is the current one (last shown).
+const char* FrameStore_Hash(void);
+UDOUBLE FrameStore_Length(void);
+
+// Cache lookups: Select picks a cached frame to push without a download.
+// The selection lives in RAM; MarkCurrent records it in the directory once
+// the refresh is done, so a reboot never restores a frame not on screen.
+bool FrameStore_Contains(const char* hash);
+bool FrameStore_Select(const char* hash);
+bool FrameStore_MarkCurrent(void);
+UBYTE FrameStore_Slots(void);
+UBYTE FrameStore_Cached(void);
+
+// Staging into the least recently used slot (never the current or the
+// selected one); sectors are erased as the writes reach them. len must be
+// a multiple of 4.
+bool FrameStore_BeginStaging(void);
+bool FrameStore_Write(const UBYTE* data, UDOUBLE len);
+// select false keeps the selection as it is (prefetch)
+bool FrameStore_Commit(const char* hash, bool select);
+
+// Read (unpacked) from the selected frame
+bool FrameStore_Read(UDOUBLE offset, UBYTE* dst, UDOUBLE len);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,1157 @@
+/**
+ * Frame Update State Machine
+ *
+ * See FrameUpdate.h. The receive task runs on core 0 with the WiFi/lwIP
+ * tasks and only fills the line ring; the panel and the frame store are
+ * driven from the caller's task (loopTask on core 1).
+ *
+ * @author Stephane Bhiri
+ * @version 2.0
+ * @date January 2025
+ */
+
+#include "FrameUpdate.h"
+#include "Debug.h"
+#include "NET_Stream.h"
+#include "LineRing.h"
+#include "FrameCheck.h"
+#include "FrameCodec.h"
+#include "FramePack.h"
+#include "FrameInflate.h"
+#include "FrameStore.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_system.h"
+#include <algorithm>
+#include <atomic>
+#include <inttypes.h>
+#include <strings.h>
+
+#ifdef EPD_DUAL_BUS
+#define STREAM_LAYOUT_QUERY "?layout=rows"
+#define INFO_LAYOUT_PARAM   "&layout=rows"  // Digest must cover the row-major bytes
+#else
+#define STREAM_LAYOUT_QUERY ""
+#define INFO_LAYOUT_PARAM   ""
+#endif
+#define STREAM_RECORD_BYTES FRAME_UPDATE_RECORD_BYTES
+#define FRAME_BYTES         ((size_t)FRAME_UPDATE_BYTES)
+#define PANEL_LINES         EPD_13IN3E_HEIGHT
+
+static const char *const FRAME_WIRE_NAMES[] = {"raw", FRAME_CODEC_NAME, FRAME_PACK_NAME, "delta"};
+
+#define INFO_TIMEOUT_MS     5000
+#define FRAME_RING_BYTES    24000  // 80 lines / 40 rows of slack between WiFi and SPI
+#define FRAME_RX_CORE       0      // Same core as the WiFi/lwIP tasks
+#define FRAME_RX_PRIORITY   3      // Above loopTask so received data is drained promptly
+#define FRAME_STREAM_PATH   "/api/image/stream" STREAM_LAYOUT_QUERY
+#define FRAME_STREAM_HEADERS "Accept-Encoding: gzip, deflate\r\n"
+#define FRAME_TIMEOUT_MS    30000
+#define FRAME_RESUME_MAX    3      // Reconnects per frame before giving up
+#define FRAME_RESUME_DELAY  500    // ms, multiplied by the attempt number
+#define FRAME_STOP_MS       (FRAME_TIMEOUT_MS + 10000)  // Receive task must have let go by then
+
+// Shared between the receive task and the display (caller's) task
+typedef struct {
+  NET_Stream* net;
+  const char* host;
+  uint16_t port;
+  const char* path;         // Request path, reused to resume
+  uint8_t format;           // FrameWire of the body
+  FrameInflate* inflate;    // Content-Encoding decoder, NULL for identity
+  const UBYTE* wire;        // Compressed bytes read but not yet inflated
+  size_t wire_len;
+  FrameCheck* check;
+  LineRing ring;
+  TaskHandle_t consumer;
+  std::atomic<bool> done;
+  std::atomic<bool> exited;
+  std::atomic<bool> cancel; // Display side gave up on the frame
+  bool failed;
+  uint8_t resumes;          // Reconnects with a Range request
+  size_t patched;           // Delta bytes taken from the body
+  size_t received;          // Body bytes read from the socket (resume offset)
+} FrameUpdate_Receiver;
+
+// Coded/packed/compressed frames only; kept off the receive task's stack
+static FrameCodec_Decoder frame_decoder;
+static UBYTE frame_body_chunk[1460];
+static UBYTE frame_wire_chunk[1460];
+static UBYTE frame_packed_record[FRAME_PACK_BYTES(STREAM_RECORD_BYTES)];
+
+void FrameUpdate_Init(FrameUpdate *u, const char *host, uint16_t port)
+{
+  memset(u, 0, sizeof(*u));
+  u->host = host;
+  u->port = port;
+  u->battery_pct = -1;
+  u->next_poll_s = POLL_INTERVAL_S;
+}
+
+/**
+ * Comma-separated names in order of preference, blanks around them ignored;
+ * unknown names (including ones that merely contain a known name) are skipped
+ */
+uint8_t FrameUpdate_PickWire(const char *codecs)
+{
+  while (*codecs) {
+    while (*codecs == ' ' || *codecs == ',') codecs++;
+    size_t len = strcspn(codecs, ",");
+    size_t name_len = len;
+    while (name_len > 0 && codecs[name_len - 1] == ' ') name_len--;
+    for (uint8_t i = FRAME_WIRE_RAW + 1; i < FRAME_WIRE_DELTA; i++) {
+      if (name_len == strlen(FRAME_WIRE_NAMES[i]) &&
+          strncasecmp(codecs, FRAME_WIRE_NAMES[i], name_len) == 0) {
+        return i;
+      }
+    }
+    codecs += len;
+  }
+  return FRAME_WIRE_RAW;
+}
+
+/**
+ * Pick the playlist entry to show from the server's "playlist" list
+ * A new list starts at its first entry; otherwise the next entry comes up
+ * once the current one has been on screen for the interval (seconds)
+ *
+ * @return Hash of the entry, or NULL if the list is empty
+ */
+static const char *FrameUpdate_PickPlaylistEntry(FrameUpdate *u, const ImageInfo *info)
+{
+  UDOUBLE interval_s = info->playlist_interval >= 0 ? info->playlist_interval : PLAYLIST_INTERVAL_S;
+  bool same = info->playlist_len == u->playlist_len;
+  for (uint8_t i = 0; same && i < u->playlist_len; i++) {
+    same = strcmp(info->playlist[i], u->playlist[i]) == 0;
+  }
+  if (!same) {
+    u->playlist_len = info->playlist_len;
+    memcpy(u->playlist, info->playlist, sizeof(u->playlist));
+    u->playlist_pos = 0;
+    u->playlist_shown_ms = DEV_Time_ms();
+    Debug("Playlist: %u entries, %" PRIu32 " s each\n", u->playlist_len, interval_s);
+  } else if (u->playlist_len > 0 && DEV_Time_ms() - u->playlist_shown_ms >= interval_s * 1000) {
+    u->playlist_pos = (u->playlist_pos + 1) % u->playlist_len;
+    u->playlist_shown_ms = DEV_Time_ms();
+  }
+  return u->playlist_len > 0 ? u->playlist[u->playlist_pos] : NULL;
+}
+
+/**
+ * Ask the server what to show, long polling with wait_s: the server may
+ * hold the request until the frame changes from the one on screen
+ *
+ * @return The parsed answer (valid until the next call), NULL on failure
+ */
+static const ImageInfo *FrameUpdate_RequestInfo(FrameUpdate *u, uint32_t wait_s)
+{
+  // Only the battery level rides along; the rest goes out as batched telemetry
+  char path[256];
+  int len;
+  if (u->battery_pct >= 0) {
+    len = snprintf(path, sizeof(path), "/api/image/info?battery=%d" INFO_LAYOUT_PARAM,
+                   u->battery_pct);
+  } else {
+    // USB power mode (battery_pct = -1)
+    len = snprintf(path, sizeof(path), "/api/image/info?battery=usb" INFO_LAYOUT_PARAM);
+  }
+  // The server holds the answer while its current frame is the known one:
+  // that is the one it named last, not the frame on screen, which differs
+  // whenever a playlist rotates
+  if (wait_s) {
+    snprintf(path + len, sizeof(path) - len, "&wait=%" PRIu32 "&known=%s", wait_s,
+             u->server_hash[0] ? u->server_hash : u->last_hash);
+  }
+
+  // Same connection manager as the stream: the socket usually stays open
+  // from this request to the download that follows. The radio sits in
+  // modem sleep while a long poll is held.
+  NET_Stream net;
+  u->info_requests++;
+  if (!NET_Stream_Open(&net, u->host, u->port, path, NULL, INFO_TIMEOUT_MS + wait_s * 1000)) {
+    Debug("Server request failed: no response\n");
+    return NULL;
+  }
+  if (net.status != 200) {
+    Debug("Server request failed: HTTP %d\n", net.status);
+    NET_Stream_Close(&net);
+    return NULL;
+  }
+
+  // Parsed straight off the socket: no body buffer, no String, no heap
+  static ImageInfo info;
+  static ImageInfo_Parser parser;
+  char chunk[128];
+  int n;
+  ImageInfo_Begin(&parser, &info);
+  while ((n = NET_Stream_Read(&net, (UBYTE *)chunk, sizeof(chunk))) > 0 &&
+         ImageInfo_Feed(&parser, chunk, n)) {
+  }
+  NET_Stream_Close(&net);
+  if (!ImageInfo_End(&parser)) {
+    Debug("Malformed server response (%" PRIu32 " bytes)\n", parser.bytes);
+    return NULL;
+  }
+  Debug("Server response: %" PRIu32 " bytes, hash %s, playlist %u, poll %" PRId32 " s\n",
+        parser.bytes, info.hash, info.playlist_len, info.poll_interval);
+  if (info.hash[0]) {
+    strncpy(u->server_hash, info.hash, sizeof(u->server_hash) - 1);
+    u->server_hash[sizeof(u->server_hash) - 1] = '\0';
+  }
+  return &info;
+}
+
+/**
+ * Make hash (from info) the pending frame
+ * It only becomes last_hash once the frame is verified and shown, so a
+ * failed or corrupted download is retried on the next cycle
+ *
+ * @return false if it is already on screen or does not fit the panel
+ */
+static bool FrameUpdate_SetPending(FrameUpdate *u, const ImageInfo *info, const char *hash,
+                                   bool from_playlist)
+{
+  if (strcmp(hash, u->last_hash) == 0) {
+    Debug("No image update needed\n");
+    return false;
+  }
+  if (info->size >= 0 && info->size != (int32_t)FRAME_BYTES) {
+    Debug("Server frame is %" PRId32 " bytes, panel takes %u; update skipped\n",
+          info->size, (unsigned)FRAME_BYTES);
+    return false;
+  }
+  strncpy(u->pending_hash, hash, sizeof(u->pending_hash) - 1);
+  u->pending_hash[sizeof(u->pending_hash) - 1] = '\0';
+  // crc32 describes "hash" only; playlist entries are checked by their MD5
+  strcpy(u->pending_crc, from_playlist ? "" : info->crc32);
+  u->pending_wire = FrameUpdate_PickWire(info->codecs);
+  u->pending_from_playlist = from_playlist;
+  u->pending_path[0] = '\0';
+  return true;
+}
+
+/**
+ * Compares the hash to the frame on screen; the answer also sets the pace
+ * ("poll_interval") and drives the playlist rotation
+ */
+bool FrameUpdate_Check(FrameUpdate *u, uint32_t wait_s)
+{
+  u->next_poll_s = POLL_INTERVAL_S;  // Unless the answer says otherwise
+  UDOUBLE asked_ms = DEV_Time_ms();
+  const ImageInfo *info = FrameUpdate_RequestInfo(u, wait_s);
+  if (!info) {
+    return false;
+  }
+
+  // Server-driven cadence; 0 means ask again right away (long poll), but
+  // only after an answer that was held: an immediate one would spin
+  u->next_poll_s = info->poll_interval >= 0 ? info->poll_interval : POLL_INTERVAL_S;
+  if (u->next_poll_s > POLL_INTERVAL_MAX_S) {
+    u->next_poll_s = POLL_INTERVAL_MAX_S;
+  }
+  if (u->next_poll_s < POLL_INTERVAL_MIN_S && DEV_Time_ms() - asked_ms < POLL_INTERVAL_MIN_S * 1000) {
+    u->next_poll_s = POLL_INTERVAL_MIN_S;
+  }
+
+  // A playlist overrides "hash": its entries rotate, mostly out of the flash cache
+  const char *current_hash = info->hash;
+  const char *entry = FrameUpdate_PickPlaylistEntry(u, info);
+  bool from_playlist = entry && strcmp(entry, current_hash) != 0;
+  if (from_playlist) {
+    current_hash = entry;
+  }
+  if (!current_hash[0]) {
+    Debug("Failed to parse image hash\n");
+    return false;
+  }
+
+  Debug("Current hash: %s\n", current_hash);
+  Debug("Stored hash: %s\n", u->last_hash);
+  if (!FrameUpdate_SetPending(u, info, current_hash, from_playlist)) {
+    return false;
+  }
+  Debug("New image detected: %s\n", current_hash);
+  return true;
+}
+
+void FrameUpdate_BeginConditional(FrameUpdate *u)
+{
+  u->pending_hash[0] = '\0';
+  u->pending_path[0] = '\0';
+  u->pending_crc[0] = '\0';
+  u->pending_from_playlist = false;
+}
+
+bool FrameUpdate_Request(FrameUpdate *u, const char *hash, const char *path)
+{
+  if (strcmp(hash, u->last_hash) == 0) {
+    return false;
+  }
+  strncpy(u->pending_hash, hash, sizeof(u->pending_hash) - 1);
+  u->pending_hash[sizeof(u->pending_hash) - 1] = '\0';
+  strncpy(u->pending_path, path, sizeof(u->pending_path) - 1);
+  u->pending_path[sizeof(u->pending_path) - 1] = '\0';
+  u->pending_crc[0] = '\0';
+  u->pending_wire = FRAME_WIRE_RAW;
+  u->pending_from_playlist = false;
+  return true;
+}
+
+/**
+ * Reopen the frame stream at the given body offset (receive task only)
+ *
+ * @return true once the stream is positioned at offset
+ */
+static bool FrameUpdate_Resume(FrameUpdate_Receiver *rx, size_t offset)
+{
+  NET_Stream_Close(rx->net);
+  if (rx->inflate && (rx->inflate->error || rx->inflate->done)) {
+    return false;  // Body itself is bad or short, a reconnect will not help
+  }
+  while (rx->resumes < FRAME_RESUME_MAX && !rx->cancel.load()) {
+    rx->resumes++;
+    Debug("\nStream dropped at byte %u, resuming (%d/%d)\n",
+          (unsigned)offset, rx->resumes, FRAME_RESUME_MAX);
+    vTaskDelay(pdMS_TO_TICKS(FRAME_RESUME_DELAY * rx->resumes));
+    if (NET_Stream_OpenAt(rx->net, rx->host, rx->port, rx->path,
+                          FRAME_STREAM_HEADERS, offset, FRAME_TIMEOUT_MS)) {
+      if (rx->net->status == 206) return true;
+      Debug("Resume refused: HTTP %d\n", rx->net->status);
+      NET_Stream_Close(rx->net);
+    }
+  }
+  return false;
+}
+
+/**
+ * Next body bytes, inflated first when the server applied a Content-Encoding
+ * Same contract as NET_Stream_Read; rx->received counts bytes on the wire
+ */
+static int FrameUpdate_ReadBody(FrameUpdate_Receiver *rx, UBYTE *dst, UDOUBLE len)
+{
+  if (!rx->inflate) {
+    int n = NET_Stream_Read(rx->net, dst, len);
+    if (n > 0) rx->received += n;
+    return n;
+  }
+
+  while (true) {
+    // The inflater may still owe output with no new input, so ask it first
+    UDOUBLE out = len;
+    UDOUBLE used = FrameInflate_Run(rx->inflate, rx->wire, rx->wire_len, dst, &out);
+    rx->wire += used;
+    rx->wire_len -= used;
+    if (rx->inflate->error) return -1;
+    if (out > 0) return out;
+    if (rx->inflate->done) return 0;
+
+    int n = NET_Stream_Read(rx->net, frame_wire_chunk, sizeof(frame_wire_chunk));
+    if (n <= 0) return n;
+    rx->received += n;
+    rx->wire = frame_wire_chunk;
+    rx->wire_len = n;
+  }
+}
+
+/**
+ * Raw body: fill the ring with reads as large as the free space allows
+ */
+static void FrameUpdate_ReceiveRaw(FrameUpdate_Receiver *rx)
+{
+  size_t remaining = FRAME_BYTES;
+
+  while (remaining > 0 && !rx->cancel.load()) {
+    UDOUBLE space = remaining;
+    uint8_t *dst = LineRing_WritePtr(&rx->ring, &space);
+    if (space == 0) {
+      vTaskDelay(1);  // Ring full: SPI side is behind
+      continue;
+    }
+    int n = FrameUpdate_ReadBody(rx, dst, space);
+    if (n <= 0) {
+      // Connection dropped: pick the body up where it stopped while the
+      // display side keeps the controller's data write open
+      if (rx->resumes >= FRAME_RESUME_MAX || !FrameUpdate_Resume(rx, rx->received)) {
+        rx->failed = true;
+        return;
+      }
+      continue;
+    }
+    FrameCheck_Update(rx->check, dst, n);  // Hashing here overlaps with SPI on core 1
+    LineRing_Produce(&rx->ring, n);
+    remaining -= n;
+    xTaskNotifyGive(rx->consumer);
+  }
+}
+
+/**
+ * Refill frame_body_chunk for the record decoders, resuming a dropped stream
+ *
+ * @return false once the frame is lost (rx->failed is set)
+ */
+static bool FrameUpdate_RefillChunk(FrameUpdate_Receiver *rx, const UBYTE **in, size_t *in_len)
+{
+  while (true) {
+    int n = FrameUpdate_ReadBody(rx, frame_body_chunk, sizeof(frame_body_chunk));
+    if (n > 0) {
+      *in = frame_body_chunk;
+      *in_len = n;
+      return true;
+    }
+    if (rx->resumes >= FRAME_RESUME_MAX || !FrameUpdate_Resume(rx, rx->received)) {
+      rx->failed = true;
+      return false;
+    }
+  }
+}
+
+/**
+ * Publish one decoded record to the display side
+ */
+static void FrameUpdate_ProduceRecord(FrameUpdate_Receiver *rx, const UBYTE *record)
+{
+  FrameCheck_Update(rx->check, record, STREAM_RECORD_BYTES);
+  LineRing_Produce(&rx->ring, STREAM_RECORD_BYTES);
+  xTaskNotifyGive(rx->consumer);
+}
+
+/**
+ * Free ring slot for one whole record, or NULL while the ring is full
+ */
+static uint8_t *FrameUpdate_AcquireRecord(FrameUpdate_Receiver *rx)
+{
+  UDOUBLE space = STREAM_RECORD_BYTES;
+  uint8_t *record = LineRing_WritePtr(&rx->ring, &space);
+  if (space < STREAM_RECORD_BYTES) {
+    vTaskDelay(1);  // Ring full: SPI side is behind
+    return NULL;
+  }
+  return record;
+}
+
+/**
+ * Coded body: decode each record straight into its ring slot
+ * The slot is only published once the decoder has completed it
+ */
+static void FrameUpdate_ReceiveCoded(FrameUpdate_Receiver *rx)
+{
+  const size_t records = FRAME_BYTES / STREAM_RECORD_BYTES;
+  const UBYTE *in = frame_body_chunk;
+  size_t in_len = 0;
+  uint8_t *record = NULL;
+
+  FrameCodec_DecoderInit(&frame_decoder, STREAM_RECORD_BYTES);
+  while (frame_decoder.rows < records && !rx->cancel.load()) {
+    if (!record && !(record = FrameUpdate_AcquireRecord(rx))) continue;
+    if (in_len == 0 && !FrameCodec_Pending(&frame_decoder) && !FrameUpdate_RefillChunk(rx, &in, &in_len)) {
+      return;
+    }
+
+    bool record_done;
+    size_t used = FrameCodec_Decode(&frame_decoder, in, in_len, record, &record_done);
+    in += used;
+    in_len -= used;
+    if (frame_decoder.error) {
+      Debug("\nCoded stream malformed at row %" PRIu32 "\n", frame_decoder.rows);
+      rx->failed = true;
+      return;
+    }
+    if (record_done) {
+      FrameUpdate_ProduceRecord(rx, record);
+      record = NULL;
+    }
+  }
+}
+
+/**
+ * Packed body: expand each 3-bit record into its ring slot
+ * Records split across reads are gathered in frame_packed_record first
+ */
+static void FrameUpdate_ReceivePacked(FrameUpdate_Receiver *rx)
+{
+  const size_t records = FRAME_BYTES / STREAM_RECORD_BYTES;
+  const size_t packed = sizeof(frame_packed_record);
+  const UBYTE *in = frame_body_chunk;
+  size_t in_len = 0;
+  size_t staged = 0;
+  size_t produced = 0;
+  uint8_t *record = NULL;
+
+  while (produced < records && !rx->cancel.load()) {
+    if (!record && !(record = FrameUpdate_AcquireRecord(rx))) continue;
+
+    const UBYTE *src = in;
+    if (staged == 0 && in_len >= packed) {
+      in += packed;  // Whole record in the chunk, unpack in place
+      in_len -= packed;
+    } else {
+      if (in_len == 0 && !FrameUpdate_RefillChunk(rx, &in, &in_len)) return;
+      size_t n = std::min(packed - staged, in_len);
+      memcpy(frame_packed_record + staged, in, n);
+      staged += n;
+      in += n;
+      in_len -= n;
+      if (staged < packed) continue;
+      src = frame_packed_record;
+      staged = 0;
+    }
+
+    FramePack_Unpack(src, record, STREAM_RECORD_BYTES);
+    FrameUpdate_ProduceRecord(rx, record);
+    record = NULL;
+    produced++;
+  }
+}
+
+/**
+ * Exactly len body bytes, resuming a dropped stream
+ *
+ * @return false once the frame is lost (rx->failed is set)
+ */
+static bool FrameUpdate_ReadExact(FrameUpdate_Receiver *rx, UBYTE *dst, size_t len)
+{
+  while (len > 0) {
+    int n = FrameUpdate_ReadBody(rx, dst, len);
+    if (n <= 0) {
+      if (rx->resumes >= FRAME_RESUME_MAX || !FrameUpdate_Resume(rx, rx->received)) {
+        rx->failed = true;
+        return false;
+      }
+      continue;
+    }
+    dst += n;
+    len -= n;
+  }
+  return true;
+}
+
+/**
+ * Advance the rebuilt frame to byte end, from the body or the stored frame
+ */
+static bool FrameUpdate_FillDelta(FrameUpdate_Receiver *rx, size_t *pos, size_t end, bool from_body)
+{
+  while (*pos < end) {
+    if (rx->cancel.load()) return false;
+    UDOUBLE space = end - *pos;
+    UBYTE *dst = LineRing_WritePtr(&rx->ring, &space);
+    if (space == 0) {
+      vTaskDelay(1);  // Ring full: flash side is behind
+      continue;
+    }
+    if (from_body ? !FrameUpdate_ReadExact(rx, dst, space) : !FrameStore_Read(*pos, dst, space)) {
+      rx->failed = true;
+      return false;
+    }
+    FrameCheck_Update(rx->check, dst, space);
+    LineRing_Produce(&rx->ring, space);
+    *pos += space;
+    xTaskNotifyGive(rx->consumer);
+  }
+  return true;
+}
+
+/**
+ * Delta body: the stored frame with changed byte ranges patched in
+ * Body: {u32 offset, u32 length, length bytes}... in ascending offset
+ * order, closed by a zero length (little-endian); bytes between ranges
+ * come from the stored frame
+ */
+static void FrameUpdate_ReceiveDelta(FrameUpdate_Receiver *rx)
+{
+  size_t pos = 0;
+
+  while (true) {
+    UBYTE head[8];
+    if (!FrameUpdate_ReadExact(rx, head, sizeof(head))) return;
+    UDOUBLE offset = head[0] | (head[1] << 8) | (head[2] << 16) | ((UDOUBLE)head[3] << 24);
+    UDOUBLE length = head[4] | (head[5] << 8) | (head[6] << 16) | ((UDOUBLE)head[7] << 24);
+    if (length == 0) break;
+    if (offset < pos || offset > FRAME_BYTES || length > FRAME_BYTES - offset) {
+      Debug("\nDelta range %" PRIu32 "+%" PRIu32 " out of order\n", offset, length);
+      rx->failed = true;
+      return;
+    }
+    if (!FrameUpdate_FillDelta(rx, &pos, offset, false) ||
+        !FrameUpdate_FillDelta(rx, &pos, offset + length, true)) {
+      return;
+    }
+    rx->patched += length;
+  }
+  FrameUpdate_FillDelta(rx, &pos, FRAME_BYTES, false);
+}
+
+/**
+ * Network task: receive the body into the ring in its wire format
+ * Never touches the panel; the display side only sees whole records
+ */
+static void FrameUpdate_ReceiveTask(void *arg)
+{
+  FrameUpdate_Receiver *rx = (FrameUpdate_Receiver *)arg;
+
+  switch (rx->format) {
+  case FRAME_WIRE_ROWOP:
+    FrameUpdate_ReceiveCoded(rx);
+    break;
+  case FRAME_WIRE_PACKED3:
+    FrameUpdate_ReceivePacked(rx);
+    break;
+  case FRAME_WIRE_DELTA:
+    FrameUpdate_ReceiveDelta(rx);
+    break;
+  default:
+    FrameUpdate_ReceiveRaw(rx);
+    break;
+  }
+
+  rx->done.store(true);
+  xTaskNotifyGive(rx->consumer);
+  rx->exited.store(true);
+  vTaskDelete(NULL);
+}
+
+/**
+ * Panel side of a frame: records arrive in stream order (all master lines,
+ * then all slave lines; or whole rows with EPD_DUAL_BUS)
+ */
+static void FrameUpdate_PanelBegin(void)
+{
+#ifdef EPD_DUAL_BUS
+  EPD_13IN3E_BeginFrameDual();
+#else
+  EPD_13IN3E_BeginFrameM();  // Master controller (left half) first
+#endif
+}
+
+static void FrameUpdate_PanelWrite(size_t index, const uint8_t *record)
+{
+#ifdef EPD_DUAL_BUS
+  (void)index;
+  EPD_13IN3E_WriteRow(record);
+#else
+  if (index < PANEL_LINES) {
+    EPD_13IN3E_WriteLineM(record);
+  } else {
+    EPD_13IN3E_WriteLineS(record);
+  }
+  if (index + 1 == PANEL_LINES) {
+    // Slave controller (right half)
+    EPD_13IN3E_Fence();
+    EPD_13IN3E_EndFrameM();
+    EPD_13IN3E_BeginFrameS();
+  }
+#endif
+}
+
+static void FrameUpdate_PanelEnd(void)
+{
+  EPD_13IN3E_Fence();
+#ifdef EPD_DUAL_BUS
+  EPD_13IN3E_EndFrameDual();
+#else
+  EPD_13IN3E_EndFrameS();
+#endif
+}
+
+/**
+ * Power the panel off once a started refresh is over
+ * The prefetch calls this as it goes, so a download that outlasts the
+ * refresh does not keep the panel powered after BUSY is released.
+ *
+ * @param wait Block until BUSY is released instead of returning early
+ */
+static void FrameUpdate_FinishRefresh(FrameUpdate *u, bool wait)
+{
+  if (!u->refresh_pending || (!wait && EPD_13IN3E_Busy())) {
+    return;
+  }
+  u->refresh_pending = false;
+  EPD_13IN3E_RefreshWait();
+  EPD_13IN3E_PowerOff();
+  Debug("Display update complete (%" PRIu32 " ms)\n", (UDOUBLE)(DEV_Time_ms() - u->refresh_start_ms));
+}
+
+/**
+ * Receive one full frame from the HTTP body, into the panel controllers or
+ * into the flash staging slot
+ * A receive task on core 0 keeps reading while this task on core 1 drains
+ * complete lines into the sink, so WiFi stalls and SPI/flash time overlap
+ *
+ * @param net Open HTTP stream positioned at the start of the body
+ * @param path Request path of the stream, used to resume it
+ * @param wire FrameWire format of the body
+ * @param inflate Decoder for the Content-Encoding, NULL if none
+ * @param check Digest fed with every decoded byte
+ * @param to_store Write to FrameStore staging instead of the panel
+ * @return true if the whole frame reached the sink
+ */
+static bool FrameUpdate_Stream(FrameUpdate *u, NET_Stream *net, const char *path, uint8_t wire,
+                               FrameInflate *inflate, FrameCheck *check, bool to_store)
+{
+  memset(&u->stats, 0, sizeof(u->stats));
+  FrameUpdate_Receiver rx;
+  rx.net = net;
+  rx.host = u->host;
+  rx.port = u->port;
+  rx.path = path;
+  rx.format = wire;
+  rx.inflate = inflate;
+  rx.wire = NULL;
+  rx.wire_len = 0;
+  rx.received = 0;
+  rx.check = check;
+  rx.consumer = xTaskGetCurrentTaskHandle();
+  rx.done.store(false);
+  rx.exited.store(false);
+  rx.cancel.store(false);
+  rx.failed = false;
+  rx.resumes = 0;
+  rx.patched = 0;
+  if (!LineRing_Init(&rx.ring, FRAME_RING_BYTES / STREAM_RECORD_BYTES, STREAM_RECORD_BYTES)) {
+    Debug("Frame ring allocation failed\n");
+    return false;
+  }
+  if (xTaskCreatePinnedToCore(FrameUpdate_ReceiveTask, "frame_rx", 4096, &rx,
+                              FRAME_RX_PRIORITY, NULL, FRAME_RX_CORE) != pdPASS) {
+    Debug("Frame receive task failed to start\n");
+    LineRing_Free(&rx.ring);
+    return false;
+  }
+
+  const size_t records = FRAME_BYTES / STREAM_RECORD_BYTES;
+  size_t written = 0;
+
+  if (!to_store) {
+    FrameUpdate_PanelBegin();
+  }
+  while (written < records) {
+    // Panel idle while staging: power it off as soon as its refresh ends
+    if (to_store) {
+      FrameUpdate_FinishRefresh(u, false);
+    }
+    // The producer publishes its last bytes before it flags done, so an
+    // empty ring seen after done means the body ended short
+    bool finished = rx.done.load();
+    const uint8_t *record = LineRing_Peek(&rx.ring);
+    if (!record) {
+      if (finished) {
+        Debug("Stream error at line %d\n", (int)written);
+        break;
+      }
+      ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(10));
+      DEV_Watchdog_Reset();  // Receive side may be reconnecting
+      continue;
+    }
+
+    if (!to_store) {
+      FrameUpdate_PanelWrite(written, record);
+    } else if (!FrameStore_Write(record, STREAM_RECORD_BYTES)) {
+      Debug("Frame store write failed at line %d\n", (int)written);
+      break;
+    }
+    LineRing_Consume(&rx.ring);
+    written++;
+
+    if ((written % 100) == 0) {
+      Debug("Progress: %d%%\r", (int)((written * 100) / records));
+      DEV_Watchdog_Reset();  // Reset watchdog during long download
+    }
+  }
+  if (!to_store) {
+    FrameUpdate_PanelEnd();
+  }
+
+  // A delta body still has its terminator after the last frame byte; a
+  // complete frame lets the receive task read it instead of cutting it off
+  while (written == records && !rx.done.load()) {
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(10));
+    DEV_Watchdog_Reset();
+  }
+
+  // The ring and the stream belong to this frame; stop the task (a read
+  // blocked on the socket gives up within one receive slice) and wait for
+  // it to let go. Once done it reads no more, and a body read to the end
+  // must not be marked aborted: its connection is kept for the next request
+  rx.cancel.store(true);
+  if (!rx.done.load()) {
+    NET_Stream_Abort(net);
+  }
+  UDOUBLE stop_start = DEV_Time_ms();
+  while (!rx.exited.load()) {
+    if (DEV_Time_ms() - stop_start > FRAME_STOP_MS) {
+      // Freeing the ring under a live task would corrupt memory
+      Debug("\nFrame receive task did not stop, restarting\n");
+      esp_restart();
+    }
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(10));
+    DEV_Watchdog_Reset();
+  }
+  Debug("\nFrame ring: peak %" PRIu32 "/%" PRIu32 " bytes, %" PRIu32 " producer stalls, "
+        "%" PRIu32 " consumer stalls\n",
+        rx.ring.high_water, rx.ring.size, rx.ring.producer_stalls, rx.ring.consumer_stalls);
+  u->stats.wire_bytes = rx.received;
+  u->stats.ring_peak = rx.ring.high_water;
+  u->stats.producer_stalls = rx.ring.producer_stalls;
+  u->stats.consumer_stalls = rx.ring.consumer_stalls;
+  u->stats.patched = rx.patched;
+  u->stats.resumes = rx.resumes;
+  if (rx.resumes) {
+    Debug("Frame resumed %d time(s)\n", rx.resumes);
+  }
+  if (wire == FRAME_WIRE_DELTA) {
+    Debug("Delta: %u bytes patched onto the stored frame\n", (unsigned)rx.patched);
+  }
+  if (inflate) {
+    Debug("Inflate: %" PRIu32 " -> %" PRIu32 " bytes, %" PRIu32 " bytes working set\n",
+          inflate->in_total, inflate->out_total, FrameInflate_Footprint());
+  }
+  if (wire != FRAME_WIRE_RAW || inflate) {
+    Debug("Compressed frame: %u bytes on the wire (%u.%02ux)\n", (unsigned)rx.received,
+          rx.received ? (unsigned)(FRAME_BYTES / rx.received) : 0,
+          rx.received ? (unsigned)(FRAME_BYTES * 100 / rx.received % 100) : 0);
+  }
+  LineRing_Free(&rx.ring);
+
+  return written == records && !rx.failed;
+}
+
+/**
+ * Push the committed frame from flash to both panel controllers
+ *
+ * @return true if the whole frame reached the panel
+ */
+static bool FrameUpdate_PushStored(void)
+{
+  static UBYTE chunk[8 * EPD_13IN3E_WIDTH / 4];  // Whole records (8 lines / 4 rows)
+  const size_t per_chunk = sizeof(chunk) / STREAM_RECORD_BYTES;
+  size_t written = 0;
+  bool ok = true;
+
+  FrameUpdate_PanelBegin();
+  for (size_t offset = 0; offset < FRAME_BYTES; offset += sizeof(chunk)) {
+    if (!FrameStore_Read(offset, chunk, sizeof(chunk))) {
+      Debug("Frame store read failed at byte %u\n", (unsigned)offset);
+      ok = false;
+      break;
+    }
+    for (size_t i = 0; i < per_chunk; i++) {
+      FrameUpdate_PanelWrite(written++, chunk + i * STREAM_RECORD_BYTES);
+    }
+    if ((written % 400) == 0) {
+      DEV_Watchdog_Reset();
+    }
+  }
+  FrameUpdate_PanelEnd();
+  return ok;
+}
+
+void FrameUpdate_Redraw(void)
+{
+  Debug("Redrawing stored frame...\n");
+  EPD_13IN3E_PowerOn();
+  EPD_13IN3E_Init();
+  if (FrameUpdate_PushStored()) {
+    EPD_13IN3E_RefreshNow();
+  }
+  EPD_13IN3E_PowerOff();
+}
+
+/**
+ * Copy an ETag value without W/ prefix and quotes
+ *
+ * @return false if the header is missing or empty
+ */
+static bool FrameUpdate_ParseETag(const char *etag, char *dst, size_t size)
+{
+  if (!etag) return false;
+  if (strncmp(etag, "W/", 2) == 0) etag += 2;
+  if (*etag == '"') etag++;
+  size_t len = 0;
+  while (etag[len] && etag[len] != '"' && etag[len] != '\r' && len < size - 1) {
+    dst[len] = etag[len];
+    len++;
+  }
+  dst[len] = '\0';
+  return len > 0;
+}
+
+/**
+ * Download the pending frame, into the frame store when there is one
+ * Without a store the frame goes straight into the controllers, which are
+ * left powered for the refresh (*in_panel). A prefetch only ever uses the
+ * store and leaves the frame on screen current.
+ *
+ * @return true if the frame arrived complete and verified
+ */
+static bool FrameUpdate_Fetch(FrameUpdate *u, bool prefetch, bool *in_panel)
+{
+  *in_panel = false;
+  if (prefetch && !FrameStore_Ready()) {
+    return false;
+  }
+
+  NET_Stream net;
+  NET_Stream_ResetStats();
+  // Offer a delta against the stored frame; the server may still send it whole
+  const char *base = FrameStore_Ready() ? FrameStore_Hash() : "";
+  char path[160];
+  int len = snprintf(path, sizeof(path), "%s", u->pending_path[0] ? u->pending_path : FRAME_STREAM_PATH);
+  char sep = strchr(path, '?') ? '&' : '?';
+  if (u->pending_from_playlist) {
+    len += snprintf(path + len, sizeof(path) - len, "%chash=%s", sep, u->pending_hash);
+    sep = '&';
+  }
+  if (u->pending_wire != FRAME_WIRE_RAW) {
+    len += snprintf(path + len, sizeof(path) - len, "%ccodec=%s", sep, FRAME_WIRE_NAMES[u->pending_wire]);
+    sep = '&';
+  }
+  if (base[0]) {
+    snprintf(path + len, sizeof(path) - len, "%cbase=%s", sep, base);
+  }
+  // Conditional mode: the frame on screen is the entity tag, and the
+  // ETag of a 200 response names the new frame
+  char headers[96];
+  snprintf(headers, sizeof(headers), FRAME_STREAM_HEADERS);
+  if (u->conditional && u->last_hash[0]) {
+    snprintf(headers + strlen(headers), sizeof(headers) - strlen(headers),
+             "If-None-Match: \"%s\"\r\n", u->last_hash);
+  }
+  // A prefetch gets its headers within the info timeout, then polls BUSY
+  if (!NET_Stream_Open(&net, u->host, u->port, path, headers,
+                       prefetch ? INFO_TIMEOUT_MS : FRAME_TIMEOUT_MS)) {
+    Debug("Image download failed: no response\n");
+    return false;
+  }
+  if (u->conditional && net.status == 304) {
+    Debug("No image update needed (304)\n");
+    NET_Stream_Close(&net);
+    return false;
+  }
+  if (net.status != 200) {
+    Debug("Image download failed: HTTP %d\n", net.status);
+    NET_Stream_Close(&net);
+    return false;
+  }
+  if (u->conditional) {
+    if (!FrameUpdate_ParseETag(NET_Stream_Header(&net, "ETag"), u->pending_hash, sizeof(u->pending_hash))) {
+      Debug("Image download failed: no ETag\n");
+      NET_Stream_Close(&net);
+      return false;
+    }
+    if (strcmp(u->pending_hash, u->last_hash) == 0) {
+      Debug("No image update needed (ETag)\n");
+      NET_Stream_Close(&net);
+      return false;
+    }
+    // Frames seen before need no body at all
+    if (FrameStore_Contains(u->pending_hash)) {
+      NET_Stream_Close(&net);
+      Debug("Frame %s found in flash cache\n", u->pending_hash);
+      return !prefetch && FrameStore_Select(u->pending_hash);
+    }
+    Debug("New image detected: %s\n", u->pending_hash);
+  }
+
+  // An advertised crc32 that cannot be parsed is an error, not "unverified"
+  FrameCheck check;
+  if (!FrameCheck_Begin(&check, u->pending_hash, u->pending_crc)) {
+    Debug("Image download failed: malformed crc32\n");
+    NET_Stream_Close(&net);
+    return false;
+  }
+
+  // The server confirms the codec; without the header the body is raw lines
+  const char *codec = NET_Stream_Header(&net, "X-Frame-Codec");
+  const char *requested = FRAME_WIRE_NAMES[u->pending_wire];
+  uint8_t wire = FRAME_WIRE_RAW;
+  if (u->pending_wire != FRAME_WIRE_RAW && codec &&
+      strncasecmp(codec, requested, strlen(requested)) == 0) {
+    wire = u->pending_wire;
+  }
+  const char *delta = NET_Stream_Header(&net, "X-Frame-Delta");
+  if (base[0] && delta && strncasecmp(delta, base, strlen(base)) == 0) {
+    wire = FRAME_WIRE_DELTA;
+  }
+
+  // Content-Encoding is applied on top (typically by a reverse proxy)
+  FrameInflate inflate;
+  FrameInflate *inflater = NULL;
+  const char *encoding = NET_Stream_Header(&net, "Content-Encoding");
+  if (encoding && strncasecmp(encoding, "identity", 8) != 0) {
+    bool gzip = strncasecmp(encoding, "gzip", 4) == 0 || strncasecmp(encoding, "x-gzip", 6) == 0;
+    if (!gzip && strncasecmp(encoding, "deflate", 7) != 0) {
+      Debug("Image download failed: unsupported Content-Encoding\n");
+      NET_Stream_Close(&net);
+      return false;
+    }
+    if (!FrameInflate_Begin(&inflate, gzip ? FRAME_INFLATE_GZIP : FRAME_INFLATE_ZLIB)) {
+      Debug("Image download failed: no memory for inflate\n");
+      NET_Stream_Close(&net);
+      return false;
+    }
+    inflater = &inflate;
+  }
+  Debug("Downloading image (%s%s)...\n", FRAME_WIRE_NAMES[wire],
+        inflater ? (inflate.format == FRAME_INFLATE_GZIP ? ", gzip" : ", deflate") : "");
+
+  // With a frame store the download only touches flash; the panel is fed
+  // from there once the frame is verified and committed
+  bool staged = FrameStore_BeginStaging();
+  if (prefetch && !staged) {
+    NET_Stream_Close(&net);
+    if (inflater) {
+      FrameInflate_End(inflater);
+    }
+    return false;
+  }
+
+  if (!staged) {
+    EPD_13IN3E_PowerOn();
+    EPD_13IN3E_Init();
+  }
+  DEV_SPI_ResetStats();
+  UDOUBLE transfer_start = DEV_Time_ms();
+
+  bool complete = FrameUpdate_Stream(u, &net, path, wire, inflater, &check, staged);
+
+  NET_Stream_Close(&net);
+  if (inflater) {
+    FrameInflate_End(inflater);
+  }
+
+  UDOUBLE transfer_ms = DEV_Time_ms() - transfer_start;
+  DEV_SPI_Stats spi_stats = DEV_SPI_GetStats();
+  NET_Stream_Stats net_stats = NET_Stream_GetStats();
+  Debug("\nFrame transfer: %" PRIu32 " SPI bytes in %" PRIu32 " transactions (%" PRIu32 " ms, %" PRIu32 " KB/s)\n",
+        spi_stats.bytes, spi_stats.transactions, transfer_ms,
+        transfer_ms ? net_stats.bytes / transfer_ms : 0);
+  Debug("Network: %" PRIu32 " body bytes, %" PRIu32 " recv calls, %" PRIu32 " via header residue, "
+        "%" PRIu32 " re-sent\n",
+        net_stats.bytes, net_stats.recv_calls, net_stats.residue_bytes, net_stats.skipped_bytes);
+
+  if (!complete) {
+    Debug("Incomplete data transfer\n");
+    if (!staged) {
+      EPD_13IN3E_PowerOff();
+    }
+    return false;
+  }
+
+  bool verified = FrameCheck_Verify(&check);
+  Debug("Frame check: %s over %" PRIu32 " bytes, %" PRIu32 " us (%u ns/byte)\n",
+        FrameCheck_ModeName(&check), check.bytes, check.busy_us,
+        check.bytes ? (unsigned)((uint64_t)check.busy_us * 1000 / check.bytes) : 0);
+  if (!verified) {
+    // Staging (or controller RAM) holds a bad frame; leave the screen as it is
+    Debug("Frame corrupted, refresh skipped (retry next cycle)\n");
+    if (!staged) {
+      EPD_13IN3E_PowerOff();
+    }
+    return false;
+  }
+
+  if (staged && !FrameStore_Commit(u->pending_hash, !prefetch)) {
+    Debug("Frame store commit failed\n");
+    return false;
+  }
+  *in_panel = !staged;
+  return true;
+}
+
+/**
+ * Stage the frame expected after the one being refreshed
+ * The next playlist entry, or whatever /api/image/info announces now.
+ * Runs while the panel is busy, so the next update is a flash push only.
+ */
+static void FrameUpdate_Prefetch(FrameUpdate *u)
+{
+  if (u->playlist_len > 1) {
+    const char *next = u->playlist[(u->playlist_pos + 1) % u->playlist_len];
+    if (FrameStore_Contains(next)) return;
+    strncpy(u->pending_hash, next, sizeof(u->pending_hash) - 1);
+    u->pending_hash[sizeof(u->pending_hash) - 1] = '\0';
+    u->pending_crc[0] = '\0';
+    u->pending_path[0] = '\0';
+    u->pending_from_playlist = true;
+  } else if (u->conditional) {
+    FrameUpdate_BeginConditional(u);
+  } else {
+    // Only the download target changes: the poll cadence and the playlist
+    // rotation are left to the next cycle's own request
+    const ImageInfo *info = FrameUpdate_RequestInfo(u, 0);
+    if (!info || info->playlist_len > 0 || !info->hash[0] ||
+        !FrameUpdate_SetPending(u, info, info->hash, false) || FrameStore_Contains(u->pending_hash)) {
+      return;
+    }
+  }
+
+  Debug("Prefetching %s during refresh\n", u->pending_hash[0] ? u->pending_hash : "next frame");
+  bool in_panel;
+  if (FrameUpdate_Fetch(u, true, &in_panel)) {
+    Debug("Prefetched frame cached in flash\n");
+  }
+}
+
+/**
+ * Refresh the panel from controller RAM, prefetching while BUSY is held
+ * The controllers must be powered and loaded; they are powered off after.
+ */
+static void FrameUpdate_Refresh(FrameUpdate *u)
+{
+  Debug("\nRefreshing display...\n");
+  u->refresh_start_ms = DEV_Time_ms();
+  EPD_13IN3E_RefreshStart();
+  u->refresh_pending = true;
+  if (u->prefetch && FrameStore_Ready() && EPD_13IN3E_Busy()) {
+    FrameUpdate_Prefetch(u);
+    Debug("Prefetch done %" PRIu32 " ms into the refresh\n", (UDOUBLE)(DEV_Time_ms() - u->refresh_start_ms));
+  }
+  FrameUpdate_FinishRefresh(u, true);
+}
+
+/**
+ * Push the current stored frame to the panel and refresh it
+ *
+ * @return true if the frame reached the panel
+ */
+static bool FrameUpdate_ShowStored(FrameUpdate *u)
+{
+  UDOUBLE push_start = DEV_Time_ms();
+  EPD_13IN3E_PowerOn();
+  EPD_13IN3E_Init();
+  if (!FrameUpdate_PushStored()) {
+    EPD_13IN3E_PowerOff();
+    return false;
+  }
+  Debug("Frame pushed from flash in %" PRIu32 " ms\n", (UDOUBLE)(DEV_Time_ms() - push_start));
+  strcpy(u->last_hash, FrameStore_Hash());
+  FrameUpdate_Refresh(u);
+  // Only a frame that made it to the screen is restored after a reboot
+  if (!FrameStore_MarkCurrent()) {
+    Debug("Frame store: could not record the frame on screen\n");
+  }
+  return true;
+}
+
+bool FrameUpdate_Show(FrameUpdate *u)
+{
+  // Frames seen before (or prefetched) are in the flash cache: no download at all
+  if (FrameStore_Select(u->pending_hash)) {
+    Debug("Frame %s found in flash cache\n", u->pending_hash);
+    return FrameUpdate_ShowStored(u);
+  }
+
+  DEV_Trace_Begin();
+  bool in_panel;
+  bool shown = FrameUpdate_Fetch(u, false, &in_panel);
+  if (shown && in_panel) {
+    strcpy(u->last_hash, u->pending_hash);
+    FrameUpdate_Refresh(u);
+  } else if (shown) {
+    shown = FrameUpdate_ShowStored(u);
+  }
+  DEV_Trace_End();
+  if (shown) {
+    DEV_Trace_Dump();
+  }
+  return shown;
+}
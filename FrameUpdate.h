@@ -0,0 +1,111 @@
+/**
+ * Frame Update State Machine
+ *
+ * Poll, fetch and display: ask /api/image/info whether another frame is
+ * due (or the stream itself, conditionally), download it through a receive
+ * task and a line ring into the panel or the flash frame store, verify it,
+ * then refresh, prefetching the next frame while BUSY is held. The sketch
+ * owns the WiFi, the sleep and the telemetry; everything between "is there
+ * news" and "frame on screen" is here, so the whole path also runs on the
+ * host against a loopback server.
+ *
+ * @author Stephane Bhiri
+ * @version 2.0
+ * @date January 2025
+ */
+
+#ifndef FRAME_UPDATE_H
+#define FRAME_UPDATE_H
+
+#include "DEV_Config.h"
+#include "EPD_13in3e.h"
+#include "ImageInfo.h"
+
+#ifdef EPD_DUAL_BUS
+// Server sends the frame row by row; each 600-byte row feeds both controllers
+#define FRAME_UPDATE_RECORD_BYTES (EPD_13IN3E_WIDTH / 2)
+#else
+// Default layout: whole master half, then whole slave half, 300-byte lines
+#define FRAME_UPDATE_RECORD_BYTES (EPD_13IN3E_WIDTH / 4)
+#endif
+#define FRAME_UPDATE_BYTES  ((UDOUBLE)EPD_13IN3E_WIDTH / 2 * EPD_13IN3E_HEIGHT)
+
+// Poll cadence
+#define POLL_INTERVAL_S     15     // Unless the server says otherwise
+#define POLL_INTERVAL_MIN_S 2      // Floor for an answer the server did not hold
+#define POLL_INTERVAL_MAX_S 3600
+#define PLAYLIST_INTERVAL_S 600    // Default time per playlist entry
+
+// Stream wire formats, offered through the "codecs" list of /api/image/info
+enum FrameWire {
+  FRAME_WIRE_RAW = 0,       // 4bpp records exactly as the panel takes them
+  FRAME_WIRE_ROWOP,         // Row-opcode coded (FrameCodec.h)
+  FRAME_WIRE_PACKED3,       // 3 bits per pixel (FramePack.h)
+  FRAME_WIRE_DELTA,         // Changed ranges against the stored frame (not in "codecs")
+};
+
+// Counters of the last download (logged, and read back by the host tests)
+typedef struct {
+  UDOUBLE  wire_bytes;           // Body bytes off the socket
+  UDOUBLE  ring_peak;            // Line ring high-water mark (bytes)
+  UDOUBLE  producer_stalls;      // Receive task found the ring full
+  UDOUBLE  consumer_stalls;      // Display side found it empty
+  UDOUBLE  patched;              // Delta bytes taken from the body
+  uint8_t  resumes;              // Reconnects with a Range request
+} FrameUpdate_Stats;
+
+typedef struct {
+  // Set by the caller
+  const char* host;              // Server, must outlive the update
+  uint16_t port;
+  bool     prefetch;             // Download the next frame while the panel refreshes
+  bool     conditional;          // Poll the stream with If-None-Match instead of the info endpoint
+  int      battery_pct;          // Sent with the info request, -1 on USB power
+
+  char     last_hash[33];        // Frame on screen
+  char     server_hash[33];      // Current frame as the info endpoint last named it
+  char     pending_hash[33];     // Advertised by the server, not yet on screen
+  char     pending_crc[12];      // Optional CRC32 (hex) of the same frame
+  uint8_t  pending_wire;         // FrameWire to request
+  bool     pending_from_playlist;// Requested with hash=, not the server's current image
+  char     pending_path[96];     // Stream path named by a wake notice, "" for the default
+
+  // Rotation through frames the server lists in "playlist" (cached in the frame store)
+  char     playlist[IMAGE_INFO_PLAYLIST_MAX][IMAGE_INFO_HASH_MAX];
+  uint8_t  playlist_len;
+  uint8_t  playlist_pos;
+  UDOUBLE  playlist_shown_ms;
+
+  UDOUBLE  next_poll_s;          // From "poll_interval" of the last info response
+  UDOUBLE  info_requests;
+  bool     refresh_pending;      // DRF sent, POF still due
+  UDOUBLE  refresh_start_ms;
+  FrameUpdate_Stats stats;
+} FrameUpdate;
+
+// Clear all state; the server and the options are set afterwards
+void FrameUpdate_Init(FrameUpdate* u, const char* host, uint16_t port);
+
+// Wire format to request, from the server's "codecs" list
+uint8_t FrameUpdate_PickWire(const char* codecs);
+
+// Ask the info endpoint (held up to wait_s as a long poll, until its hash
+// differs from server_hash). Sets the pace (next_poll_s), drives the
+// playlist and makes a new frame pending. True if one is.
+bool FrameUpdate_Check(FrameUpdate* u, uint32_t wait_s);
+
+// Pending frame for a conditional poll: only known once the ETag arrives
+void FrameUpdate_BeginConditional(FrameUpdate* u);
+
+// Make hash pending, fetched from path ("" for the usual stream request),
+// as named by a wake notice. False if it is already on screen.
+bool FrameUpdate_Request(FrameUpdate* u, const char* hash, const char* path);
+
+// Show the pending frame: from the flash cache, or downloaded and verified.
+// True once it is on screen (last_hash).
+bool FrameUpdate_Show(FrameUpdate* u);
+
+// Offline redraw of the committed frame (after the config screen)
+void FrameUpdate_Redraw(void);
+
+#endif
@@ -0,0 +1,320 @@
+#include "ImageInfo.h"
+
+enum {
+  INFO_START,          // Before the top-level '{'
+  INFO_KEY_WAIT,       // Expecting a key or '}'
+  INFO_KEY,
+  INFO_KEY_ESC,
+  INFO_COLON,
+  INFO_VALUE_WAIT,
+  INFO_STRING,
+  INFO_STRING_ESC,
+  INFO_BARE,           // Number, true, false, null
+  INFO_LIST,           // Inside the "playlist" array, between entries
+  INFO_LIST_STRING,
+  INFO_LIST_ESC,
+  INFO_SKIP,           // Inside a nested object/array
+  INFO_SKIP_STRING,
+  INFO_SKIP_ESC,
+  INFO_NEXT,           // Expecting ',' or '}'
+  INFO_DONE,
+  INFO_ERROR,
+};
+
+static bool ImageInfo_Space(char c)
+{
+  return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+static void ImageInfo_Copy(char *dst, size_t size, const char *src)
+{
+  strncpy(dst, src, size - 1);
+  dst[size - 1] = '\0';
+}
+
+static int32_t ImageInfo_Number(const char *value)
+{
+  return (value[0] >= '0' && value[0] <= '9') ? (int32_t)strtol(value, NULL, 10) : -1;
+}
+
+// Comma-separated hashes, blanks around entries ignored
+static void ImageInfo_Playlist(ImageInfo *info, const char *list)
+{
+  info->playlist_len = 0;
+  while (*list && info->playlist_len < IMAGE_INFO_PLAYLIST_MAX) {
+    while (*list == ' ' || *list == ',') list++;
+    size_t len = 0;
+    while (list[len] && list[len] != ',' && list[len] != ' ') len++;
+    if (len > 0 && len < IMAGE_INFO_HASH_MAX) {
+      memcpy(info->playlist[info->playlist_len], list, len);
+      info->playlist[info->playlist_len][len] = '\0';
+      info->playlist_len++;
+    }
+    list += len;
+  }
+}
+
+// One string entry of the "playlist" array; overlong ones are dropped
+static void ImageInfo_PlaylistEntry(ImageInfo_Parser *p)
+{
+  ImageInfo *info = p->info;
+  if (p->value_len > 0 && p->value_len < IMAGE_INFO_HASH_MAX &&
+      info->playlist_len < IMAGE_INFO_PLAYLIST_MAX) {
+    memcpy(info->playlist[info->playlist_len], p->value, p->value_len);
+    info->playlist[info->playlist_len][p->value_len] = '\0';
+    info->playlist_len++;
+  }
+}
+
+static void ImageInfo_Member(ImageInfo_Parser *p)
+{
+  ImageInfo *info = p->info;
+  const char *key = p->key;
+  const char *value = p->value;
+  // Numbers may come quoted; strings may not come bare ("hash": null)
+  if (!p->quoted && (strcmp(key, "hash") == 0 || strcmp(key, "crc32") == 0 ||
+                     strcmp(key, "codecs") == 0 || strcmp(key, "playlist") == 0)) {
+    return;
+  }
+  if (strcmp(key, "hash") == 0) {
+    ImageInfo_Copy(info->hash, sizeof(info->hash), value);
+  } else if (strcmp(key, "crc32") == 0) {
+    ImageInfo_Copy(info->crc32, sizeof(info->crc32), value);
+  } else if (strcmp(key, "codecs") == 0) {
+    ImageInfo_Copy(info->codecs, sizeof(info->codecs), value);
+  } else if (strcmp(key, "playlist") == 0) {
+    ImageInfo_Playlist(info, value);
+  } else if (strcmp(key, "playlist_interval") == 0) {
+    info->playlist_interval = ImageInfo_Number(value);
+  } else if (strcmp(key, "poll_interval") == 0) {
+    info->poll_interval = ImageInfo_Number(value);
+  } else if (strcmp(key, "size") == 0) {
+    info->size = ImageInfo_Number(value);
+  }
+}
+
+void ImageInfo_Begin(ImageInfo_Parser *p, ImageInfo *info)
+{
+  memset(info, 0, sizeof(*info));
+  info->playlist_interval = -1;
+  info->poll_interval = -1;
+  info->size = -1;
+  p->info = info;
+  p->state = INFO_START;
+  p->depth = 0;
+  p->quoted = false;
+  p->list = false;
+  p->key_len = 0;
+  p->value_len = 0;
+  p->bytes = 0;
+}
+
+// Characters past the buffer are dropped; the value is then cut short
+static void ImageInfo_Push(char *buf, UWORD *len, size_t size, char c)
+{
+  if (*len < size - 1) {
+    buf[(*len)++] = c;
+  }
+}
+
+static char ImageInfo_Unescape(char c)
+{
+  switch (c) {
+    case 'n': return '\n';
+    case 't': return '\t';
+    case 'r': return '\r';
+    case 'b': return '\b';
+    case 'f': return '\f';
+    case 'u': return '?';   // \uXXXX: the hex digits follow as plain text
+    default:  return c;     // \" \\ \/
+  }
+}
+
+static void ImageInfo_EndValue(ImageInfo_Parser *p)
+{
+  p->value[p->value_len] = '\0';
+  if (p->key_len < IMAGE_INFO_KEY_MAX) {
+    ImageInfo_Member(p);
+  }
+  p->state = INFO_NEXT;
+}
+
+bool ImageInfo_Feed(ImageInfo_Parser *p, const char *data, size_t len)
+{
+  for (size_t i = 0; i < len && p->state != INFO_ERROR; i++) {
+    char c = data[i];
+    p->bytes++;
+    switch (p->state) {
+      case INFO_START:
+        if (c == '{') {
+          p->depth = 1;
+          p->state = INFO_KEY_WAIT;
+        } else if (!ImageInfo_Space(c)) {
+          p->state = INFO_ERROR;
+        }
+        break;
+
+      case INFO_KEY_WAIT:
+        if (c == '"') {
+          p->key_len = 0;
+          p->state = INFO_KEY;
+        } else if (c == '}') {
+          p->state = INFO_DONE;
+        } else if (!ImageInfo_Space(c)) {
+          p->state = INFO_ERROR;
+        }
+        break;
+
+      case INFO_KEY:
+        if (c == '"') {
+          p->key[p->key_len < IMAGE_INFO_KEY_MAX ? p->key_len : IMAGE_INFO_KEY_MAX - 1] = '\0';
+          p->state = INFO_COLON;
+        } else if (c == '\\') {
+          p->state = INFO_KEY_ESC;
+        } else if (p->key_len < IMAGE_INFO_KEY_MAX) {
+          p->key[p->key_len++] = c;   // key_len == KEY_MAX marks a skipped key
+        }
+        break;
+
+      case INFO_KEY_ESC:
+        if (p->key_len < IMAGE_INFO_KEY_MAX) {
+          p->key[p->key_len++] = ImageInfo_Unescape(c);
+        }
+        p->state = INFO_KEY;
+        break;
+
+      case INFO_COLON:
+        if (c == ':') {
+          p->state = INFO_VALUE_WAIT;
+        } else if (!ImageInfo_Space(c)) {
+          p->state = INFO_ERROR;
+        }
+        break;
+
+      case INFO_VALUE_WAIT:
+        p->value_len = 0;
+        if (c == '"') {
+          p->quoted = true;
+          p->state = INFO_STRING;
+        } else if (c == '[' && p->key_len < IMAGE_INFO_KEY_MAX &&
+                   strcmp(p->key, "playlist") == 0) {
+          p->info->playlist_len = 0;
+          p->list = true;
+          p->state = INFO_LIST;
+        } else if (c == '{' || c == '[') {
+          p->depth++;
+          p->state = INFO_SKIP;
+        } else if (!ImageInfo_Space(c)) {
+          p->quoted = false;
+          ImageInfo_Push(p->value, &p->value_len, sizeof(p->value), c);
+          p->state = INFO_BARE;
+        }
+        break;
+
+      case INFO_STRING:
+        if (c == '"') {
+          ImageInfo_EndValue(p);
+        } else if (c == '\\') {
+          p->state = INFO_STRING_ESC;
+        } else {
+          ImageInfo_Push(p->value, &p->value_len, sizeof(p->value), c);
+        }
+        break;
+
+      case INFO_STRING_ESC:
+        ImageInfo_Push(p->value, &p->value_len, sizeof(p->value), ImageInfo_Unescape(c));
+        p->state = INFO_STRING;
+        break;
+
+      case INFO_BARE:
+        if (c == ',' || c == '}' || ImageInfo_Space(c)) {
+          ImageInfo_EndValue(p);
+          if (c == ',') {
+            p->state = INFO_KEY_WAIT;
+          } else if (c == '}') {
+            p->state = INFO_DONE;
+          }
+        } else {
+          ImageInfo_Push(p->value, &p->value_len, sizeof(p->value), c);
+        }
+        break;
+
+      // Bare entries have no quotes or brackets, so their characters
+      // (and the commas between entries) are simply passed over
+      case INFO_LIST:
+        if (c == '"') {
+          p->value_len = 0;
+          p->state = INFO_LIST_STRING;
+        } else if (c == '{' || c == '[') {
+          p->depth++;
+          p->state = INFO_SKIP;
+        } else if (c == ']') {
+          p->list = false;
+          p->state = INFO_NEXT;
+        } else if (c == '}') {
+          p->state = INFO_ERROR;
+        }
+        break;
+
+      case INFO_LIST_STRING:
+        if (c == '"') {
+          ImageInfo_PlaylistEntry(p);
+          p->state = INFO_LIST;
+        } else if (c == '\\') {
+          p->state = INFO_LIST_ESC;
+        } else {
+          ImageInfo_Push(p->value, &p->value_len, sizeof(p->value), c);
+        }
+        break;
+
+      case INFO_LIST_ESC:
+        ImageInfo_Push(p->value, &p->value_len, sizeof(p->value), ImageInfo_Unescape(c));
+        p->state = INFO_LIST_STRING;
+        break;
+
+      case INFO_SKIP:
+        if (c == '"') {
+          p->state = INFO_SKIP_STRING;
+        } else if (c == '{' || c == '[') {
+          if (++p->depth == 0) p->state = INFO_ERROR;  // Absurd nesting
+        } else if (c == '}' || c == ']') {
+          if (--p->depth == 1) p->state = p->list ? INFO_LIST : INFO_NEXT;
+        }
+        break;
+
+      case INFO_SKIP_STRING:
+        if (c == '"') {
+          p->state = INFO_SKIP;
+        } else if (c == '\\') {
+          p->state = INFO_SKIP_ESC;
+        }
+        break;
+
+      case INFO_SKIP_ESC:
+        p->state = INFO_SKIP_STRING;
+        break;
+
+      case INFO_NEXT:
+        if (c == ',') {
+          p->state = INFO_KEY_WAIT;
+        } else if (c == '}') {
+          p->state = INFO_DONE;
+        } else if (!ImageInfo_Space(c)) {
+          p->state = INFO_ERROR;
+        }
+        break;
+
+      case INFO_DONE:
+        if (!ImageInfo_Space(c)) {
+          p->state = INFO_ERROR;
+        }
+        break;
+    }
+  }
+  return p->state != INFO_ERROR;
+}
+
+bool ImageInfo_End(ImageInfo_Parser *p)
+{
+  return p->state == INFO_DONE;
+}
\ No newline at end of file
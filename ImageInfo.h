@@ -0,0 +1,65 @@
+/**
+ * Streaming /api/image/info Parser
+ *
+ * Allocation-free tokenizer for the info response. Bytes are fed as they
+ * come off the socket; top-level members are decoded into a fixed
+ * ImageInfo struct and nested objects/arrays are skipped, so no part of
+ * the body is ever buffered as a whole and nothing touches the heap.
+ *
+ * Numeric fields take string and bare values alike, so "poll_interval": 0
+ * and "poll_interval": "0" mean the same. String fields (hash, crc32,
+ * codecs, playlist) only take strings: "hash": null leaves the field empty
+ * rather than reading as the hash "null".
+ *
+ * "playlist" is either one comma-separated string or an array of strings;
+ * numbers and other bare entries of the array are ignored, and so are
+ * nested containers.
+ *
+ * @author Stephane Bhiri
+ * @version 2.0
+ * @date January 2025
+ */
+
+#ifndef IMAGE_INFO_H
+#define IMAGE_INFO_H
+
+#include "DEV_Config.h"
+
+#define IMAGE_INFO_HASH_MAX      33    // 32 hex chars + NUL
+#define IMAGE_INFO_PLAYLIST_MAX  8
+#define IMAGE_INFO_KEY_MAX       24    // Longer keys are skipped
+#define IMAGE_INFO_VALUE_MAX     (IMAGE_INFO_PLAYLIST_MAX * IMAGE_INFO_HASH_MAX + 8)
+
+typedef struct {
+  char    hash[IMAGE_INFO_HASH_MAX];
+  char    crc32[12];                 // "" when absent; room to tell an overlong value
+  char    codecs[48];                // Wire formats in order of preference
+  char    playlist[IMAGE_INFO_PLAYLIST_MAX][IMAGE_INFO_HASH_MAX];
+  UBYTE   playlist_len;
+  int32_t playlist_interval;         // Seconds, -1 when absent
+  int32_t poll_interval;             // Seconds, -1 when absent
+  int32_t size;                      // Decoded frame bytes, -1 when absent
+} ImageInfo;
+
+typedef struct {
+  ImageInfo* info;
+  UBYTE   state;
+  UBYTE   depth;                     // Container nesting, 1 inside the top object
+  bool    quoted;                    // Current value is a string
+  bool    list;                      // Inside the "playlist" array
+  UWORD   key_len;
+  UWORD   value_len;
+  UDOUBLE bytes;
+  char    key[IMAGE_INFO_KEY_MAX];
+  char    value[IMAGE_INFO_VALUE_MAX];
+} ImageInfo_Parser;
+
+void ImageInfo_Begin(ImageInfo_Parser* p, ImageInfo* info);
+
+// False on malformed JSON (the rest of the body can be dropped)
+bool ImageInfo_Feed(ImageInfo_Parser* p, const char* data, size_t len);
+
+// True if a complete top-level object was seen
+bool ImageInfo_End(ImageInfo_Parser* p);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,66 @@
+#include "LineRing.h"
+
+bool LineRing_Init(LineRing *ring, UDOUBLE records, UDOUBLE record_size)
+{
+  ring->size = records * record_size;
+  ring->record = record_size;
+  ring->buf = (UBYTE *)malloc(ring->size);
+  ring->head.store(0, std::memory_order_relaxed);
+  ring->tail.store(0, std::memory_order_relaxed);
+  ring->high_water = 0;
+  ring->producer_stalls = 0;
+  ring->consumer_stalls = 0;
+  ring->producer_waiting = false;
+  ring->consumer_waiting = false;
+  return ring->buf != NULL;
+}
+
+void LineRing_Free(LineRing *ring)
+{
+  free(ring->buf);
+  ring->buf = NULL;
+}
+
+UBYTE *LineRing_WritePtr(LineRing *ring, UDOUBLE *len)
+{
+  UDOUBLE head = ring->head.load(std::memory_order_relaxed);
+  UDOUBLE tail = ring->tail.load(std::memory_order_acquire);
+  UDOUBLE used = head - tail;
+  UDOUBLE offset = head % ring->size;
+
+  // Free bytes up to the wrap point; the rest is offered on the next call
+  UDOUBLE space = ring->size - used;
+  if (space > ring->size - offset) space = ring->size - offset;
+  if (*len > space) *len = space;
+  if (*len == 0 && !ring->producer_waiting) ring->producer_stalls++;
+  ring->producer_waiting = *len == 0;
+  return ring->buf + offset;
+}
+
+void LineRing_Produce(LineRing *ring, UDOUBLE len)
+{
+  UDOUBLE head = ring->head.load(std::memory_order_relaxed) + len;
+  ring->head.store(head, std::memory_order_release);
+
+  UDOUBLE used = head - ring->tail.load(std::memory_order_relaxed);
+  if (used > ring->high_water) ring->high_water = used;
+}
+
+const UBYTE *LineRing_Peek(LineRing *ring)
+{
+  UDOUBLE tail = ring->tail.load(std::memory_order_relaxed);
+  UDOUBLE head = ring->head.load(std::memory_order_acquire);
+  if (head - tail < ring->record) {
+    if (!ring->consumer_waiting) ring->consumer_stalls++;
+    ring->consumer_waiting = true;
+    return NULL;
+  }
+  ring->consumer_waiting = false;
+  return ring->buf + (tail % ring->size);
+}
+
+void LineRing_Consume(LineRing *ring)
+{
+  UDOUBLE tail = ring->tail.load(std::memory_order_relaxed) + ring->record;
+  ring->tail.store(tail, std::memory_order_release);
+}
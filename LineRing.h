@@ -0,0 +1,44 @@
+/**
+ * Single-Producer/Single-Consumer Line Ring
+ *
+ * Lock-free byte ring handed out in fixed-size records (panel lines or rows).
+ * The producer (network task) writes any number of bytes into the contiguous
+ * free space; the consumer (display task) only sees whole records. The
+ * capacity is a multiple of the record size, so a record never wraps.
+ *
+ * @author Stephane Bhiri
+ * @version 2.0
+ * @date January 2025
+ */
+
+#ifndef LINE_RING_H
+#define LINE_RING_H
+
+#include "DEV_Config.h"
+#include <atomic>
+
+typedef struct {
+  UBYTE*  buf;
+  UDOUBLE size;                  // Capacity in bytes (multiple of record)
+  UDOUBLE record;                // Bytes per record handed to the consumer
+  std::atomic<UDOUBLE> head;     // Total bytes produced (producer-owned)
+  std::atomic<UDOUBLE> tail;     // Total bytes consumed (consumer-owned)
+  UDOUBLE high_water;            // Peak fill level in bytes
+  UDOUBLE producer_stalls;       // Waits for free space (repeated polls count once)
+  UDOUBLE consumer_stalls;       // Waits for a full record (repeated polls count once)
+  bool    producer_waiting;      // Last WritePtr found the ring full
+  bool    consumer_waiting;      // Last Peek found no full record
+} LineRing;
+
+bool LineRing_Init(LineRing* ring, UDOUBLE records, UDOUBLE record_size);
+void LineRing_Free(LineRing* ring);
+
+// Producer side: contiguous free space (clipped to *len), then publish bytes
+UBYTE* LineRing_WritePtr(LineRing* ring, UDOUBLE* len);
+void LineRing_Produce(LineRing* ring, UDOUBLE len);
+
+// Consumer side: next whole record or NULL, then release it
+const UBYTE* LineRing_Peek(LineRing* ring);
+void LineRing_Consume(LineRing* ring);
+
+#endif
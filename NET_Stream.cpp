@@ -0,0 +1,423 @@
+#include "NET_Stream.h"
+#include "Debug.h"
+#include "lwip/sockets.h"
+#include "lwip/netdb.h"
+#include <inttypes.h>
+
+static NET_Stream_Stats net_stats = {0, 0, 0, 0};
+static NET_Stream_ConnStats net_conn_stats = {0, 0, 0, 0, 0, 0, 0};
+
+// Last resolved server address
+static struct {
+  char host[64];
+  struct sockaddr_in addr;
+  uint32_t resolved_ms;
+  bool valid;
+} net_dns = {};
+
+// Connection kept open after a complete response
+static struct {
+  int sock;
+  char host[64];
+  uint16_t port;
+  uint32_t parked_ms;
+} net_idle = {-1, "", 0, 0};
+
+static void NET_Stream_DropIdle(void)
+{
+  if (net_idle.sock >= 0) {
+    close(net_idle.sock);
+    net_idle.sock = -1;
+  }
+}
+
+// Take the parked connection if it goes to host:port and still looks open
+static bool NET_Stream_TakeIdle(NET_Stream *s, const char *host, uint16_t port)
+{
+  if (net_idle.sock < 0) return false;
+  if (net_idle.port != port || strcmp(net_idle.host, host) != 0 ||
+      DEV_Time_ms() - net_idle.parked_ms > NET_IDLE_MAX_MS) {
+    NET_Stream_DropIdle();
+    return false;
+  }
+  // A FIN (0) or stray data means the connection is no longer usable
+  char c;
+  int n = recv(net_idle.sock, &c, 1, MSG_PEEK | MSG_DONTWAIT);
+  if (n >= 0) {
+    net_conn_stats.stale++;
+    NET_Stream_DropIdle();
+    return false;
+  }
+  s->sock = net_idle.sock;
+  net_idle.sock = -1;
+  return true;
+}
+
+static bool NET_Stream_Resolve(const char *host, uint16_t port, struct sockaddr_in *addr)
+{
+  if (net_dns.valid && strcmp(net_dns.host, host) == 0 &&
+      DEV_Time_ms() - net_dns.resolved_ms < NET_DNS_TTL_MS) {
+    *addr = net_dns.addr;
+    addr->sin_port = htons(port);
+    return true;
+  }
+
+  struct addrinfo hints = {};
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_STREAM;
+  struct addrinfo *res = NULL;
+  net_conn_stats.dns_lookups++;
+  // The resolver blocks until the DNS server answers or its retries run
+  // out; start and end with a fresh watchdog period
+  DEV_Watchdog_Reset();
+  int err = getaddrinfo(host, NULL, &hints, &res);
+  DEV_Watchdog_Reset();
+  if (err != 0 || !res) {
+    Debug("DNS lookup failed: %s\r\n", host);
+    net_dns.valid = false;
+    return false;
+  }
+  memcpy(&net_dns.addr, res->ai_addr, sizeof(net_dns.addr));
+  freeaddrinfo(res);
+  strncpy(net_dns.host, host, sizeof(net_dns.host) - 1);
+  net_dns.host[sizeof(net_dns.host) - 1] = '\0';
+  net_dns.resolved_ms = DEV_Time_ms();
+  net_dns.valid = true;
+  *addr = net_dns.addr;
+  addr->sin_port = htons(port);
+  return true;
+}
+
+// Non-blocking connect, so an unreachable server costs at most
+// NET_CONNECT_TIMEOUT_MS instead of the TCP stack's SYN retry schedule
+static int NET_Stream_ConnectTimeout(int sock, const struct sockaddr_in *addr, uint32_t timeout_ms)
+{
+  int flags = fcntl(sock, F_GETFL, 0);
+  fcntl(sock, F_SETFL, flags | O_NONBLOCK);
+  int err = connect(sock, (const struct sockaddr *)addr, sizeof(*addr));
+  if (err != 0 && errno == EINPROGRESS) {
+    fd_set writable;
+    FD_ZERO(&writable);
+    FD_SET(sock, &writable);
+    struct timeval tv;
+    tv.tv_sec = timeout_ms / 1000;
+    tv.tv_usec = (timeout_ms % 1000) * 1000;
+    err = -1;
+    if (select(sock + 1, NULL, &writable, NULL, &tv) > 0) {
+      int so_error = 0;
+      socklen_t so_len = sizeof(so_error);
+      if (getsockopt(sock, SOL_SOCKET, SO_ERROR, &so_error, &so_len) == 0 && so_error == 0) {
+        err = 0;
+      }
+    }
+  }
+  fcntl(sock, F_SETFL, flags);
+  return err;
+}
+
+static bool NET_Stream_Connect(NET_Stream *s, const char *host, uint16_t port, uint32_t timeout_ms)
+{
+  uint32_t start = DEV_Time_ms();
+  struct sockaddr_in addr;
+  if (!NET_Stream_Resolve(host, port, &addr)) return false;
+
+  s->sock = socket(AF_INET, SOCK_STREAM, 0);
+  if (s->sock < 0) return false;
+  int one = 1;
+  setsockopt(s->sock, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+  if (timeout_ms > NET_CONNECT_TIMEOUT_MS) timeout_ms = NET_CONNECT_TIMEOUT_MS;
+  int err = NET_Stream_ConnectTimeout(s->sock, &addr, timeout_ms);
+  net_conn_stats.connect_ms += DEV_Time_ms() - start;
+  if (err != 0) {
+    Debug("Connect to %s:%u failed\r\n", host, port);
+    net_dns.valid = false;  // The server may have moved
+    NET_Stream_Close(s);
+    return false;
+  }
+  net_conn_stats.connects++;
+  return true;
+}
+
+static void NET_Stream_SetTimeout(NET_Stream *s, uint32_t timeout_ms)
+{
+  struct timeval tv;
+  tv.tv_sec = timeout_ms / 1000;
+  tv.tv_usec = (timeout_ms % 1000) * 1000;
+  setsockopt(s->sock, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+  s->timeout_ms = timeout_ms;
+  uint32_t slice_ms = timeout_ms < NET_RECV_SLICE_MS ? timeout_ms : NET_RECV_SLICE_MS;
+  tv.tv_sec = slice_ms / 1000;
+  tv.tv_usec = (slice_ms % 1000) * 1000;
+  setsockopt(s->sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+}
+
+// recv that waits up to the request timeout, one slice at a time
+static int NET_Stream_Recv(NET_Stream *s, void *dst, size_t len)
+{
+  uint32_t start = DEV_Time_ms();
+  for (;;) {
+    if (s->aborted.load()) return -1;
+    int n = recv(s->sock, dst, len, 0);
+    net_stats.recv_calls++;
+    if (n >= 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) return n;
+    if (DEV_Time_ms() - start >= s->timeout_ms) return -1;
+    DEV_Watchdog_Reset();
+  }
+}
+
+static bool NET_Stream_SendAll(NET_Stream *s, const char *data, size_t len)
+{
+  while (len > 0) {
+    int sent = send(s->sock, data, len, 0);
+    if (sent <= 0) return false;
+    data += sent;
+    len -= sent;
+  }
+  return true;
+}
+
+// Case-insensitive header lookup inside the NUL-terminated header block
+static const char *NET_Stream_FindHeader(const char *head, const char *name)
+{
+  size_t name_len = strlen(name);
+  for (const char *line = strstr(head, "\r\n"); line; line = strstr(line, "\r\n")) {
+    line += 2;
+    if (strncasecmp(line, name, name_len) == 0 && line[name_len] == ':') {
+      const char *value = line + name_len + 1;
+      while (*value == ' ') value++;
+      return value;
+    }
+  }
+  return NULL;
+}
+
+// Read until the blank line ending the header; whatever follows it in the
+// same segments is the start of the body and stays in head[] as residue
+static bool NET_Stream_ReadHeader(NET_Stream *s)
+{
+  size_t used = 0;
+  char *end = NULL;
+  while (!end) {
+    if (used >= NET_HEAD_SIZE - 1) {
+      Debug("HTTP header too large\r\n");
+      return false;
+    }
+    int n = NET_Stream_Recv(s, s->head + used, NET_HEAD_SIZE - 1 - used);
+    if (n <= 0) return false;
+    used += n;
+    s->head[used] = '\0';
+    end = strstr(s->head, "\r\n\r\n");
+  }
+
+  size_t head_len = (end - s->head) + 4;
+  s->residue_pos = head_len;
+  s->residue_len = used;
+  end[2] = '\0';  // Terminate the header block for parsing, keep the body bytes
+
+  int major, minor;
+  if (sscanf(s->head, "HTTP/%d.%d %d", &major, &minor, &s->status) != 3) {
+    s->status = 0;
+    return false;
+  }
+
+  const char *length = NET_Stream_FindHeader(s->head, "Content-Length");
+  s->content_length = length ? atol(length) : -1;
+  // HTTP/1.0 semantics: only an explicit keep-alive with a known length
+  const char *connection = NET_Stream_FindHeader(s->head, "Connection");
+  s->keep_alive = s->content_length >= 0 && connection &&
+                  strncasecmp(connection, "keep-alive", 10) == 0;
+  return true;
+}
+
+bool NET_Stream_Open(NET_Stream *s, const char *host, uint16_t port,
+                     const char *path, const char *headers, uint32_t timeout_ms)
+{
+  return NET_Stream_OpenAt(s, host, port, path, headers, 0, timeout_ms);
+}
+
+// Send one request (a parked connection first) and parse the response header
+static bool NET_Stream_Request(NET_Stream *s, const char *host, uint16_t port,
+                               const char *request, int len, const UBYTE *body,
+                               UDOUBLE body_len, uint32_t timeout_ms)
+{
+  // A parked connection may have been dropped by the server in the
+  // meantime; that costs one fresh connect, nothing more
+  for (int attempt = 0; ; attempt++) {
+    s->sock = -1;
+    s->host = host;
+    s->port = port;
+    s->status = 0;
+    s->content_length = -1;
+    s->body_read = 0;
+    s->residue_pos = 0;
+    s->residue_len = 0;
+    s->keep_alive = false;
+    if (s->aborted.load()) return false;
+
+    bool reused = attempt == 0 && NET_Stream_TakeIdle(s, host, port);
+    if (!reused && !NET_Stream_Connect(s, host, port, timeout_ms)) return false;
+    NET_Stream_SetTimeout(s, timeout_ms);
+
+    net_conn_stats.requests++;
+    uint32_t sent_ms = DEV_Time_ms();
+    if (NET_Stream_SendAll(s, request, len) &&
+        (!body_len || NET_Stream_SendAll(s, (const char *)body, body_len)) &&
+        NET_Stream_ReadHeader(s)) {
+      net_conn_stats.ttfb_ms += DEV_Time_ms() - sent_ms;
+      if (reused) net_conn_stats.reused++;
+      break;
+    }
+    s->keep_alive = false;
+    NET_Stream_Close(s);
+    // A timeout is the server being slow, not a dropped connection
+    if (!reused || s->status != 0 || DEV_Time_ms() - sent_ms >= timeout_ms) return false;
+    net_conn_stats.stale++;
+  }
+  return true;
+}
+
+bool NET_Stream_OpenAt(NET_Stream *s, const char *host, uint16_t port, const char *path,
+                       const char *headers, UDOUBLE offset, uint32_t timeout_ms)
+{
+  // HTTP/1.0 keeps the body free of chunked framing so it can be read raw
+  char range[40] = "";
+  if (offset > 0) {
+    snprintf(range, sizeof(range), "Range: bytes=%" PRIu32 "-\r\n", offset);
+  }
+  char request[384];
+  int len = snprintf(request, sizeof(request),
+                     "GET %s HTTP/1.0\r\nHost: %s:%u\r\nUser-Agent: ESP32-EInk\r\n"
+                     "Connection: keep-alive\r\n%s%s\r\n",
+                     path, host, port, headers ? headers : "", range);
+  if (len <= 0 || len >= (int)sizeof(request) ||
+      !NET_Stream_Request(s, host, port, request, len, NULL, 0, timeout_ms)) {
+    return false;
+  }
+  if (offset == 0) return true;
+
+  if (s->status == 206) {
+    const char *content_range = NET_Stream_FindHeader(s->head, "Content-Range");
+    if (content_range && strncasecmp(content_range, "bytes ", 6) == 0 &&
+        strtoul(content_range + 6, NULL, 10) == offset) {
+      return true;
+    }
+    Debug("Content-Range does not start at %" PRIu32 "\r\n", offset);
+    NET_Stream_Close(s);
+    return false;
+  }
+  if (s->status == 200) {
+    // Range ignored: the whole body follows, drop what the caller already has
+    UBYTE scratch[256];
+    UDOUBLE left = offset;
+    while (left > 0) {
+      UDOUBLE n = left < sizeof(scratch) ? left : sizeof(scratch);
+      if (!NET_Stream_ReadFully(s, scratch, n)) {
+        NET_Stream_Close(s);
+        return false;
+      }
+      left -= n;
+    }
+    net_stats.skipped_bytes += offset;
+    s->status = 206;
+    return true;
+  }
+  return true;  // Caller sees the error status
+}
+
+bool NET_Stream_Post(NET_Stream *s, const char *host, uint16_t port, const char *path,
+                     const char *type, const UBYTE *body, UDOUBLE body_len, uint32_t timeout_ms)
+{
+  char request[256];
+  int len = snprintf(request, sizeof(request),
+                     "POST %s HTTP/1.0\r\nHost: %s:%u\r\nUser-Agent: ESP32-EInk\r\n"
+                     "Connection: keep-alive\r\nContent-Type: %s\r\nContent-Length: %" PRIu32 "\r\n\r\n",
+                     path, host, port, type, body_len);
+  if (len <= 0 || len >= (int)sizeof(request)) return false;
+  return NET_Stream_Request(s, host, port, request, len, body, body_len, timeout_ms);
+}
+
+int NET_Stream_Read(NET_Stream *s, UBYTE *dst, UDOUBLE len)
+{
+  if (s->sock < 0) return -1;
+  if (s->content_length >= 0 && s->body_read >= (UDOUBLE)s->content_length) return 0;
+
+  if (s->residue_pos < s->residue_len) {
+    UDOUBLE n = s->residue_len - s->residue_pos;
+    if (n > len) n = len;
+    memcpy(dst, s->head + s->residue_pos, n);
+    s->residue_pos += n;
+    s->body_read += n;
+    net_stats.bytes += n;
+    net_stats.residue_bytes += n;
+    return n;
+  }
+
+  int n = NET_Stream_Recv(s, dst, len);
+  if (n < 0) return -1;
+  s->body_read += n;
+  net_stats.bytes += n;
+  return n;
+}
+
+bool NET_Stream_ReadFully(NET_Stream *s, UBYTE *dst, UDOUBLE len)
+{
+  while (len > 0) {
+    int n = NET_Stream_Read(s, dst, len);
+    if (n <= 0) return false;
+    dst += n;
+    len -= n;
+  }
+  return true;
+}
+
+const char *NET_Stream_Header(const NET_Stream *s, const char *name)
+{
+  return s->status ? NET_Stream_FindHeader(s->head, name) : NULL;
+}
+
+void NET_Stream_Close(NET_Stream *s)
+{
+  if (s->sock < 0) return;
+  if (s->keep_alive && s->status && s->body_read == (UDOUBLE)s->content_length &&
+      !s->aborted.load()) {
+    NET_Stream_DropIdle();
+    net_idle.sock = s->sock;
+    strncpy(net_idle.host, s->host, sizeof(net_idle.host) - 1);
+    net_idle.host[sizeof(net_idle.host) - 1] = '\0';
+    net_idle.port = s->port;
+    net_idle.parked_ms = DEV_Time_ms();
+    s->sock = -1;
+    return;
+  }
+  close(s->sock);
+  s->sock = -1;
+}
+
+void NET_Stream_Abort(NET_Stream *s)
+{
+  s->aborted.store(true);
+}
+
+void NET_Stream_ResetStats(void)
+{
+  net_stats.recv_calls = 0;
+  net_stats.bytes = 0;
+  net_stats.residue_bytes = 0;
+  net_stats.skipped_bytes = 0;
+}
+
+NET_Stream_Stats NET_Stream_GetStats(void)
+{
+  return net_stats;
+}
+
+void NET_Stream_ResetConnStats(void)
+{
+  memset(&net_conn_stats, 0, sizeof(net_conn_stats));
+}
+
+NET_Stream_ConnStats NET_Stream_GetConnStats(void)
+{
+  return net_conn_stats;
+}
\ No newline at end of file
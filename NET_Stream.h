@@ -0,0 +1,112 @@
+/**
+ * Raw Socket HTTP Stream
+ *
+ * Minimal HTTP/1.0 GET client on top of lwIP sockets for the frame download.
+ * The body is received straight into caller-provided buffers (the SPI DMA
+ * blocks), skipping the HTTPClient/WiFiClient copy layers. Only bytes that
+ * arrive in the same segment as the response header go through the small
+ * residue buffer.
+ *
+ * Requests ask for keep-alive. A connection whose body was read to its
+ * Content-Length is parked on Close and picked up by the next Open to the
+ * same server (info poll, stream, next poll), and the server address is
+ * cached, so most requests skip both the DNS lookup and the handshake.
+ * A parked connection the server has meanwhile dropped costs one retry.
+ *
+ * @author Stephane Bhiri
+ * @version 2.0
+ * @date January 2025
+ */
+
+#ifndef NET_STREAM_H
+#define NET_STREAM_H
+
+#include "DEV_Config.h"
+#include <atomic>
+
+#define NET_HEAD_SIZE   1024   // Response header + first body bytes
+#define NET_DNS_TTL_MS  600000 // Resolved server address is reused this long
+#define NET_IDLE_MAX_MS 60000  // Parked connections older than this are closed
+#define NET_CONNECT_TIMEOUT_MS 5000  // TCP handshake limit (request timeout if shorter)
+
+// Receives block for at most one slice and feed the watchdog in between,
+// so a request held longer than the task watchdog (long poll) is fine
+#ifndef NET_RECV_SLICE_MS
+#define NET_RECV_SLICE_MS 5000
+#endif
+
+typedef struct {
+  int      sock;
+  const char* host;          // Server, as passed to Open (must outlive the stream)
+  uint16_t port;
+  int      status;           // HTTP status code, 0 if no valid response
+  int32_t  content_length;   // -1 when the server did not send one
+  UDOUBLE  body_read;        // Body bytes handed to the caller so far
+  UWORD    residue_pos;      // Unread body bytes left in head[]
+  UWORD    residue_len;
+  bool     keep_alive;       // Server agreed to keep the connection open
+  uint32_t timeout_ms;       // Longest wait for the next bytes
+  std::atomic<bool> aborted{false};  // Set by Abort from another task, never cleared
+  char     head[NET_HEAD_SIZE];
+} NET_Stream;
+
+// Receive-path counters (reset before a download, read back for logs)
+typedef struct {
+  UDOUBLE recv_calls;        // Socket reads issued
+  UDOUBLE bytes;             // Body bytes delivered
+  UDOUBLE residue_bytes;     // Body bytes that took the extra residue copy
+  UDOUBLE skipped_bytes;     // Bytes re-sent and dropped by a resume without Range support
+} NET_Stream_Stats;
+
+// Connection counters (reset per poll cycle, read back for logs)
+typedef struct {
+  UDOUBLE requests;
+  UDOUBLE connects;          // New TCP connections
+  UDOUBLE reused;            // Requests sent on a parked connection
+  UDOUBLE stale;             // Parked connections the server had closed
+  UDOUBLE dns_lookups;       // Resolver calls (address cache misses)
+  UDOUBLE connect_ms;        // Time spent resolving and connecting
+  UDOUBLE ttfb_ms;           // Request sent to response header parsed
+} NET_Stream_ConnStats;
+
+// Connect, send the GET and parse the response header. headers (may be
+// NULL) are extra request lines, each ending in "\r\n". Returns false on
+// connect/timeout/parse failure; s->status holds the HTTP code otherwise.
+bool NET_Stream_Open(NET_Stream* s, const char* host, uint16_t port,
+                     const char* path, const char* headers, uint32_t timeout_ms);
+
+// Same, continuing a body at byte offset with "Range: bytes=offset-".
+// On success s->status is 206 and reads start at offset; a server that
+// ignores Range (200) is handled by discarding the first offset bytes.
+bool NET_Stream_OpenAt(NET_Stream* s, const char* host, uint16_t port, const char* path,
+                       const char* headers, UDOUBLE offset, uint32_t timeout_ms);
+
+// POST body (Content-Length framed) and parse the response header; the
+// response body is read and the stream closed as after Open
+bool NET_Stream_Post(NET_Stream* s, const char* host, uint16_t port, const char* path,
+                     const char* type, const UBYTE* body, UDOUBLE body_len, uint32_t timeout_ms);
+
+// Up to len body bytes into dst: >0 bytes read, 0 end of body, -1 error
+int NET_Stream_Read(NET_Stream* s, UBYTE* dst, UDOUBLE len);
+
+// Exactly len bytes, or false on error/short body
+bool NET_Stream_ReadFully(NET_Stream* s, UBYTE* dst, UDOUBLE len);
+
+// Value of a response header (up to its "\r\n"), or NULL if absent
+const char* NET_Stream_Header(const NET_Stream* s, const char* name);
+
+// Parks the connection for reuse when the body was read completely
+void NET_Stream_Close(NET_Stream* s);
+
+// From another task: a read blocked on the stream returns -1 within one
+// receive slice, and later Opens on it fail. Only a flag is set, so the
+// owner may be closing or reopening the socket meanwhile; the owner still
+// calls Close, and the connection is not reused.
+void NET_Stream_Abort(NET_Stream* s);
+
+void NET_Stream_ResetStats(void);
+NET_Stream_Stats NET_Stream_GetStats(void);
+void NET_Stream_ResetConnStats(void);
+NET_Stream_ConnStats NET_Stream_GetConnStats(void);
+
+#endif
\ No newline at end of file
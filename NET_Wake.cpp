@@ -0,0 +1,147 @@
+#include "NET_Wake.h"
+#include "Debug.h"
+#include "esp_attr.h"
+#include "lwip/sockets.h"
+#include "mbedtls/md.h"
+#include <Preferences.h>
+
+#define NET_WAKE_NVS_NAMESPACE "wake"
+#define NET_WAKE_NVS_COUNTER   "counter"
+
+static int wake_sock = -1;
+static const char *wake_key = NULL;
+static UDOUBLE wake_rejected = 0;
+
+// Highest counter ever accepted: kept through deep sleep here, and through
+// power loss and reflashing in NVS, so a captured datagram stays rejected
+RTC_DATA_ATTR static UDOUBLE wake_counter;
+
+// Notices come once per image change, so one NVS write each is cheap
+static void NET_Wake_StoreCounter(UDOUBLE counter)
+{
+  Preferences prefs;
+  if (!prefs.begin(NET_WAKE_NVS_NAMESPACE, false)) {
+    Debug("Wake listener: counter not saved\r\n");
+    return;
+  }
+  prefs.putUInt(NET_WAKE_NVS_COUNTER, counter);
+  prefs.end();
+}
+
+bool NET_Wake_Begin(uint16_t port, const char *key)
+{
+  if (!key || !key[0]) return false;
+  if (wake_sock >= 0) {
+    close(wake_sock);  // Rebinding, e.g. after a WiFi reconnect
+    wake_sock = -1;
+  }
+
+  // Whichever copy is ahead: RTC memory is zero after a power loss, and a
+  // reset may cut the NVS write short (a namespace never written fails
+  // the read-only open and leaves the RTC value)
+  Preferences prefs;
+  if (prefs.begin(NET_WAKE_NVS_NAMESPACE, true)) {
+    wake_counter = max(wake_counter, (UDOUBLE)prefs.getUInt(NET_WAKE_NVS_COUNTER, 0));
+    prefs.end();
+  }
+
+  wake_sock = socket(AF_INET, SOCK_DGRAM, 0);
+  if (wake_sock < 0) return false;
+
+  struct sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  if (bind(wake_sock, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+    Debug("Wake listener: port %u unavailable\r\n", port);
+    close(wake_sock);
+    wake_sock = -1;
+    return false;
+  }
+  wake_key = key;
+  return true;
+}
+
+bool NET_Wake_Active(void)
+{
+  return wake_sock >= 0;
+}
+
+// Length-prefixed string field; false if it runs past the signed part
+static bool NET_Wake_Field(const UBYTE **p, const UBYTE *end, char *dst, size_t size)
+{
+  if (*p >= end) return false;
+  size_t len = *(*p)++;
+  if (len >= size || len > (size_t)(end - *p)) return false;
+  memcpy(dst, *p, len);
+  dst[len] = '\0';
+  *p += len;
+  return true;
+}
+
+static bool NET_Wake_Parse(const UBYTE *buf, size_t len, NET_Wake_Notice *notice)
+{
+  if (len < 4 + 1 + 4 + 1 + 1 + NET_WAKE_MAC_BYTES) return false;
+  const UBYTE *end = buf + len - NET_WAKE_MAC_BYTES;
+  if (memcmp(buf, NET_WAKE_MAGIC, 4) != 0 || buf[4] != NET_WAKE_VERSION) return false;
+
+  // MAC first: nothing in an unauthenticated datagram is trusted
+  UBYTE mac[32];
+  if (mbedtls_md_hmac(mbedtls_md_info_from_type(MBEDTLS_MD_SHA256),
+                      (const UBYTE *)wake_key, strlen(wake_key),
+                      buf, end - buf, mac) != 0) {
+    return false;
+  }
+  UBYTE diff = 0;
+  for (int i = 0; i < NET_WAKE_MAC_BYTES; i++) {
+    diff |= mac[i] ^ end[i];
+  }
+  if (diff) return false;
+
+  const UBYTE *p = buf + 5;
+  notice->counter = p[0] | (p[1] << 8) | (p[2] << 16) | ((UDOUBLE)p[3] << 24);
+  p += 4;
+  if (notice->counter <= wake_counter) return false;
+  if (!NET_Wake_Field(&p, end, notice->hash, sizeof(notice->hash)) || !notice->hash[0] ||
+      !NET_Wake_Field(&p, end, notice->path, sizeof(notice->path)) || p != end) {
+    return false;
+  }
+  if (notice->path[0] && notice->path[0] != '/') return false;
+  wake_counter = notice->counter;
+  NET_Wake_StoreCounter(wake_counter);
+  return true;
+}
+
+bool NET_Wake_Wait(uint32_t timeout_ms, NET_Wake_Notice *notice)
+{
+  if (wake_sock < 0) return false;
+  uint32_t start = DEV_Time_ms();
+  for (;;) {
+    uint32_t elapsed = DEV_Time_ms() - start;
+    if (elapsed >= timeout_ms) return false;
+    uint32_t left = timeout_ms - elapsed;
+
+    fd_set readable;
+    FD_ZERO(&readable);
+    FD_SET(wake_sock, &readable);
+    struct timeval tv;
+    tv.tv_sec = left / 1000;
+    tv.tv_usec = (left % 1000) * 1000;
+    if (select(wake_sock + 1, &readable, NULL, NULL, &tv) <= 0) return false;
+
+    UBYTE buf[NET_WAKE_MAX];
+    int n = recv(wake_sock, buf, sizeof(buf), 0);
+    if (n <= 0) continue;
+    if (NET_Wake_Parse(buf, n, notice)) {
+      notice->received_ms = DEV_Time_ms();
+      return true;
+    }
+    wake_rejected++;
+    Debug("Wake listener: datagram rejected\r\n");
+  }
+}
+
+UDOUBLE NET_Wake_Rejected(void)
+{
+  return wake_rejected;
+}
\ No newline at end of file
@@ -0,0 +1,51 @@
+/**
+ * UDP Wake Notifications
+ *
+ * Optional LAN push channel: the server sends a small datagram when the
+ * image changes, and the device, waiting in modem sleep instead of light
+ * sleep, starts the download at once. Poll intervals can then be long
+ * without adding update latency.
+ *
+ * Datagram (all integers little-endian):
+ *   "EPDW"        magic
+ *   u8            version (1)
+ *   u32           counter, must exceed every counter accepted before, across
+ *                 deep sleep and power loss (replay protection)
+ *   u8 + bytes    hash, 1..32 chars
+ *   u8 + bytes    stream path, 0..95 chars (0: the usual stream request)
+ *   16 bytes      HMAC-SHA256 of everything above, truncated
+ *
+ * @author Stephane Bhiri
+ * @version 2.0
+ * @date January 2025
+ */
+
+#ifndef NET_WAKE_H
+#define NET_WAKE_H
+
+#include "DEV_Config.h"
+
+#define NET_WAKE_MAGIC     "EPDW"
+#define NET_WAKE_VERSION   1
+#define NET_WAKE_MAC_BYTES 16
+#define NET_WAKE_MAX       192    // Largest datagram accepted
+
+typedef struct {
+  char     hash[33];
+  char     path[96];           // "" when the notice names no stream path
+  UDOUBLE  counter;
+  UDOUBLE  received_ms;        // DEV_Time_ms() when the datagram arrived
+} NET_Wake_Notice;
+
+// Bind the listener (again, closing the old socket) and load the highest
+// counter accepted so far; false without a key or if the port is taken
+bool NET_Wake_Begin(uint16_t port, const char* key);
+bool NET_Wake_Active(void);
+
+// Wait up to timeout_ms (radio in modem sleep) for a valid notice.
+// Datagrams with a bad MAC, format or counter are dropped and counted.
+bool NET_Wake_Wait(uint32_t timeout_ms, NET_Wake_Notice* notice);
+
+UDOUBLE NET_Wake_Rejected(void);
+
+#endif
\ No newline at end of file
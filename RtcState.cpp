@@ -0,0 +1,58 @@
+#include "RtcState.h"
+
+// Strings are bounded on the way back too: RTC memory that merely happens
+// to hold the magic must not overrun a buffer
+static void RtcState_Copy(char *dst, size_t size, const char *src, size_t src_size)
+{
+  size_t len = strnlen(src, src_size < size ? src_size : size - 1);
+  memcpy(dst, src, len);
+  dst[len] = '\0';
+}
+
+void RtcState_Save(RtcState *s, const FrameUpdate *u, const char *host, const char *port)
+{
+  s->magic = RTC_STATE_MAGIC;
+  RtcState_Copy(s->last_image_hash, sizeof(s->last_image_hash), u->last_hash, sizeof(u->last_hash));
+  RtcState_Copy(s->server_hash, sizeof(s->server_hash), u->server_hash, sizeof(u->server_hash));
+  RtcState_Copy(s->server_host, sizeof(s->server_host), host, sizeof(s->server_host));
+  RtcState_Copy(s->server_port, sizeof(s->server_port), port, sizeof(s->server_port));
+  s->next_poll_s = u->next_poll_s;
+  s->info_requests = u->info_requests;
+}
+
+void RtcState_SetAccessPoint(RtcState *s, const uint8_t *bssid, int32_t channel)
+{
+  if (bssid && channel > 0) {
+    memcpy(s->wifi_bssid, bssid, sizeof(s->wifi_bssid));
+    s->wifi_channel = channel;
+  } else {
+    memset(s->wifi_bssid, 0, sizeof(s->wifi_bssid));
+    s->wifi_channel = 0;
+  }
+}
+
+bool RtcState_HasAccessPoint(const RtcState *s)
+{
+  if (s->wifi_channel <= 0) {
+    return false;
+  }
+  for (size_t i = 0; i < sizeof(s->wifi_bssid); i++) {
+    if (s->wifi_bssid[i]) return true;
+  }
+  return false;
+}
+
+bool RtcState_Restore(const RtcState *s, FrameUpdate *u, char *host, size_t host_size,
+                      char *port, size_t port_size)
+{
+  if (s->magic != RTC_STATE_MAGIC) {
+    return false;
+  }
+  RtcState_Copy(u->last_hash, sizeof(u->last_hash), s->last_image_hash, sizeof(s->last_image_hash));
+  RtcState_Copy(u->server_hash, sizeof(u->server_hash), s->server_hash, sizeof(s->server_hash));
+  RtcState_Copy(host, host_size, s->server_host, sizeof(s->server_host));
+  RtcState_Copy(port, port_size, s->server_port, sizeof(s->server_port));
+  u->next_poll_s = s->next_poll_s;
+  u->info_requests = s->info_requests;
+  return true;
+}
@@ -0,0 +1,54 @@
+/**
+ * Deep Sleep State
+ *
+ * What a timer wake from deep sleep needs to skip the full boot: the frame
+ * on screen, the poll state and the access point to rejoin. The sketch
+ * keeps one RtcState in RTC slow memory, which survives deep sleep but not
+ * a power loss; the magic tells a saved state from that cleared (or
+ * random) memory. The WiFi credentials stay in NVS where WiFiManager
+ * stored them.
+ *
+ * @author Stephane Bhiri
+ * @version 2.0
+ * @date January 2025
+ */
+
+#ifndef RTC_STATE_H
+#define RTC_STATE_H
+
+#include "DEV_Config.h"
+#include "FrameUpdate.h"
+
+#define RTC_STATE_MAGIC 0x52445045 // "EPDR"
+
+typedef struct {
+  uint32_t magic;
+  char     last_image_hash[33];
+  char     server_hash[33];      // Known to the long poll (FrameUpdate.server_hash)
+  char     server_host[48];
+  char     server_port[8];
+  uint8_t  wifi_bssid[6];        // All zero with wifi_channel 0: scan for the network
+  int32_t  wifi_channel;
+  uint32_t spi_cmd_mhz;
+  uint32_t spi_bulk_mhz;
+  uint32_t clock_s;              // Device time at the last deep sleep, sleep included
+  uint32_t next_poll_s;
+  uint32_t info_requests;
+  uint32_t wakes;
+} RtcState;
+
+// Mark the state valid and copy the update and the server into it
+void RtcState_Save(RtcState* s, const FrameUpdate* u, const char* host, const char* port);
+
+// Access point of the joined station; NULL (not joined) forgets it
+void RtcState_SetAccessPoint(RtcState* s, const uint8_t* bssid, int32_t channel);
+
+// True if a BSSID and channel to join directly were saved
+bool RtcState_HasAccessPoint(const RtcState* s);
+
+// Copy a saved state back (host and port into buffers of the given sizes).
+// False, with nothing copied, if the memory holds no saved state.
+bool RtcState_Restore(const RtcState* s, FrameUpdate* u, char* host, size_t host_size,
+                      char* port, size_t port_size);
+
+#endif
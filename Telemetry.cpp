@@ -0,0 +1,85 @@
+#include "Telemetry.h"
+#include "esp_attr.h"
+
+typedef struct {
+  UWORD   head;              // Next slot to write
+  UWORD   count;
+  UWORD   encoded;           // Samples in the last encoded batch
+  UDOUBLE batch;
+  UDOUBLE dropped;
+  Telemetry_Sample sample[TELEMETRY_CAPACITY];
+} Telemetry_Ring;
+
+// Zeroed on cold boot only; kept through light and deep sleep
+RTC_DATA_ATTR static Telemetry_Ring telemetry;
+
+static void Telemetry_Put16(UBYTE *p, UWORD v)
+{
+  p[0] = v;
+  p[1] = v >> 8;
+}
+
+static void Telemetry_Put32(UBYTE *p, UDOUBLE v)
+{
+  Telemetry_Put16(p, v);
+  Telemetry_Put16(p + 2, v >> 16);
+}
+
+void Telemetry_Add(UDOUBLE time_s, int battery_pct, int rssi,
+                   UDOUBLE heap_free, UDOUBLE heap_block, UBYTE event)
+{
+  Telemetry_Sample *s = &telemetry.sample[telemetry.head];
+  s->time_s = time_s;
+  s->heap_kb = heap_free / 1024;
+  s->heap_block_kb = heap_block / 1024;
+  s->rssi = rssi < -128 ? -128 : (rssi > 0 ? 0 : rssi);
+  s->battery = battery_pct < 0 ? 0xFF : battery_pct;
+  s->event = event;
+  s->reserved = 0;
+
+  telemetry.head = (telemetry.head + 1) % TELEMETRY_CAPACITY;
+  if (telemetry.count < TELEMETRY_CAPACITY) {
+    telemetry.count++;
+  } else {
+    telemetry.dropped++;   // Oldest sample overwritten
+  }
+}
+
+UWORD Telemetry_Count(void)
+{
+  return telemetry.count;
+}
+
+size_t Telemetry_Encode(UBYTE *out, size_t size)
+{
+  UWORD count = telemetry.count;
+  if (size < TELEMETRY_HEADER) return 0;
+  if (count > (size - TELEMETRY_HEADER) / sizeof(Telemetry_Sample)) {
+    count = (size - TELEMETRY_HEADER) / sizeof(Telemetry_Sample);
+  }
+
+  memcpy(out, TELEMETRY_MAGIC, 4);
+  out[4] = TELEMETRY_VERSION;
+  out[5] = sizeof(Telemetry_Sample);
+  Telemetry_Put16(out + 6, count);
+  Telemetry_Put32(out + 8, telemetry.batch);
+  Telemetry_Put32(out + 12, telemetry.dropped);
+
+  // Oldest first; samples are stored in target byte order (little-endian)
+  UWORD first = (telemetry.head + TELEMETRY_CAPACITY - telemetry.count) % TELEMETRY_CAPACITY;
+  UBYTE *p = out + TELEMETRY_HEADER;
+  for (UWORD i = 0; i < count; i++) {
+    memcpy(p, &telemetry.sample[(first + i) % TELEMETRY_CAPACITY], sizeof(Telemetry_Sample));
+    p += sizeof(Telemetry_Sample);
+  }
+  telemetry.encoded = count;
+  return p - out;
+}
+
+void Telemetry_Uploaded(void)
+{
+  telemetry.count -= telemetry.encoded < telemetry.count ? telemetry.encoded : telemetry.count;
+  telemetry.encoded = 0;
+  telemetry.dropped = 0;
+  telemetry.batch++;
+}
\ No newline at end of file
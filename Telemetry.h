@@ -0,0 +1,63 @@
+/**
+ * Telemetry History
+ *
+ * One small sample per poll cycle (battery, RSSI, heap, outcome) kept in a
+ * ring in RTC slow memory, which survives light and deep sleep. The ring
+ * is uploaded as a single binary POST every TELEMETRY_BATCH samples or
+ * right after a frame download, when the radio is up anyway, instead of
+ * sending the values as query text on every poll.
+ *
+ * Batch body (little-endian), POST /api/telemetry:
+ *   "EPDM"        magic
+ *   u8            version (1)
+ *   u8            bytes per sample (12)
+ *   u16           sample count
+ *   u32           batch number since cold boot
+ *   u32           samples lost to ring overflow since the last upload
+ *   samples       oldest first, Telemetry_Sample layout
+ *
+ * @author Stephane Bhiri
+ * @version 2.0
+ * @date January 2025
+ */
+
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include "DEV_Config.h"
+
+#define TELEMETRY_MAGIC      "EPDM"   // Distinct from DEV_TRACE_MAGIC ("EPDT")
+#define TELEMETRY_VERSION    1
+#define TELEMETRY_CAPACITY   64     // Samples kept while uploads fail
+#define TELEMETRY_BATCH      20     // Upload once this many are waiting
+#define TELEMETRY_HEADER     16
+#define TELEMETRY_BODY_MAX   (TELEMETRY_HEADER + TELEMETRY_CAPACITY * sizeof(Telemetry_Sample))
+
+// Cycle outcome
+enum {
+  TELEMETRY_POLL = 0,        // Nothing new
+  TELEMETRY_UPDATE,          // New frame on screen
+  TELEMETRY_FAILED,          // Update attempted and failed
+};
+
+typedef struct __attribute__((packed)) {
+  UDOUBLE time_s;            // Seconds since cold boot, sleep included
+  UWORD   heap_kb;           // Free heap
+  UWORD   heap_block_kb;     // Largest free block
+  int8_t  rssi;              // dBm
+  UBYTE   battery;           // Percent, 0xFF on USB power
+  UBYTE   event;
+  UBYTE   reserved;
+} Telemetry_Sample;
+
+void Telemetry_Add(UDOUBLE time_s, int battery_pct, int rssi,
+                   UDOUBLE heap_free, UDOUBLE heap_block, UBYTE event);
+UWORD Telemetry_Count(void);
+
+// Encode every waiting sample; returns the body length
+size_t Telemetry_Encode(UBYTE* out, size_t size);
+
+// After a successful upload of Telemetry_Encode's samples
+void Telemetry_Uploaded(void);
+
+#endif
\ No newline at end of file
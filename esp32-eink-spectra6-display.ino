@@ -16,7 +16,6 @@
  */
 
 #include <WiFi.h>
-#include <HTTPClient.h>
 #include <WiFiManager.h>
 #include "esp_wifi.h"
 #include "esp_sleep.h"
@@ -24,19 +23,50 @@
 #include "esp_system.h"
 #include "DEV_Config.h"
 #include "EPD_13in3e.h"
+#include "NET_Stream.h"
+#include "NET_Wake.h"
+#include "FrameStore.h"
+#include "FrameUpdate.h"
+#include "RtcState.h"
+#include "Telemetry.h"
+#include <inttypes.h>
 #include "WiFiConfig.h"
 #include <Preferences.h>
 
-// Display specifications
-#define EPD_WIDTH 1200
-#define EPD_HEIGHT 1600
-static const int BYTES_PER_LINE_HALF = EPD_WIDTH/4;
+// UDP wake notices (NET_Wake.h): define WAKE_KEY in WiFiConfig.h to enable
+#ifndef WAKE_KEY
+#define WAKE_KEY ""
+#endif
+#define WAKE_PORT 5002
 
 // Network configuration
+#define INFO_TIMEOUT_MS 5000
+#define INFO_LONG_POLL_S 25    // Server may hold the info request this long (watchdog fed while held)
+#define SLEEP_CHUNK_S   15     // Longest single light sleep, watchdog fed in between
+#define FRAME_PREFETCH      1  // Download the next frame while the panel refreshes
+#define FRAME_CONDITIONAL   0  // Poll the stream with If-None-Match instead of the info endpoint
+
+// Deep sleep between polls instead of light sleep. Timer wakes take a fast
+// path: no WiFiManager, boot splash or double-reset window, and WiFi joins
+// the remembered BSSID/channel directly.
+#define DEEP_SLEEP_MODE 0
+#define FAST_WAKE_WIFI_MS 5000     // Full boot path if the quick join fails
+
+// Kept in RTC slow memory across deep sleep (RtcState.h)
+RTC_DATA_ATTR RtcState rtc_state;
+uint32_t clock_base_s = 0;    // Device time when this boot/wake started
+int cycle_battery_pct = -1;      // Measured once per loop cycle
+#define TELEMETRY_PATH  "/api/telemetry"
 char server_url[64];
 char server_host[48];  // Will be loaded from config or default
 char server_port[8] = "8080";     // Default port
-char last_image_hash[33] = "";  // MD5 = 32 chars + null terminator
+
+// Poll, download and display state (FrameUpdate.h); the frame on screen is update.last_hash
+FrameUpdate update;
+
+// SPI clock profile (MHz) - commands stay conservative, pixel bulk can go faster
+uint32_t spi_cmd_mhz = SPI_CMD_SPEED_HZ / 1000000;
+uint32_t spi_bulk_mhz = SPI_BULK_SPEED_HZ / 1000000;
 
 // WiFi credential storage
 Preferences preferences;
@@ -47,45 +77,8 @@ String stored_password = "";
 // WiFiManager custom parameters (must be global for callback)
 WiFiManagerParameter* custom_server_host = nullptr;
 WiFiManagerParameter* custom_server_port = nullptr;
-
-/**
- * Robust JSON parser for extracting string values
- * Handles whitespace and escaped quotes properly
- * 
- * @param payload JSON string to parse
- * @param key Key to extract value for
- * @return Extracted string value or empty string if not found
- */
-String parseJsonValue(const String& payload, const char* key) {
-  String search_pattern = "\"" + String(key) + "\"";
-  int key_position = payload.indexOf(search_pattern);
-  if (key_position == -1) return "";
-
-  int current_pos = key_position + search_pattern.length();
-
-  // Skip whitespace to find colon
-  while (current_pos < payload.length() && isspace(payload[current_pos])) {
-    current_pos++;
-  }
-  if (current_pos >= payload.length() || payload[current_pos] != ':') return "";
-  current_pos++;
-
-  // Skip whitespace to find opening quote
-  while (current_pos < payload.length() && isspace(payload[current_pos])) {
-    current_pos++;
-  }
-  if (current_pos >= payload.length() || payload[current_pos] != '"') return "";
-  int value_start = current_pos + 1;
-
-  // Find closing quote (handle escaped quotes)
-  int value_end = payload.indexOf('"', value_start);
-  while (value_end != -1 && payload[value_end - 1] == '\\') {
-      value_end = payload.indexOf('"', value_end + 1);
-  }
-  if (value_end == -1) return "";
-
-  return payload.substring(value_start, value_end);
-}
+WiFiManagerParameter* custom_spi_cmd_mhz = nullptr;
+WiFiManagerParameter* custom_spi_bulk_mhz = nullptr;
 
 /**
  * Read battery voltage and calculate percentage
@@ -122,6 +115,86 @@ int getBatteryLevel() {
   return (int)percentage;
 }
 
+/**
+ * Render the boot splash (or config-mode instructions) on the panel
+ * Text is composed here so the EPD driver stays free of WiFi/ADC access
+ * 
+ * @param ssid Network name shown in config mode
+ * @param battery_pct Battery percentage, -1 for USB power, -2 for config mode
+ */
+void showBootSplash(const char* ssid, int battery_pct) {
+  // Get WiFi info for display - convert to uppercase for better font rendering
+  char ip_line[64];
+  char wifi_line[64];
+  char battery_line[64];
+  char server_line[64];
+  char ssid_upper[32];
+
+  // Special config mode display (battery_pct == -2)
+  if (battery_pct == -2) {
+    strcpy(battery_line, "CONFIG MODE");
+    snprintf(wifi_line, sizeof(wifi_line), "WIFI: %s", ssid);  // ssid = "E-Ink-Setup"
+    strcpy(ip_line, "OPEN BROWSER");
+  } else if (battery_pct < 0) {
+    strcpy(battery_line, "USB POWER");
+  } else {
+    // Get voltage for display (re-read ADC quickly)
+    int raw = analogRead(35);  // Quick read
+    float voltage = (raw / 4095.0) * 3.3 * 2.0;
+    snprintf(battery_line, sizeof(battery_line), "BATTERY: %.1fV (%d%%)", voltage, battery_pct);
+  }
+
+  if (battery_pct != -2) {  // Normal mode (not config)
+    if (WiFi.status() == WL_CONNECTED) {
+      // Show only local IP (no port)
+      snprintf(ip_line, sizeof(ip_line), "IP: %s", WiFi.localIP().toString().c_str());
+
+      // Show server host and port
+      snprintf(server_line, sizeof(server_line), "SERVER: %s:%s", server_host, server_port);
+
+      // Convert actual connected SSID to uppercase
+      String connected_ssid = WiFi.SSID();
+      strncpy(ssid_upper, connected_ssid.c_str(), sizeof(ssid_upper) - 1);
+      ssid_upper[sizeof(ssid_upper) - 1] = '\0';
+      for (int i = 0; ssid_upper[i]; i++) {
+        ssid_upper[i] = toupper(ssid_upper[i]);
+      }
+      snprintf(wifi_line, sizeof(wifi_line), "WIFI: %s", ssid_upper);
+    } else {
+      strcpy(ip_line, "NO WIFI CONNECTION");
+      strcpy(wifi_line, "OFFLINE MODE");
+      strcpy(server_line, "NO SERVER");
+    }
+  }
+
+  // MAX 30 CHARACTERS (1200px / 40px per char = 30 chars)
+  // Each line below is <= 30 chars for perfect fit
+  const char* band_texts[6];
+
+  if (battery_pct == -2) {
+    // Config mode display - 4 lines of text
+    band_texts[0] = battery_line;               // "CONFIG MODE"
+    band_texts[1] = wifi_line;                  // "WIFI: E-Ink-Setup"
+    band_texts[2] = ip_line;                    // "OPEN BROWSER"
+    band_texts[3] = "192.168.4.1";              // IP address
+    band_texts[4] = "TIMEOUT: 3 MINUTES";       // Info
+    band_texts[5] = "DOUBLE RESET TO RETRY";    // Help
+  } else {
+    // Normal mode display with server info
+    band_texts[0] = "E-INK FRAME (C) 2025";     // Band 0 (black)
+    band_texts[1] = wifi_line;                  // Band 1 (white) - Actual WiFi
+    band_texts[2] = ip_line;                    // Band 2 (yellow) - Local IP only
+    band_texts[3] = server_line;                // Band 3 (red) - Server info
+    band_texts[4] = battery_line;               // Band 4 (blue) - Battery
+    band_texts[5] = "READY FOR YOUR IMAGES";    // Band 5 (green)
+  }
+  
+  DEV_Trace_Begin();
+  EPD_13IN3E_DisplayTextScreen(band_texts);
+  DEV_Trace_End();
+  DEV_Trace_Dump();
+}
+
 /**
  * Detect double reset for configuration mode
  * Two resets within 3 seconds triggers config portal
@@ -159,6 +232,18 @@ bool detectDoubleReset() {
 }
 
 
+/**
+ * Bring a clock entered in MHz into the range the SPI layer accepts, so the
+ * saved profile is the one actually in use
+ */
+uint32_t clampClockMhz(uint32_t mhz) {
+  uint32_t clamped = constrain(mhz, (uint32_t)(SPI_MIN_SPEED_HZ / 1000000), (uint32_t)(SPI_MAX_SPEED_HZ / 1000000));
+  if (clamped != mhz) {
+    Serial.printf("SPI clock %" PRIu32 " MHz out of range, using %" PRIu32 " MHz\n", mhz, clamped);
+  }
+  return clamped;
+}
+
 /**
  * Load WiFi and server configuration from flash memory
  */
@@ -181,6 +266,11 @@ void loadConfiguration() {
     Serial.printf("Loaded server port: %s\n", server_port);
   }
   
+  // Load SPI clock profile
+  spi_cmd_mhz = clampClockMhz(preferences.getUInt("spi_cmd_mhz", spi_cmd_mhz));
+  spi_bulk_mhz = clampClockMhz(preferences.getUInt("spi_bulk_mhz", spi_bulk_mhz));
+  Serial.printf("SPI clocks: %" PRIu32 " MHz commands, %" PRIu32 " MHz pixels\n", spi_cmd_mhz, spi_bulk_mhz);
+  
   preferences.end();
 }
 
@@ -195,6 +285,30 @@ void saveConfiguration(const char* host, const char* port) {
   Serial.println("Server configuration saved");
 }
 
+/**
+ * Save SPI clock profile to flash memory
+ */
+void saveClockProfile(uint32_t cmd_mhz, uint32_t bulk_mhz) {
+  preferences.begin("config", false);
+  preferences.putUInt("spi_cmd_mhz", cmd_mhz);
+  preferences.putUInt("spi_bulk_mhz", bulk_mhz);
+  preferences.end();
+  Serial.println("SPI clock profile saved");
+}
+
+/**
+ * Apply spi_cmd_mhz/spi_bulk_mhz to the SPI layer; if the driver refuses
+ * them the previous clocks stay in use
+ */
+bool applyClockProfile() {
+  if (DEV_SPI_SetClockProfile(spi_cmd_mhz * 1000000, spi_bulk_mhz * 1000000)) {
+    return true;
+  }
+  Serial.printf("SPI clocks %" PRIu32 "/%" PRIu32 " MHz refused, previous profile kept\n",
+                spi_cmd_mhz, spi_bulk_mhz);
+  return false;
+}
+
 /**
  * Save WiFi credentials to flash memory
  */
@@ -208,142 +322,123 @@ void saveWiFiCredentials() {
 }
 
 /**
- * Check server for new image updates
- * Compares MD5 hash to detect changes
- * 
- * @return true if new image available, false otherwise
+ * Record this cycle's telemetry sample and upload the batch when due
+ * Uploads ride on an active radio: a full batch, or right after a download
  */
-bool checkForNewImage() {
-  HTTPClient http;
-  
-  // Collect system stats
-  int battery_pct = getBatteryLevel();
-  int rssi = WiFi.RSSI();
-  uint32_t free_heap = ESP.getFreeHeap();
-  uint32_t uptime = millis() / 1000;  // Convert to seconds
-  
-  // Build URL with parameters
-  char url[256];
-  if (battery_pct >= 0) {
-    snprintf(url, sizeof(url), "%s/api/image/info?battery=%d&rssi=%d&heap=%u&uptime=%u", 
-             server_url, battery_pct, rssi, free_heap, uptime);
-  } else {
-    // USB power mode (battery_pct = -1)
-    snprintf(url, sizeof(url), "%s/api/image/info?battery=usb&rssi=%d&heap=%u&uptime=%u", 
-             server_url, rssi, free_heap, uptime);
+void recordTelemetry(uint8_t event) {
+  Telemetry_Add(clock_base_s + millis() / 1000, cycle_battery_pct, WiFi.RSSI(),
+                ESP.getFreeHeap(), ESP.getMaxAllocHeap(), event);
+  if (Telemetry_Count() < TELEMETRY_BATCH && event != TELEMETRY_UPDATE) {
+    return;
   }
   
-  http.begin(url);
-  http.setTimeout(5000);
-  
-  int response_code = http.GET();
-  if (response_code == 200) {
-    String response = http.getString();
-    http.end();
-    
-    Serial.println("Server response: " + response);
-    
-    String current_hash = parseJsonValue(response, "hash");
-    
-    if (current_hash.length() > 0) {
-      Serial.printf("Current hash: %s\n", current_hash.c_str());
-      Serial.printf("Stored hash: %s\n", last_image_hash);
-      
-      if (strcmp(current_hash.c_str(), last_image_hash) == 0) {
-        Serial.println("No image update needed");
-        return false;
-      }
-      
-      Serial.printf("New image detected: %s\n", current_hash.c_str());
-      strncpy(last_image_hash, current_hash.c_str(), sizeof(last_image_hash) - 1);
-      last_image_hash[sizeof(last_image_hash) - 1] = '\0';
-      return true;
-    } else {
-      Serial.println("Failed to parse image hash");
-    }
+  static UBYTE body[TELEMETRY_BODY_MAX];
+  size_t len = Telemetry_Encode(body, sizeof(body));
+  NET_Stream net;
+  if (!NET_Stream_Post(&net, server_host, atoi(server_port), TELEMETRY_PATH,
+                       "application/octet-stream", body, len, INFO_TIMEOUT_MS)) {
+    Serial.println("Telemetry upload failed: no response");
+    return;
+  }
+  // Drain the (short) answer so the connection can be reused
+  UBYTE scratch[64];
+  while (NET_Stream_Read(&net, scratch, sizeof(scratch)) > 0) {
+  }
+  NET_Stream_Close(&net);
+  if (net.status / 100 == 2) {
+    Serial.printf("Telemetry: %u samples uploaded (%u bytes)\n", Telemetry_Count(), (unsigned)len);
+    Telemetry_Uploaded();
+  } else {
+    Serial.printf("Telemetry upload failed: HTTP %d\n", net.status);
   }
-  
-  Serial.printf("Server request failed: HTTP %d\n", response_code);
-  http.end();  // Clean up HTTP connection on error
-  return false;
 }
 
 /**
- * Download and display new image via HTTP streaming
- * Uses dual-controller architecture for 1200x1600 resolution
+ * Display the frame named by a wake notice, skipping the info request
+ */
+void handleWakeNotice(const NET_Wake_Notice* notice) {
+  if (!FrameUpdate_Request(&update, notice->hash, notice->path)) {
+    Serial.println("Wake notice for the frame on screen, ignored");
+    return;
+  }
+  Serial.printf("Wake notice #%" PRIu32 " for %s, download starting %" PRIu32 " ms after receipt\n",
+                notice->counter, notice->hash, DEV_Time_ms() - notice->received_ms);
+  bool updated = FrameUpdate_Show(&update);
+  Serial.println(updated ? "Update successful" : "Update failed");
+  recordTelemetry(updated ? TELEMETRY_UPDATE : TELEMETRY_FAILED);
+}
+
+/**
+ * Timer wake from deep sleep: restore RTC state and rejoin WiFi directly
  * 
- * @return true if successful, false on error
+ * @return true if the device is ready to poll, false to take the full boot
  */
-bool updateDisplay() {
-  HTTPClient http;
-  char url[128];
-  snprintf(url, sizeof(url), "%s/api/image/stream", server_url);
-  http.begin(url);
-  http.setTimeout(30000);
-  
-  int response_code = http.GET();
-  if (response_code != 200) {
-    Serial.printf("Image download failed: HTTP %d\n", response_code);
-    http.end();
+bool fastWake() {
+  if (esp_sleep_get_wakeup_cause() != ESP_SLEEP_WAKEUP_TIMER || rtc_state.magic != RTC_STATE_MAGIC) {
     return false;
   }
+  unsigned long wake_start = millis();
   
-  Serial.println("Downloading image...");
-  
-  EPD_13IN3E_PowerOn();
-  EPD_13IN3E_Init();
-  WiFiClient* stream = http.getStreamPtr();
-  uint8_t line_buffer[BYTES_PER_LINE_HALF];
-  
-  // Master controller (left half)
-  EPD_13IN3E_BeginFrameM();
-  size_t master_bytes = 0;
-  for (int y = 0; y < EPD_HEIGHT; y++) {
-    int bytes_read = stream->readBytes(line_buffer, BYTES_PER_LINE_HALF);
-    if (bytes_read != BYTES_PER_LINE_HALF) {
-      Serial.printf("Stream error at line %d\n", y);
-      break;
-    }
-    EPD_13IN3E_WriteLineM(line_buffer);
-    master_bytes += bytes_read;
-    if ((y % 100) == 0) {
-      Serial.printf("Progress: %d%%\r", (y * 100) / EPD_HEIGHT);
-      esp_task_wdt_reset();  // Reset watchdog during long download
-    }
-  }
-  EPD_13IN3E_EndFrameM();
-  
-  // Slave controller (right half)
-  EPD_13IN3E_BeginFrameS();
-  size_t slave_bytes = 0;
-  for (int y = 0; y < EPD_HEIGHT; y++) {
-    int bytes_read = stream->readBytes(line_buffer, BYTES_PER_LINE_HALF);
-    if (bytes_read != BYTES_PER_LINE_HALF) {
-      Serial.printf("Stream error at line %d\n", y);
-      break;
-    }
-    EPD_13IN3E_WriteLineS(line_buffer);
-    slave_bytes += bytes_read;
-    if ((y % 100) == 0) {
-      esp_task_wdt_reset();  // Reset watchdog during long download  
-    }
+  // The driver loads the station config from NVS once in STA mode
+  WiFi.mode(WIFI_STA);
+  wifi_config_t conf;
+  if (esp_wifi_get_config(WIFI_IF_STA, &conf) != ESP_OK || conf.sta.ssid[0] == '\0') {
+    Serial.println("Fast wake: no stored WiFi credentials, full boot");
+    return false;
   }
-  EPD_13IN3E_EndFrameS();
-  
-  http.end();
-  
-  // Verify complete data transfer
-  size_t expected_bytes = (size_t)EPD_HEIGHT * BYTES_PER_LINE_HALF;
-  if (master_bytes == expected_bytes && slave_bytes == expected_bytes) {
-    Serial.println("\nRefreshing display...");
-    EPD_13IN3E_RefreshNow();
-    Serial.println("Display update complete");
-    EPD_13IN3E_PowerOff();
-    return true;
+  char ssid[sizeof(conf.sta.ssid) + 1];
+  char pass[sizeof(conf.sta.password) + 1];
+  memcpy(ssid, conf.sta.ssid, sizeof(conf.sta.ssid));
+  ssid[sizeof(conf.sta.ssid)] = '\0';
+  memcpy(pass, conf.sta.password, sizeof(conf.sta.password));
+  pass[sizeof(conf.sta.password)] = '\0';
+  // Straight to the remembered access point, or a normal scan if the last
+  // cycle ended without one
+  if (RtcState_HasAccessPoint(&rtc_state)) {
+    WiFi.begin(ssid, pass, rtc_state.wifi_channel, rtc_state.wifi_bssid);
   } else {
-    Serial.println("Incomplete data transfer");
+    WiFi.begin(ssid, pass);
+  }
+  while (WiFi.status() != WL_CONNECTED && millis() - wake_start < FAST_WAKE_WIFI_MS) {
+    delay(20);
+  }
+  if (WiFi.status() != WL_CONNECTED) {
+    Serial.println("Fast wake: WiFi join failed, full boot");
+    WiFi.disconnect(true);
     return false;
   }
+  esp_wifi_set_ps(WIFI_PS_MAX_MODEM);
+  rtc_state.wakes++;
+  
+  RtcState_Restore(&rtc_state, &update, server_host, sizeof(server_host),
+                   server_port, sizeof(server_port));
+  spi_cmd_mhz = rtc_state.spi_cmd_mhz;
+  spi_bulk_mhz = rtc_state.spi_bulk_mhz;
+  clock_base_s = rtc_state.clock_s;
+  
+  DEV_Module_Init();
+  applyClockProfile();
+  FrameStore_Init(FRAME_UPDATE_RECORD_BYTES);
+  Serial.printf("Fast wake #%" PRIu32 ": WiFi in %lu ms\n", rtc_state.wakes, millis() - wake_start);
+  return true;
+}
+
+/**
+ * Save what the next timer wake needs into RTC memory and deep sleep
+ */
+void enterDeepSleep(uint32_t sleep_s) {
+  RtcState_Save(&rtc_state, &update, server_host, server_port);
+  // BSSID() is NULL (and channel() meaningless) without a joined station
+  uint8_t *bssid = WiFi.status() == WL_CONNECTED ? WiFi.BSSID() : NULL;
+  RtcState_SetAccessPoint(&rtc_state, bssid, bssid ? WiFi.channel() : 0);
+  rtc_state.spi_cmd_mhz = spi_cmd_mhz;
+  rtc_state.spi_bulk_mhz = spi_bulk_mhz;
+  rtc_state.clock_s = clock_base_s + millis() / 1000 + sleep_s;
+  
+  Serial.printf("Entering deep sleep (%" PRIu32 "s) after %lu ms awake\n", sleep_s, millis());
+  Serial.flush();
+  esp_sleep_enable_timer_wakeup((uint64_t)sleep_s * 1000000ULL);
+  esp_deep_sleep_start();
 }
 
 /**
@@ -365,11 +460,29 @@ void setup() {
   // Optimize power consumption
   setCpuFrequencyMhz(160);
   
+  // server_host/server_port are filled in below (or by fastWake)
+  FrameUpdate_Init(&update, server_host, 0);
+  update.prefetch = FRAME_PREFETCH;
+  update.conditional = FRAME_CONDITIONAL;
+  
+  // Timer wake: straight to loop() and the poll
+  if (DEEP_SLEEP_MODE && fastWake()) {
+    return;
+  }
+  
   // Initialize hardware
   DEV_Module_Init();
   
+  // Frame already on screen survives reboots; no need to fetch it again
+  if (FrameStore_Init(FRAME_UPDATE_RECORD_BYTES) && FrameStore_Hash()[0]) {
+    strncpy(update.last_hash, FrameStore_Hash(), sizeof(update.last_hash) - 1);
+    Serial.printf("Frame store: current frame %s, %u of %u slots cached\n", update.last_hash,
+                  FrameStore_Cached(), FrameStore_Slots());
+  }
+  
   // Load saved configuration or use defaults
   loadConfiguration();
+  applyClockProfile();
   
   // If no saved host, use default from WiFiConfig.h
   if (strlen(server_host) == 0) {
@@ -386,11 +499,19 @@ void setup() {
   // Create custom parameters for server configuration (use new to keep in heap)
   custom_server_host = new WiFiManagerParameter("server", "Server Host/IP", server_host, 47);
   custom_server_port = new WiFiManagerParameter("port", "Server Port", server_port, 7);
+  char cmd_mhz_str[4];
+  char bulk_mhz_str[4];
+  snprintf(cmd_mhz_str, sizeof(cmd_mhz_str), "%" PRIu32, spi_cmd_mhz);
+  snprintf(bulk_mhz_str, sizeof(bulk_mhz_str), "%" PRIu32, spi_bulk_mhz);
+  custom_spi_cmd_mhz = new WiFiManagerParameter("spi_cmd", "SPI Command Clock (MHz)", cmd_mhz_str, 3);
+  custom_spi_bulk_mhz = new WiFiManagerParameter("spi_bulk", "SPI Pixel Clock (MHz, short cables: 20+)", bulk_mhz_str, 3);
   WiFiManagerParameter custom_html("<p style='color:#666;font-size:12px;margin-top:20px;'>Configure your image server endpoint above</p>");
   
   // Add parameters to WiFiManager
   wm.addParameter(custom_server_host);
   wm.addParameter(custom_server_port);
+  wm.addParameter(custom_spi_cmd_mhz);
+  wm.addParameter(custom_spi_bulk_mhz);
   wm.addParameter(&custom_html);
   
   wm.setConfigPortalTimeout(180);  // 3 minutes timeout
@@ -412,10 +533,28 @@ void setup() {
       Serial.printf("New server config: %s:%s\n", server_host, server_port);
       saveConfiguration(server_host, server_port);
     }
+    if (custom_spi_cmd_mhz && custom_spi_bulk_mhz) {
+      uint32_t cmd_mhz = atoi(custom_spi_cmd_mhz->getValue());
+      uint32_t bulk_mhz = atoi(custom_spi_bulk_mhz->getValue());
+      if (cmd_mhz > 0 && bulk_mhz > 0) {
+        uint32_t prev_cmd_mhz = spi_cmd_mhz;
+        uint32_t prev_bulk_mhz = spi_bulk_mhz;
+        spi_cmd_mhz = clampClockMhz(cmd_mhz);
+        spi_bulk_mhz = clampClockMhz(bulk_mhz);
+        Serial.printf("New SPI clocks: %" PRIu32 "/%" PRIu32 " MHz\n", spi_cmd_mhz, spi_bulk_mhz);
+        if (applyClockProfile()) {
+          saveClockProfile(spi_cmd_mhz, spi_bulk_mhz);
+        } else {
+          spi_cmd_mhz = prev_cmd_mhz;
+          spi_bulk_mhz = prev_bulk_mhz;
+        }
+      }
+    }
   });
   
   // Check for double reset
   bool forceConfig = detectDoubleReset();
+  bool config_screen_shown = forceConfig;  // Config screen replaces the stored frame
   
   if (forceConfig) {
     Serial.println("Double reset detected! Starting config portal...");
@@ -424,7 +563,7 @@ void setup() {
     EPD_13IN3E_PowerOn();
     EPD_13IN3E_Init();
     // Special config mode: battery_pct = -2 triggers config display
-    EPD_13IN3E_ShowBootSplash("E-Ink-Setup", 0, -2);  // -2 = Config mode
+    showBootSplash("E-Ink-Setup", -2);  // -2 = Config mode
     EPD_13IN3E_PowerOff();
     
     // Disable watchdog during config portal (blocking operation)
@@ -461,8 +600,9 @@ void setup() {
         // Show config mode on display
         EPD_13IN3E_PowerOn();
         EPD_13IN3E_Init();
-        EPD_13IN3E_ShowBootSplash("E-Ink-Setup", 0, -2);
+        showBootSplash("E-Ink-Setup", -2);
         EPD_13IN3E_PowerOff();
+        config_screen_shown = true;
         
         // Disable watchdog during config
         esp_task_wdt_delete(NULL);
@@ -485,19 +625,28 @@ void setup() {
   // Enable power saving
   esp_wifi_set_ps(WIFI_PS_MAX_MODEM);
   Serial.println("WiFi power saving enabled");
+  if (NET_Wake_Begin(WAKE_PORT, WAKE_KEY)) {
+    Serial.printf("Wake listener on UDP port %u\n", WAKE_PORT);
+  }
 
-  // Display boot screen
-  EPD_13IN3E_PowerOn();
-  EPD_13IN3E_Init();
-  int battery_level = getBatteryLevel();
-  EPD_13IN3E_ShowBootSplash(WIFI_SSID, VPS_PORT, battery_level);
-  delay(1000);
-  EPD_13IN3E_PowerOff();
+  // Display boot screen, unless the stored frame is (or can be put back) on screen
+  if (FrameStore_Hash()[0] && !config_screen_shown) {
+    Serial.println("Stored frame still on screen, boot splash skipped");
+  } else if (FrameStore_Hash()[0]) {
+    FrameUpdate_Redraw();
+  } else {
+    EPD_13IN3E_PowerOn();
+    EPD_13IN3E_Init();
+    int battery_level = getBatteryLevel();
+    showBootSplash(WIFI_SSID, battery_level);
+    delay(1000);
+    EPD_13IN3E_PowerOff();
+  }
 
   // Build server URL from configuration
   snprintf(server_url, sizeof(server_url), "http://%s:%s", server_host, server_port);
   Serial.printf("Monitoring server: %s\n", server_url);
-  Serial.println("Checking for updates every 18 seconds");
+  Serial.printf("Checking for updates every %u seconds (or as the server paces it)\n", POLL_INTERVAL_S + 3);
   
   // Cleanup WiFiManager parameters (no longer needed)
   if (custom_server_host) {
@@ -508,6 +657,14 @@ void setup() {
     delete custom_server_port;
     custom_server_port = nullptr;
   }
+  if (custom_spi_cmd_mhz) {
+    delete custom_spi_cmd_mhz;
+    custom_spi_cmd_mhz = nullptr;
+  }
+  if (custom_spi_bulk_mhz) {
+    delete custom_spi_bulk_mhz;
+    custom_spi_bulk_mhz = nullptr;
+  }
   
   // Clear double reset counter after successful boot
   delay(10000);  // Wait 10 seconds for user to potentially double reset
@@ -530,13 +687,74 @@ void loop() {
   }
   
   // Check for image updates
-  if (checkForNewImage()) {
-    Serial.println("Updating display...");
-    if (updateDisplay()) {
+  NET_Stream_ResetConnStats();
+  cycle_battery_pct = getBatteryLevel();
+  update.battery_pct = cycle_battery_pct;
+  update.port = atoi(server_port);  // The config portal may have changed it
+  uint8_t outcome = TELEMETRY_POLL;
+  if (FRAME_CONDITIONAL) {
+    // One request per cycle: 304, or the new frame right away
+    FrameUpdate_BeginConditional(&update);
+    if (FrameUpdate_Show(&update)) {
       Serial.println("Update successful");
-    } else {
-      Serial.println("Update failed");
+      outcome = TELEMETRY_UPDATE;
     }
+  } else {
+    bool news = FrameUpdate_Check(&update, INFO_LONG_POLL_S);
+    esp_task_wdt_reset();  // A held request ends a slice short of the timeout
+    if (news) {
+      Serial.println("Updating display...");
+      if (FrameUpdate_Show(&update)) {
+        Serial.println("Update successful");
+        outcome = TELEMETRY_UPDATE;
+      } else {
+        Serial.println("Update failed");
+        outcome = TELEMETRY_FAILED;
+        update.next_poll_s = POLL_INTERVAL_S;  // No immediate retry loop on a failing download
+      }
+    }
+  }
+  esp_task_wdt_reset();  // Telemetry is one more request
+  recordTelemetry(outcome);
+  NET_Stream_ConnStats conn = NET_Stream_GetConnStats();
+  Serial.printf("Connections: %" PRIu32 " requests, %" PRIu32 " new, %" PRIu32 " reused, "
+                "%" PRIu32 " stale, %" PRIu32 " DNS lookups, %" PRIu32 " ms connecting, "
+                "%" PRIu32 " ms to first byte\n",
+                conn.requests, conn.connects, conn.reused, conn.stale, conn.dns_lookups,
+                conn.connect_ms, conn.ttfb_ms);
+  
+  uint32_t uptime_s = clock_base_s + millis() / 1000;
+  Serial.printf("Info requests: %" PRIu32 " (%u per hour)\n", update.info_requests,
+                uptime_s ? (unsigned)((uint64_t)update.info_requests * 3600 / uptime_s) : 0);
+  // Largest block falling behind free heap over days would mean fragmentation
+  Serial.printf("Heap: %u free, largest block %u\n", ESP.getFreeHeap(), ESP.getMaxAllocHeap());
+  
+  // A long-polling server answers when there is news: ask again at once
+  if (update.next_poll_s == 0) {
+    esp_task_wdt_reset();
+    return;
+  }
+  
+  if (DEEP_SLEEP_MODE) {
+    enterDeepSleep(update.next_poll_s);
+  }
+  
+  // With the wake listener the radio must stay up: modem sleep instead of
+  // light sleep, and a notice cuts the wait short
+  if (NET_Wake_Active()) {
+    Serial.printf("Waiting for wake notice (%" PRIu32 "s)...\n", update.next_poll_s);
+    NET_Wake_Notice notice;
+    for (uint32_t left = update.next_poll_s; left > 0; ) {
+      uint32_t chunk = left < SLEEP_CHUNK_S ? left : SLEEP_CHUNK_S;
+      if (NET_Wake_Wait(chunk * 1000, &notice)) {
+        handleWakeNotice(&notice);
+        break;
+      }
+      esp_task_wdt_reset();
+      left -= chunk;
+    }
+    esp_task_wdt_reset();
+    return;
   }
   
   // Power management cycle
@@ -547,11 +765,16 @@ void loop() {
   delay(3000);
   esp_task_wdt_reset();
   
-  Serial.println("Entering light sleep (15s)...");
+  Serial.printf("Entering light sleep (%" PRIu32 "s)...\n", update.next_poll_s);
   Serial.flush();
   delay(100);
-  esp_sleep_enable_timer_wakeup(15000000);
-  esp_light_sleep_start();
+  for (uint32_t left = update.next_poll_s; left > 0; ) {
+    uint32_t chunk = left < SLEEP_CHUNK_S ? left : SLEEP_CHUNK_S;
+    esp_sleep_enable_timer_wakeup((uint64_t)chunk * 1000000ULL);
+    esp_light_sleep_start();
+    esp_task_wdt_reset();
+    left -= chunk;
+  }
   
   delay(100);
   Serial.println("System wake-up");
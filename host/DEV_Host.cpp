@@ -0,0 +1,418 @@
+/**
+ * Host Implementation of the Hardware Layer
+ *
+ * See DEV_Host.h. Single-threaded by design, like the panel code it serves;
+ * only the clock may be read from other threads.
+ *
+ * @author Stephane Bhiri
+ * @version 2.0
+ * @date January 2025
+ */
+
+#include "DEV_Host.h"
+#include "EPD_13in3e.h"
+#include "esp_rom_crc.h"
+#include <atomic>
+#include <chrono>
+
+#define DEV_HOST_PINS  40
+#ifdef EPD_DUAL_BUS
+  #define DEV_HOST_BUS_COUNT 2
+#else
+  #define DEV_HOST_BUS_COUNT 1
+#endif
+
+// Same block staging as DEV_Config.cpp, on the virtual clock
+typedef struct {
+  UBYTE    block[2][SPI_DMA_BLOCK_SIZE];
+  UBYTE    block_active;         // Block currently being filled
+  UDOUBLE  block_len;
+  UBYTE    in_flight;            // Blocks queued but not yet reaped
+  uint64_t done_us[2];           // When each of them is off the wire, oldest first
+  uint64_t free_us;              // When everything queued is off the wire
+  DEV_Host_Bus stats;
+} DEV_Host_SpiBus;
+
+typedef struct {
+  DEV_Host_Controller stats;
+  UWORD cs_pin;
+  bool  selected;
+  bool  expect_cmd;            // Next byte is a command (CS just fell)
+  UBYTE cmd;
+} DEV_Host_Panel;
+
+static DEV_Host_Panel host_panel[2];
+static UBYTE host_level[DEV_HOST_PINS];
+static UDOUBLE host_busy_until_ms = 0;
+static UDOUBLE host_pon_ms = 30;
+static UDOUBLE host_refresh_ms = 20000;
+static std::atomic<uint64_t> host_clock_offset_us(0);
+static DEV_Host_Watchdog host_wdt;
+static UDOUBLE host_wdt_last_ms = 0;
+static DEV_SPI_Stats host_stats;
+static UDOUBLE host_cmd_hz = SPI_CMD_SPEED_HZ;
+static UDOUBLE host_bulk_hz = SPI_BULK_SPEED_HZ;
+static UBYTE host_target = DEV_BUS_ALL;
+static DEV_Host_SpiBus host_bus[DEV_HOST_BUS_COUNT];
+
+// ========== Virtual clock ==========
+
+// Real time since the first call plus everything DEV_Delay_ms skipped
+static uint64_t DEV_Host_Now_us(void)
+{
+  static const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  uint64_t real = std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - start).count();
+  return real + host_clock_offset_us.load();
+}
+
+UDOUBLE DEV_Time_us(void)
+{
+  return (UDOUBLE)DEV_Host_Now_us();
+}
+
+UDOUBLE DEV_Time_ms(void)
+{
+  return (UDOUBLE)(DEV_Host_Now_us() / 1000);
+}
+
+void DEV_Delay_ms(UDOUBLE ms)
+{
+  host_clock_offset_us += (uint64_t)ms * 1000;
+}
+
+void DEV_Watchdog_Reset(void)
+{
+  UDOUBLE now = DEV_Time_ms();
+  if (host_wdt.feeds > 0 && now - host_wdt_last_ms > host_wdt.max_gap_ms) {
+    host_wdt.max_gap_ms = now - host_wdt_last_ms;
+  }
+  host_wdt.feeds++;
+  host_wdt_last_ms = now;
+}
+
+// ========== Panel model ==========
+
+static void DEV_Host_Receive(DEV_Host_Panel *p, const UBYTE *data, UDOUBLE len)
+{
+  DEV_Host_Controller *c = &p->stats;
+  UDOUBLE i = 0;
+
+  if (len > 0 && p->expect_cmd) {
+    p->expect_cmd = false;
+    p->cmd = data[i++];
+    c->commands++;
+    c->reg_len[p->cmd] = 0;
+    if (p->cmd == PON) {
+      host_busy_until_ms = DEV_Time_ms() + host_pon_ms;
+    } else if (p->cmd == DRF) {
+      host_busy_until_ms = DEV_Time_ms() + host_refresh_ms;
+      c->refreshes++;
+    } else if (p->cmd == POF) {
+      c->power_offs++;
+    }
+  }
+  if (i == len) return;
+
+  UDOUBLE n = len - i;
+  c->data_bytes += n;
+  if (p->cmd == DTM) {
+    c->dtm_bytes += n;
+    c->dtm_crc = esp_rom_crc32_le(c->dtm_crc, data + i, n);
+    return;
+  }
+  for (; i < len; i++) {
+    UBYTE at = c->reg_len[p->cmd];
+    if (at < DEV_HOST_REG_BYTES) c->reg[p->cmd][at] = data[i];
+    if (at < 255) c->reg_len[p->cmd] = at + 1;
+  }
+}
+
+// Bytes clocked out on the given bus(es) reach every selected controller on them
+static void DEV_Host_Clock(UBYTE buses, const UBYTE *data, UDOUBLE len)
+{
+  for (int i = 0; i < 2; i++) {
+#ifdef EPD_DUAL_BUS
+    if (!(buses & (1 << i))) continue;
+#else
+    (void)buses;
+#endif
+    if (host_panel[i].selected) DEV_Host_Receive(&host_panel[i], data, len);
+  }
+}
+
+void DEV_Host_Reset(void)
+{
+  memset(host_panel, 0, sizeof(host_panel));
+  host_panel[0].cs_pin = EPD_CS_M_PIN;
+  host_panel[1].cs_pin = EPD_CS_S_PIN;
+  memset(host_level, 0, sizeof(host_level));
+  host_level[EPD_CS_M_PIN] = 1;
+  host_level[EPD_CS_S_PIN] = 1;
+  host_busy_until_ms = DEV_Time_ms();
+  memset(&host_wdt, 0, sizeof(host_wdt));
+  memset(&host_stats, 0, sizeof(host_stats));
+  memset(host_bus, 0, sizeof(host_bus));
+  host_cmd_hz = SPI_CMD_SPEED_HZ;
+  host_bulk_hz = SPI_BULK_SPEED_HZ;
+  host_target = DEV_BUS_ALL;
+}
+
+void DEV_Host_SetBusyTime(UDOUBLE pon_ms, UDOUBLE refresh_ms)
+{
+  host_pon_ms = pon_ms;
+  host_refresh_ms = refresh_ms;
+}
+
+// Bounds of the RTC_DATA_ATTR section (esp_attr.h), from the linker; weak
+// so that a test without any RTC variable still links
+extern "C" char __start_host_rtc_data[] __attribute__((weak));
+extern "C" char __stop_host_rtc_data[] __attribute__((weak));
+
+void DEV_Host_RtcPowerLoss(void)
+{
+  if (__start_host_rtc_data) {
+    memset(__start_host_rtc_data, 0, __stop_host_rtc_data - __start_host_rtc_data);
+  }
+}
+
+const DEV_Host_Controller *DEV_Host_GetController(UBYTE index)
+{
+  return index < 2 ? &host_panel[index].stats : NULL;
+}
+
+DEV_Host_Watchdog DEV_Host_GetWatchdog(void)
+{
+  return host_wdt;
+}
+
+DEV_Host_Bus DEV_Host_GetBus(UBYTE index)
+{
+  DEV_Host_Bus none = {0, 0, 0};
+  return index < DEV_HOST_BUS_COUNT ? host_bus[index].stats : none;
+}
+
+void DEV_Host_GetClocks(UDOUBLE *cmd_hz, UDOUBLE *bulk_hz)
+{
+  *cmd_hz = host_cmd_hz;
+  *bulk_hz = host_bulk_hz;
+}
+
+// ========== GPIO ==========
+
+void DEV_Digital_Write(UWORD pin, UBYTE val)
+{
+  if (pin >= DEV_HOST_PINS) return;
+  for (int i = 0; i < 2; i++) {
+    DEV_Host_Panel *p = &host_panel[i];
+    if (p->cs_pin != pin) continue;
+    if (!val && !p->selected) p->expect_cmd = true;
+    p->selected = !val;
+  }
+  host_level[pin] = val ? 1 : 0;
+  if (pin == EPD_CS_M_PIN || pin == EPD_CS_S_PIN || pin == EPD_DC_PIN || pin == EPD_RST_PIN) {
+    DEV_TRACE(DEV_TRACE_GPIO, (UBYTE)(pin | (val ? 0x80 : 0)), 0, NULL);
+  }
+}
+
+UBYTE DEV_Digital_Read(UWORD pin)
+{
+  if (pin == EPD_BUSY_PIN) {
+    return (int32_t)(DEV_Time_ms() - host_busy_until_ms) >= 0 ? 1 : 0;
+  }
+  return pin < DEV_HOST_PINS ? host_level[pin] : 0;
+}
+
+// ========== Module and SPI ==========
+
+int DEV_Module_Init(void)
+{
+  DEV_Digital_Write(EPD_CS_M_PIN, 1);
+  DEV_Digital_Write(EPD_CS_S_PIN, 1);
+  DEV_Digital_Write(EPD_DC_PIN, 1);
+  DEV_Digital_Write(EPD_RST_PIN, 1);
+  return 0;
+}
+
+void DEV_Module_Exit(void)
+{
+  DEV_Digital_Write(EPD_CS_M_PIN, 1);
+  DEV_Digital_Write(EPD_CS_S_PIN, 1);
+}
+
+static UBYTE DEV_SPI_TargetBuses(void)
+{
+#ifdef EPD_DUAL_BUS
+  return host_target;
+#else
+  return 0x01;
+#endif
+}
+
+static int DEV_SPI_BusIndex(UBYTE target)
+{
+#ifdef EPD_DUAL_BUS
+  return (target & DEV_BUS_M) ? 0 : 1;
+#else
+  (void)target;
+  return 0;
+#endif
+}
+
+// Virtual time to clock len bytes out at hz
+static uint64_t DEV_Host_WireTime_us(UDOUBLE len, UDOUBLE hz)
+{
+  return ((uint64_t)len * 8 * 1000000 + hz - 1) / hz;
+}
+
+// The CPU blocks on the bus until the given virtual time
+static void DEV_Host_WaitUntil(DEV_Host_SpiBus *bus, uint64_t until_us)
+{
+  uint64_t now = DEV_Host_Now_us();
+  if (until_us <= now) return;
+  host_clock_offset_us += until_us - now;
+  bus->stats.wait_us += until_us - now;
+}
+
+// Queue the active block for "DMA" and switch to the other one. The bytes
+// reach the panel model at once; the time they take on the wire is only
+// waited for when their block is needed again, or at the fence.
+static void DEV_SPI_QueueBlock(int b)
+{
+  DEV_Host_SpiBus *bus = &host_bus[b];
+  if (bus->block_len == 0) return;
+
+  UBYTE *block = bus->block[bus->block_active];
+  DEV_TRACE(DEV_TRACE_DATA, (UBYTE)(b | DEV_TRACE_BULK), bus->block_len, block);
+  DEV_Host_Clock(1 << b, block, bus->block_len);
+  host_stats.transactions++;
+  host_stats.bytes += bus->block_len;
+  uint64_t wire_us = DEV_Host_WireTime_us(bus->block_len, host_bulk_hz);
+  uint64_t start = std::max(DEV_Host_Now_us(), bus->free_us);
+  bus->free_us = start + wire_us;
+  bus->stats.blocks++;
+  bus->stats.wire_us += wire_us;
+  bus->done_us[bus->in_flight++] = bus->free_us;
+
+  bus->block_active ^= 1;
+  bus->block_len = 0;
+
+  // The block we switched to may still be on the wire (queued two rounds ago)
+  if (bus->in_flight == 2) {
+    DEV_Host_WaitUntil(bus, bus->done_us[0]);
+    bus->done_us[0] = bus->done_us[1];
+    bus->in_flight = 1;
+  }
+}
+
+// Polled transfer on the command clock: the CPU waits for every byte
+static void DEV_SPI_Poll(const UBYTE *data, UDOUBLE len, bool payload)
+{
+  UBYTE buses = DEV_SPI_TargetBuses();
+  for (int b = 0; b < DEV_HOST_BUS_COUNT; b++) {
+    if (!(buses & (1 << b))) continue;
+    if (payload) {
+      DEV_TRACE(DEV_TRACE_DATA, (UBYTE)b, len, data);
+    }
+    uint64_t wire_us = DEV_Host_WireTime_us(len, host_cmd_hz);
+    host_clock_offset_us += wire_us;
+    host_bus[b].stats.wire_us += wire_us;
+    host_stats.transactions++;
+    host_stats.bytes += len;
+  }
+  DEV_Host_Clock(buses, data, len);
+}
+
+bool DEV_SPI_SetClockProfile(UDOUBLE cmd_hz, UDOUBLE bulk_hz)
+{
+  DEV_SPI_Bulk_Flush();
+  host_cmd_hz = std::min(std::max(cmd_hz, (UDOUBLE)SPI_MIN_SPEED_HZ), (UDOUBLE)SPI_MAX_SPEED_HZ);
+  host_bulk_hz = std::min(std::max(bulk_hz, (UDOUBLE)SPI_MIN_SPEED_HZ), (UDOUBLE)SPI_MAX_SPEED_HZ);
+  DEV_TRACE(DEV_TRACE_CLOCK, 0, (UWORD)(host_cmd_hz / 1000), NULL);
+  DEV_TRACE(DEV_TRACE_CLOCK, 1, (UWORD)(host_bulk_hz / 1000), NULL);
+  return true;
+}
+
+void DEV_SPI_SetTarget(UBYTE target)
+{
+  DEV_SPI_Bulk_Flush();
+  host_target = target & DEV_BUS_ALL;
+}
+
+void DEV_SPI_WriteByte(UBYTE data)
+{
+  DEV_SPI_Bulk_Flush();  // Polling and queued transfers must not interleave
+  DEV_TRACE(DEV_TRACE_CMD, data, 1, &data);
+  DEV_SPI_Poll(&data, 1, false);
+}
+
+void DEV_SPI_Write_nByte(UBYTE *data, UDOUBLE len)
+{
+  if (len == 0) return;
+  DEV_SPI_Bulk_Flush();
+  DEV_SPI_Poll(data, len, true);
+}
+
+UBYTE *DEV_SPI_Bulk_ReserveOn(UBYTE target, UDOUBLE len)
+{
+  int b = DEV_SPI_BusIndex(target);
+  if (len > SPI_DMA_BLOCK_SIZE) return NULL;
+  if (host_bus[b].block_len + len > SPI_DMA_BLOCK_SIZE) {
+    DEV_SPI_QueueBlock(b);
+  }
+  return host_bus[b].block[host_bus[b].block_active] + host_bus[b].block_len;
+}
+
+void DEV_SPI_Bulk_CommitOn(UBYTE target, UDOUBLE len)
+{
+  int b = DEV_SPI_BusIndex(target);
+  host_bus[b].block_len += len;
+  if (host_bus[b].block_len == SPI_DMA_BLOCK_SIZE) {
+    DEV_SPI_QueueBlock(b);
+  }
+}
+
+void DEV_SPI_Bulk_Flush(void)
+{
+  for (int b = 0; b < DEV_HOST_BUS_COUNT; b++) {
+    DEV_SPI_QueueBlock(b);
+  }
+  for (int b = 0; b < DEV_HOST_BUS_COUNT; b++) {
+    if (host_bus[b].in_flight > 0) {
+      DEV_Host_WaitUntil(&host_bus[b], host_bus[b].free_us);
+      host_bus[b].in_flight = 0;
+    }
+  }
+}
+
+void DEV_SPI_Bulk_Write(const UBYTE *data, UDOUBLE len)
+{
+  UBYTE buses = DEV_SPI_TargetBuses();
+  for (int b = 0; b < DEV_HOST_BUS_COUNT; b++) {
+    if (!(buses & (1 << b))) continue;
+    UBYTE target = (UBYTE)(1 << b);
+    const UBYTE *src = data;
+    UDOUBLE remaining = len;
+    while (remaining > 0) {
+      UDOUBLE chunk = SPI_DMA_BLOCK_SIZE - host_bus[b].block_len;
+      if (chunk > remaining) chunk = remaining;
+      memcpy(DEV_SPI_Bulk_ReserveOn(target, chunk), src, chunk);
+      DEV_SPI_Bulk_CommitOn(target, chunk);
+      src += chunk;
+      remaining -= chunk;
+    }
+  }
+}
+
+void DEV_SPI_ResetStats(void)
+{
+  memset(&host_stats, 0, sizeof(host_stats));
+  for (int b = 0; b < DEV_HOST_BUS_COUNT; b++) {
+    memset(&host_bus[b].stats, 0, sizeof(host_bus[b].stats));
+  }
+}
+
+DEV_SPI_Stats DEV_SPI_GetStats(void)
+{
+  return host_stats;
+}
@@ -0,0 +1,94 @@
+/**
+ * Host Implementation of the Hardware Layer
+ *
+ * Stands in for DEV_Config.cpp when the sources are built on Linux
+ * (CMakeLists.txt defines DEV_HOST). GPIO and SPI traffic drive a model of
+ * the two panel controllers: the first byte after a CS falling edge is the
+ * command, the rest is its payload, and DTM payloads are counted and
+ * checksummed. The SPI side stages bulk data in the same ping-pong blocks
+ * as DEV_Config.cpp and charges their wire time to the virtual clock, so
+ * transaction counts, DMA overlap and the bus trace match the device. BUSY goes low for a configurable time after PON and DRF.
+ * DEV_Delay_ms advances a virtual clock instead of sleeping, so a 20 s
+ * refresh costs nothing, and watchdog feeds are timed against that clock.
+ * The "frames" flash partition lives in a file (esp_partition.h), with
+ * power cuts injected between or in the middle of flash operations; RTC
+ * slow memory is a section that a simulated power loss clears.
+ *
+ * @author Stephane Bhiri
+ * @version 2.0
+ * @date January 2025
+ */
+
+#ifndef DEV_HOST_H
+#define DEV_HOST_H
+
+#include "DEV_Config.h"
+
+#define DEV_HOST_REG_BYTES  16   // Payload bytes kept per register
+
+typedef struct {
+  UDOUBLE commands;              // Command bytes received
+  UDOUBLE data_bytes;            // Payload bytes after them
+  UDOUBLE dtm_bytes;             // Pixel bytes (DTM payload)
+  UDOUBLE dtm_crc;               // CRC32 of the pixel bytes, in order
+  UDOUBLE refreshes;             // DRF commands
+  UDOUBLE power_offs;            // POF commands
+  UBYTE   reg_len[256];          // Payload length of the last write per register
+  UBYTE   reg[256][DEV_HOST_REG_BYTES];
+} DEV_Host_Controller;
+
+typedef struct {
+  UDOUBLE feeds;
+  UDOUBLE max_gap_ms;            // Longest time between two feeds
+} DEV_Host_Watchdog;
+
+typedef struct {
+  UDOUBLE blocks;                // DMA blocks queued
+  UDOUBLE wire_us;               // Time spent clocking bytes out, polled writes included
+  UDOUBLE wait_us;               // Time the CPU stood waiting for a block to leave the wire
+} DEV_Host_Bus;
+
+typedef struct {
+  UDOUBLE ops;                   // Write and erase calls
+  UDOUBLE read_bytes;
+  UDOUBLE write_bytes;
+  UDOUBLE erased_sectors;
+  UDOUBLE busy_ms;               // Flash time the above take on typical SPI NOR
+} DEV_Host_Flash;
+
+// Back to power-on state: controllers cleared, CS high, BUSY released
+void DEV_Host_Reset(void);
+
+// How long BUSY stays low after PON and after DRF
+void DEV_Host_SetBusyTime(UDOUBLE pon_ms, UDOUBLE refresh_ms);
+
+// 0 = master (CS_M), 1 = slave (CS_S)
+const DEV_Host_Controller* DEV_Host_GetController(UBYTE index);
+
+DEV_Host_Watchdog DEV_Host_GetWatchdog(void);
+
+// Per-bus timing since DEV_SPI_ResetStats (1 = HSPI, EPD_DUAL_BUS only)
+DEV_Host_Bus DEV_Host_GetBus(UBYTE index);
+
+// Clocks last applied by DEV_SPI_SetClockProfile
+void DEV_Host_GetClocks(UDOUBLE* cmd_hz, UDOUBLE* bulk_hz);
+
+// Back the "frames" partition with a file of size bytes (created erased,
+// contents kept across attaches) and clear the flash stats
+bool DEV_Host_AttachFlash(const char* path, UDOUBLE size);
+void DEV_Host_DetachFlash(void);
+
+// Power cut during the write or erase call ops calls from now (0 = the
+// next one): that call is only half done and every later one fails until
+// DEV_Host_FlashPowerOn, which is the reboot
+void DEV_Host_FlashCutAfter(UDOUBLE ops);
+void DEV_Host_FlashPowerOn(void);
+
+DEV_Host_Flash DEV_Host_GetFlash(void);
+
+// Power loss as RTC slow memory sees it: every RTC_DATA_ATTR variable back
+// to zero (all of them start zeroed). NVS (Preferences) and the frame
+// partition keep their contents.
+void DEV_Host_RtcPowerLoss(void);
+
+#endif
@@ -0,0 +1,25 @@
+/**
+ * Host stand-in for the Arduino-ESP32 MD5Builder (the subset FrameCheck
+ * uses), on a plain RFC 1321 implementation.
+ */
+
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+class MD5Builder {
+public:
+  void begin(void);
+  void add(const uint8_t* data, size_t len);
+  void calculate(void);
+  void getBytes(uint8_t* output) const;
+  void getChars(char* output) const;   // 32 hex chars + NUL
+
+private:
+  void transform(const uint8_t block[64]);
+
+  uint32_t state_[4];
+  uint64_t length_;
+  uint8_t  buffer_[64];
+  uint8_t  digest_[16];
+};
@@ -0,0 +1,39 @@
+#include "Preferences.h"
+#include <map>
+#include <mutex>
+
+static std::mutex nvs_lock;
+static std::map<std::string, std::map<std::string, uint32_t>> nvs;
+
+bool Preferences::begin(const char *name, bool readOnly)
+{
+  std::lock_guard<std::mutex> hold(nvs_lock);
+  if (readOnly && !nvs.count(name)) return false;
+  nvs[name];
+  name_ = name;
+  read_only_ = readOnly;
+  open_ = true;
+  return true;
+}
+
+void Preferences::end(void)
+{
+  open_ = false;
+}
+
+uint32_t Preferences::getUInt(const char *key, uint32_t defaultValue)
+{
+  std::lock_guard<std::mutex> hold(nvs_lock);
+  if (!open_) return defaultValue;
+  const std::map<std::string, uint32_t> &space = nvs[name_];
+  auto value = space.find(key);
+  return value == space.end() ? defaultValue : value->second;
+}
+
+size_t Preferences::putUInt(const char *key, uint32_t value)
+{
+  std::lock_guard<std::mutex> hold(nvs_lock);
+  if (!open_ || read_only_) return 0;
+  nvs[name_][key] = value;
+  return sizeof(value);
+}
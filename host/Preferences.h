@@ -0,0 +1,24 @@
+/**
+ * Host stand-in for the Arduino Preferences (NVS) class: namespaces of
+ * integer keys in process memory. Like NVS, they survive
+ * DEV_Host_RtcPowerLoss.
+ */
+
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+class Preferences {
+public:
+  // A read-only open of a namespace that was never written fails, as on NVS
+  bool begin(const char *name, bool readOnly = false);
+  void end(void);
+  uint32_t getUInt(const char *key, uint32_t defaultValue = 0);
+  size_t putUInt(const char *key, uint32_t value);
+
+private:
+  std::string name_;
+  bool open_ = false;
+  bool read_only_ = false;
+};
@@ -0,0 +1,12 @@
+/**
+ * Host stand-in for the ESP-IDF memory placement attributes: IRAM does not
+ * exist on the host, and RTC slow memory is a section of its own so that
+ * DEV_Host_RtcPowerLoss can clear it the way a power loss does.
+ */
+
+#pragma once
+#define IRAM_ATTR
+#define RTC_DATA_ATTR __attribute__((section("host_rtc_data")))
+#define RTC_NOINIT_ATTR
+#define WORD_ALIGNED_ATTR __attribute__((aligned(4)))
+#define DMA_ATTR WORD_ALIGNED_ATTR
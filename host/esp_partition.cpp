@@ -0,0 +1,151 @@
+/**
+ * Host Flash Partition
+ *
+ * See esp_partition.h. The busy time uses typical SPI NOR figures (4 KB
+ * sector erase 45 ms, page program 0.7 ms per 256 bytes, reads at 40 MHz
+ * quad I/O), so staging and commit costs can be compared between runs.
+ *
+ * @author Stephane Bhiri
+ * @version 2.0
+ * @date January 2025
+ */
+
+#include "esp_partition.h"
+#include "DEV_Host.h"
+#include "FrameStore.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define HOST_FLASH_SECTOR      0x1000
+#define HOST_FLASH_ERASE_US    45000       // Per sector
+#define HOST_FLASH_PAGE_US     700         // Per 256-byte page
+#define HOST_FLASH_READ_NS     50          // Per byte
+
+static esp_partition_t host_part;
+static UBYTE *host_flash = NULL;
+static int host_flash_fd = -1;
+static DEV_Host_Flash host_flash_stats;
+static uint64_t host_flash_busy_us = 0;
+static UDOUBLE host_cut_in = 0;            // Calls left before the cut
+static bool host_cut_armed = false;
+static bool host_powered = true;
+
+bool DEV_Host_AttachFlash(const char *path, UDOUBLE size)
+{
+  DEV_Host_DetachFlash();
+  int fd = open(path, O_RDWR | O_CREAT, 0644);
+  struct stat st;
+  if (fd < 0 || fstat(fd, &st) != 0) return false;
+  bool fresh = st.st_size == 0;
+  if ((UDOUBLE)st.st_size != size && ftruncate(fd, size) != 0) {
+    close(fd);
+    return false;
+  }
+  void *map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (map == MAP_FAILED) {
+    close(fd);
+    return false;
+  }
+  host_flash = (UBYTE *)map;
+  host_flash_fd = fd;
+  if (fresh) memset(host_flash, 0xFF, size);
+
+  memset(&host_part, 0, sizeof(host_part));
+  host_part.type = ESP_PARTITION_TYPE_DATA;
+  host_part.subtype = FRAME_STORE_SUBTYPE;
+  host_part.size = size;
+  host_part.erase_size = HOST_FLASH_SECTOR;
+  strcpy(host_part.label, FRAME_STORE_LABEL);
+  memset(&host_flash_stats, 0, sizeof(host_flash_stats));
+  host_flash_busy_us = 0;
+  DEV_Host_FlashPowerOn();
+  return true;
+}
+
+void DEV_Host_DetachFlash(void)
+{
+  if (!host_flash) return;
+  munmap(host_flash, host_part.size);
+  close(host_flash_fd);
+  host_flash = NULL;
+  host_flash_fd = -1;
+}
+
+void DEV_Host_FlashCutAfter(UDOUBLE ops)
+{
+  host_cut_in = ops;
+  host_cut_armed = true;
+}
+
+void DEV_Host_FlashPowerOn(void)
+{
+  host_cut_armed = false;
+  host_powered = true;
+}
+
+DEV_Host_Flash DEV_Host_GetFlash(void)
+{
+  DEV_Host_Flash stats = host_flash_stats;
+  stats.busy_ms = (UDOUBLE)(host_flash_busy_us / 1000);
+  return stats;
+}
+
+// Bytes of a write or erase call that reach the flash: all of them, half
+// when the power goes during the call, none after
+static size_t DEV_Host_FlashOp(size_t size)
+{
+  if (!host_powered) return 0;
+  host_flash_stats.ops++;
+  if (host_cut_armed && host_cut_in-- == 0) {
+    host_powered = false;
+    return size / 2;
+  }
+  return size;
+}
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type,
+                                                esp_partition_subtype_t subtype,
+                                                const char *label)
+{
+  if (!host_flash || type != host_part.type || subtype != host_part.subtype) return NULL;
+  return !label || strcmp(label, host_part.label) == 0 ? &host_part : NULL;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t *partition, size_t src_offset,
+                             void *dst, size_t size)
+{
+  if (partition != &host_part || !host_flash) return ESP_ERR_INVALID_ARG;
+  if (src_offset > host_part.size || size > host_part.size - src_offset) return ESP_ERR_INVALID_SIZE;
+  memcpy(dst, host_flash + src_offset, size);
+  host_flash_stats.read_bytes += size;
+  host_flash_busy_us += (uint64_t)size * HOST_FLASH_READ_NS / 1000;
+  return ESP_OK;
+}
+
+// NOR programming only clears bits
+esp_err_t esp_partition_write(const esp_partition_t *partition, size_t dst_offset,
+                              const void *src, size_t size)
+{
+  if (partition != &host_part || !host_flash) return ESP_ERR_INVALID_ARG;
+  if (dst_offset > host_part.size || size > host_part.size - dst_offset) return ESP_ERR_INVALID_SIZE;
+  size_t n = DEV_Host_FlashOp(size);
+  const UBYTE *data = (const UBYTE *)src;
+  for (size_t i = 0; i < n; i++) host_flash[dst_offset + i] &= data[i];
+  host_flash_stats.write_bytes += n;
+  host_flash_busy_us += (uint64_t)(n + 255) / 256 * HOST_FLASH_PAGE_US;
+  return n == size ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t *partition, size_t offset, size_t size)
+{
+  if (partition != &host_part || !host_flash) return ESP_ERR_INVALID_ARG;
+  if (offset % HOST_FLASH_SECTOR || size % HOST_FLASH_SECTOR) return ESP_ERR_INVALID_ARG;
+  if (offset > host_part.size || size > host_part.size - offset) return ESP_ERR_INVALID_SIZE;
+  size_t n = DEV_Host_FlashOp(size);
+  memset(host_flash + offset, 0xFF, n);
+  host_flash_stats.erased_sectors += (n + HOST_FLASH_SECTOR - 1) / HOST_FLASH_SECTOR;
+  host_flash_busy_us += (uint64_t)(n + HOST_FLASH_SECTOR - 1) / HOST_FLASH_SECTOR * HOST_FLASH_ERASE_US;
+  return n == size ? ESP_OK : ESP_FAIL;
+}
@@ -0,0 +1,25 @@
+#include "esp_rom_crc.h"
+
+// Reflected CRC-32 (polynomial 0xEDB88320), table built on first use
+static const uint32_t *crc32_table(void)
+{
+  static uint32_t table[256];
+  static bool ready = []() {
+    for (uint32_t n = 0; n < 256; n++) {
+      uint32_t c = n;
+      for (int k = 0; k < 8; k++) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+      table[n] = c;
+    }
+    return true;
+  }();
+  (void)ready;
+  return table;
+}
+
+uint32_t esp_rom_crc32_le(uint32_t crc, const uint8_t *buf, uint32_t len)
+{
+  const uint32_t *table = crc32_table();
+  crc = ~crc;
+  while (len--) crc = table[(crc ^ *buf++) & 0xFF] ^ (crc >> 8);
+  return ~crc;
+}
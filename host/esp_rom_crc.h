@@ -0,0 +1,10 @@
+/**
+ * Host stand-in for the ESP32 ROM CRC routines (esp_rom_crc.cpp).
+ * Same convention as the ROM: the running value is passed and returned
+ * uninverted, so esp_rom_crc32_le(0, ...) equals zlib's crc32().
+ */
+
+#pragma once
+#include <stdint.h>
+
+uint32_t esp_rom_crc32_le(uint32_t crc, const uint8_t* buf, uint32_t len);
@@ -0,0 +1,12 @@
+/**
+ * Host stand-in for the ESP-IDF system API: a restart ends the process,
+ * so a test that reaches one fails loudly.
+ */
+
+#pragma once
+#include <stdlib.h>
+
+[[noreturn]] static inline void esp_restart(void)
+{
+  abort();
+}
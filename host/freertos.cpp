@@ -0,0 +1,76 @@
+/**
+ * Host FreeRTOS Tasks
+ *
+ * See freertos/task.h. Every thread gets its notification state on first
+ * use; a task's state lives as long as its thread, which is enough for
+ * FrameUpdate where only the waiting (caller's) task is ever notified.
+ *
+ * @author Stephane Bhiri
+ * @version 2.0
+ * @date January 2025
+ */
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+struct HostTask {
+  std::mutex lock;
+  std::condition_variable wake;
+  uint32_t notified = 0;
+};
+
+static thread_local HostTask host_task;
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t task, const char *name, uint32_t stack_depth,
+                                   void *arg, UBaseType_t priority, TaskHandle_t *handle,
+                                   BaseType_t core)
+{
+  (void)name;
+  (void)stack_depth;
+  (void)priority;
+  (void)core;
+  if (handle) {
+    *handle = NULL;  // Not needed by any caller yet
+  }
+  std::thread(task, arg).detach();
+  return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t task)
+{
+  (void)task;
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+  std::this_thread::sleep_for(std::chrono::milliseconds(ticks));
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+  return &host_task;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task)
+{
+  HostTask *t = (HostTask *)task;
+  std::lock_guard<std::mutex> hold(t->lock);
+  t->notified++;
+  t->wake.notify_one();
+  return pdPASS;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks)
+{
+  std::unique_lock<std::mutex> hold(host_task.lock);
+  host_task.wake.wait_for(hold, std::chrono::milliseconds(ticks), [] { return host_task.notified > 0; });
+  uint32_t count = host_task.notified;
+  if (count > 0) {
+    host_task.notified = clear_on_exit ? 0 : count - 1;
+  }
+  return count;
+}
@@ -0,0 +1,19 @@
+/**
+ * Host stand-in for the FreeRTOS kernel types (the subset FrameUpdate uses).
+ * One tick is one millisecond, as with CONFIG_FREERTOS_HZ=1000.
+ */
+
+#pragma once
+#include <stdint.h>
+
+typedef void *TaskHandle_t;
+typedef int BaseType_t;
+typedef unsigned UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdFALSE            0
+#define pdTRUE             1
+#define pdPASS             pdTRUE
+#define pdFAIL             pdFALSE
+#define portMAX_DELAY      ((TickType_t)0xffffffff)
+#define pdMS_TO_TICKS(ms)  ((TickType_t)(ms))
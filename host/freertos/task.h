@@ -0,0 +1,20 @@
+/**
+ * Host stand-in for the FreeRTOS task API (the subset FrameUpdate uses).
+ * A task is a detached thread; core and priority are ignored, and the
+ * direct-to-task notification is a counting semaphore per thread.
+ */
+
+#pragma once
+#include "freertos/FreeRTOS.h"
+
+typedef void (*TaskFunction_t)(void *);
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t task, const char *name, uint32_t stack_depth,
+                                   void *arg, UBaseType_t priority, TaskHandle_t *handle,
+                                   BaseType_t core);
+// Only vTaskDelete(NULL) at the end of a task: the thread ends on return
+void vTaskDelete(TaskHandle_t task);
+void vTaskDelay(TickType_t ticks);
+TaskHandle_t xTaskGetCurrentTaskHandle(void);
+BaseType_t xTaskNotifyGive(TaskHandle_t task);
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks);
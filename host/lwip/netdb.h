@@ -0,0 +1,6 @@
+/**
+ * Host stand-in for lwIP's resolver header.
+ */
+
+#pragma once
+#include <netdb.h>
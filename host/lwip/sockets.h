@@ -0,0 +1,15 @@
+/**
+ * Host stand-in for lwIP's socket header: the BSD socket API it mirrors.
+ */
+
+#pragma once
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <strings.h>
@@ -0,0 +1,20 @@
+/**
+ * Host stand-in for the mbedTLS message digest API: only the one-shot
+ * HMAC-SHA256 that NET_Wake uses, computed by OpenSSL.
+ */
+
+#pragma once
+#include <stddef.h>
+
+typedef enum {
+  MBEDTLS_MD_SHA256 = 6,
+} mbedtls_md_type_t;
+
+typedef struct mbedtls_md_info_t mbedtls_md_info_t;
+
+// NULL for anything but SHA256
+const mbedtls_md_info_t *mbedtls_md_info_from_type(mbedtls_md_type_t type);
+
+// 0 on success; output takes the full 32-byte MAC
+int mbedtls_md_hmac(const mbedtls_md_info_t *info, const unsigned char *key, size_t keylen,
+                    const unsigned char *input, size_t ilen, unsigned char *output);
@@ -0,0 +1,58 @@
+#include "rom/miniz.h"
+
+// zlib allocates once per stream; the arena is dropped with the decompressor
+static voidpf arena_alloc(voidpf opaque, uInt items, uInt size)
+{
+  tinfl_decompressor *r = (tinfl_decompressor *)opaque;
+  size_t len = ((size_t)items * size + 15) & ~(size_t)15;
+  if (len > TINFL_ARENA_SIZE - r->arena_used) return Z_NULL;
+  voidpf p = r->arena + r->arena_used;
+  r->arena_used += len;
+  return p;
+}
+
+static void arena_free(voidpf opaque, voidpf address)
+{
+  (void)opaque;
+  (void)address;
+}
+
+tinfl_status tinfl_decompress(tinfl_decompressor *r, const mz_uint8 *pIn_buf_next, size_t *pIn_buf_size,
+                              mz_uint8 *pOut_buf_start, mz_uint8 *pOut_buf_next, size_t *pOut_buf_size,
+                              const mz_uint32 decomp_flags)
+{
+  (void)pOut_buf_start;  // zlib keeps its own copy of the window
+  if (r->m_state == 0) {
+    r->arena_used = 0;
+    r->stream.zalloc = arena_alloc;
+    r->stream.zfree = arena_free;
+    r->stream.opaque = r;
+    r->stream.next_in = Z_NULL;
+    r->stream.avail_in = 0;
+    int bits = (decomp_flags & TINFL_FLAG_PARSE_ZLIB_HEADER) ? 15 : -15;
+    if (inflateInit2(&r->stream, bits) != Z_OK) return TINFL_STATUS_BAD_PARAM;
+    r->m_state = 1;
+  }
+  if (r->m_state == 2) {
+    *pIn_buf_size = 0;
+    *pOut_buf_size = 0;
+    return TINFL_STATUS_DONE;
+  }
+
+  r->stream.next_in = (Bytef *)pIn_buf_next;
+  r->stream.avail_in = (uInt)*pIn_buf_size;
+  r->stream.next_out = pOut_buf_next;
+  r->stream.avail_out = (uInt)*pOut_buf_size;
+  int ret = inflate(&r->stream, Z_NO_FLUSH);
+  *pIn_buf_size -= r->stream.avail_in;
+  *pOut_buf_size -= r->stream.avail_out;
+
+  if (ret == Z_STREAM_END) {
+    r->m_state = 2;
+    return TINFL_STATUS_DONE;
+  }
+  if (ret != Z_OK && ret != Z_BUF_ERROR) return TINFL_STATUS_FAILED;
+  if (r->stream.avail_out == 0) return TINFL_STATUS_HAS_MORE_OUTPUT;
+  if (!(decomp_flags & TINFL_FLAG_HAS_MORE_INPUT)) return TINFL_STATUS_FAILED;
+  return TINFL_STATUS_NEEDS_MORE_INPUT;
+}
@@ -0,0 +1,46 @@
+/**
+ * Host stand-in for the tinfl inflater in the ESP32 ROM (miniz.cpp).
+ * Same streaming contract as tinfl_decompress() on a wrapping 32 KB window,
+ * backed by zlib's raw inflate. The zlib state lives in an arena inside the
+ * decompressor, so freeing the struct (as FrameInflate_End does) is enough.
+ */
+
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <zlib.h>
+
+typedef uint8_t  mz_uint8;
+typedef uint32_t mz_uint32;
+
+enum {
+  TINFL_FLAG_PARSE_ZLIB_HEADER = 1,
+  TINFL_FLAG_HAS_MORE_INPUT = 2,
+  TINFL_FLAG_USING_NON_WRAPPING_OUTPUT_BUF = 4,
+  TINFL_FLAG_COMPUTE_ADLER32 = 8,
+};
+
+typedef enum {
+  TINFL_STATUS_BAD_PARAM = -3,
+  TINFL_STATUS_ADLER32_MISMATCH = -2,
+  TINFL_STATUS_FAILED = -1,
+  TINFL_STATUS_DONE = 0,
+  TINFL_STATUS_NEEDS_MORE_INPUT = 1,
+  TINFL_STATUS_HAS_MORE_OUTPUT = 2,
+} tinfl_status;
+
+#define TINFL_LZ_DICT_SIZE 32768
+#define TINFL_ARENA_SIZE   (48 * 1024)  // zlib inflate state plus its own window
+
+typedef struct {
+  mz_uint32 m_state;                    // 0 until the first call sets up zlib
+  z_stream  stream;
+  size_t    arena_used;
+  mz_uint8  arena[TINFL_ARENA_SIZE];
+} tinfl_decompressor;
+
+#define tinfl_init(r) do { (r)->m_state = 0; } while (0)
+
+tinfl_status tinfl_decompress(tinfl_decompressor* r, const mz_uint8* pIn_buf_next, size_t* pIn_buf_size,
+                              mz_uint8* pOut_buf_start, mz_uint8* pOut_buf_next, size_t* pOut_buf_size,
+                              const mz_uint32 decomp_flags);
@@ -0,0 +1,30 @@
+/**
+ * Minimal Host Test Harness
+ *
+ * CHECK records a failure and carries on, so one run reports every broken
+ * expectation; main() returns Test_Result() so ctest sees the outcome.
+ */
+
+#ifndef TEST_H
+#define TEST_H
+
+#include <stdio.h>
+
+static int test_failures = 0;
+
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+      fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond); \
+      test_failures++; \
+    } \
+  } while (0)
+
+#define RUN(call) do { printf("-- %s\n", #call); call; } while (0)
+
+static inline int Test_Result(void)
+{
+  if (test_failures) fprintf(stderr, "%d check(s) failed\n", test_failures);
+  return test_failures ? 1 : 0;
+}
+
+#endif
@@ -0,0 +1,200 @@
+/**
+ * SPI layer against the host bus model: transactions and bytes per frame,
+ * DMA overlap with a slow producer, clock profiles, and the chip select
+ * and clock ordering of a traced init and frame.
+ */
+
+#include "Test.h"
+#include "DEV_Host.h"
+#include "EPD_13in3e.h"
+#include <inttypes.h>
+#include <algorithm>
+
+#define LINE_BYTES   (EPD_13IN3E_WIDTH / 4)
+#define HALF_BYTES   ((UDOUBLE)LINE_BYTES * EPD_13IN3E_HEIGHT)
+#define HALF_BLOCKS  (HALF_BYTES / SPI_DMA_BLOCK_SIZE)
+
+static void startPanel(void)
+{
+  DEV_Host_Reset();
+  DEV_Host_SetBusyTime(30, 20000);
+  CHECK(DEV_Module_Init() == 0);
+}
+
+static UDOUBLE busSum(UDOUBLE DEV_Host_Bus::*field)
+{
+  return DEV_Host_GetBus(0).*field + DEV_Host_GetBus(1).*field;
+}
+
+// Both halves through the line API; work_ms of "receive" every work_lines lines
+static void pushFrame(UDOUBLE work_ms, int work_lines)
+{
+  UBYTE line[LINE_BYTES];
+
+  for (int half = 0; half < 2; half++) {
+    if (half == 0) EPD_13IN3E_BeginFrameM();
+    else EPD_13IN3E_BeginFrameS();
+    for (int y = 0; y < EPD_13IN3E_HEIGHT; y++) {
+      if (work_ms && y % work_lines == 0) DEV_Delay_ms(work_ms);
+      for (int i = 0; i < LINE_BYTES; i++) line[i] = (UBYTE)(y * 5 + i + half) & 0x66;
+      if (half == 0) EPD_13IN3E_WriteLineM(line);
+      else EPD_13IN3E_WriteLineS(line);
+    }
+    EPD_13IN3E_Fence();
+    if (half == 0) EPD_13IN3E_EndFrameM();
+    else EPD_13IN3E_EndFrameS();
+  }
+}
+
+// One DMA block per 8 lines instead of one call per byte
+static void testFrameTransactions(void)
+{
+  startPanel();
+  EPD_13IN3E_Init();
+  DEV_SPI_ResetStats();
+  pushFrame(0, 0);
+
+  DEV_SPI_Stats stats = DEV_SPI_GetStats();
+  UDOUBLE blocks = busSum(&DEV_Host_Bus::blocks);
+  printf("   frame: %" PRIu32 " transactions (%" PRIu32 " DMA blocks), %" PRIu32 " bytes\n",
+         stats.transactions, blocks, stats.bytes);
+  CHECK(blocks == 2 * HALF_BLOCKS);
+  CHECK(stats.transactions >= blocks && stats.transactions - blocks <= 8);  // Commands around each half
+  CHECK(stats.bytes >= 2 * HALF_BYTES && stats.bytes - 2 * HALF_BYTES <= 8);
+  EPD_13IN3E_PowerOff();
+}
+
+// A producer slower than nothing but faster than the wire: with the
+// ping-pong blocks the frame takes about as long as the wire alone
+static void testDmaOverlap(void)
+{
+  startPanel();
+  EPD_13IN3E_Init();
+  CHECK(DEV_SPI_SetClockProfile(SPI_CMD_SPEED_HZ, SPI_BULK_SPEED_HZ));
+  DEV_SPI_ResetStats();
+
+  UDOUBLE start = DEV_Time_us();
+  pushFrame(1, SPI_DMA_BLOCK_SIZE / LINE_BYTES);
+  UDOUBLE elapsed = DEV_Time_us() - start;
+
+  UDOUBLE work = 2 * EPD_13IN3E_HEIGHT / (SPI_DMA_BLOCK_SIZE / LINE_BYTES) * 1000;
+  UDOUBLE wire = busSum(&DEV_Host_Bus::wire_us);
+  UDOUBLE wait = busSum(&DEV_Host_Bus::wait_us);
+  printf("   overlap: %" PRIu32 " us work + %" PRIu32 " us wire in %" PRIu32 " us (%" PRIu32 " us waiting)\n",
+         work, wire, elapsed, wait);
+  CHECK(elapsed < (work + wire) * 3 / 4);
+  CHECK(elapsed >= wire);
+  CHECK(wait < wire);
+  EPD_13IN3E_PowerOff();
+}
+
+// Clamped to the supported range and applied to the bulk wire time
+static void testClockProfile(void)
+{
+  UDOUBLE cmd_hz, bulk_hz;
+
+  startPanel();
+  EPD_13IN3E_Init();
+  CHECK(DEV_SPI_SetClockProfile(4000000, 20000000));
+  DEV_Host_GetClocks(&cmd_hz, &bulk_hz);
+  CHECK(cmd_hz == 4000000 && bulk_hz == 20000000);
+
+  CHECK(DEV_SPI_SetClockProfile(100000, 80000000));
+  DEV_Host_GetClocks(&cmd_hz, &bulk_hz);
+  CHECK(cmd_hz == SPI_MIN_SPEED_HZ && bulk_hz == SPI_MAX_SPEED_HZ);
+
+  UDOUBLE wire[2];
+  const UDOUBLE rates[2] = {10000000, 20000000};
+  for (int i = 0; i < 2; i++) {
+    CHECK(DEV_SPI_SetClockProfile(SPI_CMD_SPEED_HZ, rates[i]));
+    DEV_SPI_ResetStats();
+    pushFrame(0, 0);
+    wire[i] = busSum(&DEV_Host_Bus::wire_us);
+  }
+  printf("   frame on the wire: %" PRIu32 " us at 10 MHz, %" PRIu32 " us at 20 MHz\n", wire[0], wire[1]);
+  CHECK(wire[1] < wire[0] * 11 / 20);
+  EPD_13IN3E_PowerOff();
+}
+
+// Replays the trace on the clocks it records: a chip select may only rise,
+// and a clock only change, once every byte before it is off the wire;
+// commands go out under a chip select, pixel blocks only after DTM
+static void testTraceOrdering(void)
+{
+  DEV_TraceHeader header;
+
+  startPanel();
+  DEV_Trace_Begin();
+  CHECK(DEV_SPI_SetClockProfile(2000000, 20000000));
+  EPD_13IN3E_Init();
+  EPD_13IN3E_BeginFrameM();
+  UBYTE line[LINE_BYTES];
+  memset(line, 0x11, sizeof(line));
+  for (int y = 0; y < EPD_13IN3E_HEIGHT; y++) EPD_13IN3E_WriteLineM(line);
+  EPD_13IN3E_Fence();
+  EPD_13IN3E_EndFrameM();
+  CHECK(DEV_SPI_SetClockProfile(SPI_CMD_SPEED_HZ, SPI_BULK_SPEED_HZ));
+  DEV_Trace_End();
+  const DEV_TraceEvent *events = DEV_Trace_Get(&header);
+  CHECK(header.dropped == 0);
+
+  UDOUBLE khz[2] = {0, 0};
+  uint64_t bus_end[2] = {0, 0};
+  uint64_t last_end = 0;
+  bool cs_low[2] = {false, false};
+  int clocks = 0, blocks = 0;
+  UBYTE last_cmd = 0;
+  bool in_order = true;
+
+  for (UWORD i = 0; i < header.count; i++) {
+    const DEV_TraceEvent *e = &events[i];
+    switch (e->type) {
+      case DEV_TRACE_CLOCK:
+        if (e->t_us < last_end) in_order = false;
+        khz[e->value & 1] = e->len;
+        clocks++;
+        break;
+      case DEV_TRACE_GPIO: {
+        UBYTE pin = e->value & 0x7F;
+        if (pin != EPD_CS_M_PIN && pin != EPD_CS_S_PIN) break;
+        bool low = !(e->value & 0x80);
+        if (!low && e->t_us < last_end) in_order = false;
+        cs_low[pin == EPD_CS_S_PIN] = low;
+        break;
+      }
+      case DEV_TRACE_CMD:
+        if (!cs_low[0] && !cs_low[1]) in_order = false;
+        last_cmd = e->value;
+        break;
+      case DEV_TRACE_DATA: {
+        bool bulk = (e->value & DEV_TRACE_BULK) != 0;
+        int b = e->value & 1;
+        if (!cs_low[0] && !cs_low[1]) in_order = false;
+        if (bulk && last_cmd != DTM) in_order = false;
+        if (bulk) blocks++;
+        UDOUBLE rate = khz[bulk ? 1 : 0];
+        CHECK(rate > 0);
+        if (rate == 0) return;
+        uint64_t start = bulk ? std::max((uint64_t)e->t_us, bus_end[b]) : e->t_us;
+        bus_end[b] = start + ((uint64_t)e->len * 8 * 1000 + rate - 1) / rate;
+        last_end = std::max(last_end, bus_end[b]);
+        break;
+      }
+    }
+  }
+  CHECK(in_order);
+  CHECK(clocks == 4);
+  CHECK(khz[0] == SPI_CMD_SPEED_HZ / 1000 && khz[1] == SPI_BULK_SPEED_HZ / 1000);
+  CHECK(blocks == (int)HALF_BLOCKS);
+  CHECK(!cs_low[0] && !cs_low[1]);
+  EPD_13IN3E_PowerOff();
+}
+
+int main(void)
+{
+  RUN(testFrameTransactions());
+  RUN(testDmaOverlap());
+  RUN(testClockProfile());
+  RUN(testTraceOrdering());
+  return Test_Result();
+}
@@ -0,0 +1,163 @@
+/**
+ * Bus trace on the host: golden traces of the panel operations (payload
+ * CRC and event sequence), and the bus index and clock flag of every data
+ * event.
+ */
+
+#include "Test.h"
+#include "DEV_Host.h"
+#include "EPD_13in3e.h"
+#include "esp_rom_crc.h"
+#include <inttypes.h>
+
+#define LINE_BYTES  (EPD_13IN3E_WIDTH / 4)
+
+// Known-good traces; a change here means the bytes or their framing on the
+// bus changed. Timestamps are left out, the host clock is partly real time.
+struct Golden {
+  const char *name;
+  UWORD events;
+  UDOUBLE data_crc;
+  UDOUBLE shape_crc;
+};
+
+#ifdef EPD_DUAL_BUS
+static const Golden GOLDEN_INIT  = {"init",  101, 0xb58ed134, 0x2438cdea};
+static const Golden GOLDEN_CLEAR = {"clear", 427, 0x5331cd6b, 0x52f6f8f6};
+static const Golden GOLDEN_FRAME = {"frame", 407, 0xfa3eef73, 0x6903afad};
+#else
+static const Golden GOLDEN_INIT  = {"init",  93, 0x3e3720f2, 0x5b2c2638};
+static const Golden GOLDEN_CLEAR = {"clear", 425, 0xef745297, 0x671511dc};
+static const Golden GOLDEN_FRAME = {"frame", 410, 0x40860543, 0xf696a6d3};
+#endif
+
+static void startPanel(void)
+{
+  DEV_Host_Reset();
+  DEV_Host_SetBusyTime(30, 20000);
+  CHECK(DEV_Module_Init() == 0);
+}
+
+// CRC over type, value and length of every event, in order
+static UDOUBLE shapeCrc(const DEV_TraceEvent *events, UWORD count)
+{
+  UDOUBLE crc = 0;
+  for (UWORD i = 0; i < count; i++) {
+    UBYTE shape[4] = {events[i].type, events[i].value, (UBYTE)events[i].len, (UBYTE)(events[i].len >> 8)};
+    crc = esp_rom_crc32_le(crc, shape, sizeof(shape));
+  }
+  return crc;
+}
+
+static const DEV_TraceEvent *checkGolden(const Golden &golden, DEV_TraceHeader *header)
+{
+  DEV_Trace_End();
+  const DEV_TraceEvent *events = DEV_Trace_Get(header);
+  UDOUBLE shape = shapeCrc(events, header->count);
+  printf("   %s: %u events, data crc %08" PRIx32 ", shape crc %08" PRIx32 "\n",
+         golden.name, header->count, header->data_crc, shape);
+  CHECK(memcmp(header->magic, DEV_TRACE_MAGIC, 4) == 0);
+  CHECK(header->version == DEV_TRACE_VERSION);
+  CHECK(header->dropped == 0);
+  CHECK(header->count == golden.events);
+  CHECK(header->data_crc == golden.data_crc);
+  CHECK(shape == golden.shape_crc);
+  return events;
+}
+
+// Register payloads: one event per bus that carries them, on the command clock
+static void testInit(void)
+{
+  DEV_TraceHeader header;
+  startPanel();
+  DEV_Trace_Begin();
+  EPD_13IN3E_Init();
+  const DEV_TraceEvent *events = checkGolden(GOLDEN_INIT, &header);
+
+  int data_m = 0, data_s = 0;
+  for (UWORD i = 0; i < header.count; i++) {
+    if (events[i].type != DEV_TRACE_DATA) continue;
+    CHECK(!(events[i].value & DEV_TRACE_BULK));
+    if (events[i].value == 0) data_m++;
+    if (events[i].value == 1) data_s++;
+  }
+  CHECK(data_m == 16);
+#ifdef EPD_DUAL_BUS
+  CHECK(data_s == 8);  // Shared registers go out on both hosts
+#else
+  CHECK(data_s == 0);  // One bus, CS picks the controllers
+#endif
+  EPD_13IN3E_PowerOff();
+}
+
+static void testClear(void)
+{
+  DEV_TraceHeader header;
+  startPanel();
+  EPD_13IN3E_Init();
+  DEV_Trace_Begin();
+  EPD_13IN3E_Clear(EPD_13IN3E_WHITE);
+  checkGolden(GOLDEN_CLEAR, &header);
+  EPD_13IN3E_PowerOff();
+}
+
+// Streamed frame: every pixel byte in a bulk-clock block, each half on the
+// bus of its controller
+static void testFrame(void)
+{
+  UBYTE line[2 * LINE_BYTES];
+  DEV_TraceHeader header;
+
+  startPanel();
+  EPD_13IN3E_Init();
+  DEV_Trace_Begin();
+#ifdef EPD_DUAL_BUS
+  EPD_13IN3E_BeginFrameDual();
+  for (int y = 0; y < EPD_13IN3E_HEIGHT; y++) {
+    for (int i = 0; i < 2 * LINE_BYTES; i++) line[i] = (UBYTE)(y * 7 + i) & 0x66;
+    EPD_13IN3E_WriteRow(line);
+  }
+  EPD_13IN3E_Fence();
+  EPD_13IN3E_EndFrameDual();
+#else
+  EPD_13IN3E_BeginFrameM();
+  for (int y = 0; y < EPD_13IN3E_HEIGHT; y++) {
+    for (int i = 0; i < LINE_BYTES; i++) line[i] = (UBYTE)(y * 7 + i) & 0x66;
+    EPD_13IN3E_WriteLineM(line);
+  }
+  EPD_13IN3E_Fence();
+  EPD_13IN3E_EndFrameM();
+  EPD_13IN3E_BeginFrameS();
+  for (int y = 0; y < EPD_13IN3E_HEIGHT; y++) {
+    for (int i = 0; i < LINE_BYTES; i++) line[i] = (UBYTE)(y * 7 + i + LINE_BYTES) & 0x66;
+    EPD_13IN3E_WriteLineS(line);
+  }
+  EPD_13IN3E_Fence();
+  EPD_13IN3E_EndFrameS();
+#endif
+  const DEV_TraceEvent *events = checkGolden(GOLDEN_FRAME, &header);
+
+  UDOUBLE bulk[2] = {0, 0};
+  for (UWORD i = 0; i < header.count; i++) {
+    if (events[i].type == DEV_TRACE_DATA && (events[i].value & DEV_TRACE_BULK)) {
+      CHECK(events[i].len <= SPI_DMA_BLOCK_SIZE);
+      bulk[events[i].value & 1] += events[i].len;
+    }
+  }
+#ifdef EPD_DUAL_BUS
+  CHECK(bulk[0] == (UDOUBLE)LINE_BYTES * EPD_13IN3E_HEIGHT);
+  CHECK(bulk[1] == (UDOUBLE)LINE_BYTES * EPD_13IN3E_HEIGHT);
+#else
+  CHECK(bulk[0] == (UDOUBLE)2 * LINE_BYTES * EPD_13IN3E_HEIGHT);
+  CHECK(bulk[1] == 0);
+#endif
+  EPD_13IN3E_PowerOff();
+}
+
+int main(void)
+{
+  RUN(testInit());
+  RUN(testClear());
+  RUN(testFrame());
+  return Test_Result();
+}
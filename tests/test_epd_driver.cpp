@@ -0,0 +1,117 @@
+/**
+ * EPD driver against the host panel model: init table routing, frame
+ * payloads per controller, refresh timing and watchdog feeding.
+ */
+
+#include "Test.h"
+#include "DEV_Host.h"
+#include "EPD_13in3e.h"
+#include "esp_rom_crc.h"
+
+#define LINE_BYTES  (EPD_13IN3E_WIDTH / 4)
+
+static const DEV_Host_Controller *master(void) { return DEV_Host_GetController(0); }
+static const DEV_Host_Controller *slave(void) { return DEV_Host_GetController(1); }
+
+static void startPanel(void)
+{
+  DEV_Host_Reset();
+  DEV_Host_SetBusyTime(30, 20000);
+  CHECK(DEV_Module_Init() == 0);
+}
+
+// Shared registers reach both controllers, the analog block only the master
+static void testInitSequence(void)
+{
+  static const UBYTE tres[4] = {0x04, 0xB0, 0x06, 0x40};
+
+  startPanel();
+  EPD_13IN3E_Init();
+  CHECK(master()->commands == 16);
+  CHECK(slave()->commands == 8);
+  CHECK(master()->reg_len[TRES] == 4 && memcmp(master()->reg[TRES], tres, 4) == 0);
+  CHECK(slave()->reg_len[TRES] == 4 && memcmp(slave()->reg[TRES], tres, 4) == 0);
+  CHECK(master()->reg_len[AN_TM] == 9);
+  CHECK(slave()->reg_len[AN_TM] == 0);
+  CHECK(master()->reg_len[PWR_epd] == 6 && slave()->reg_len[PWR_epd] == 0);
+
+  // Registers are kept until sleep: a second Init sends nothing
+  EPD_13IN3E_Init();
+  CHECK(master()->commands == 16);
+  EPD_13IN3E_PowerOff();
+}
+
+// Each half lands on its own controller, byte for byte
+static void testFrameStream(void)
+{
+  UBYTE line[LINE_BYTES];
+  UDOUBLE crc_m = 0, crc_s = 0;
+
+  startPanel();
+  EPD_13IN3E_Init();
+  EPD_13IN3E_BeginFrameM();
+  for (int y = 0; y < EPD_13IN3E_HEIGHT; y++) {
+    for (int i = 0; i < LINE_BYTES; i++) line[i] = (UBYTE)(y * 7 + i) & 0x66;
+    crc_m = esp_rom_crc32_le(crc_m, line, LINE_BYTES);
+    EPD_13IN3E_WriteLineM(line);
+  }
+  EPD_13IN3E_Fence();
+  EPD_13IN3E_EndFrameM();
+
+  EPD_13IN3E_BeginFrameS();
+  for (int y = 0; y < EPD_13IN3E_HEIGHT; y++) {
+    for (int i = 0; i < LINE_BYTES; i++) line[i] = (UBYTE)(y + i * 3) & 0x55;
+    crc_s = esp_rom_crc32_le(crc_s, line, LINE_BYTES);
+    EPD_13IN3E_WriteLineS(line);
+  }
+  EPD_13IN3E_EndFrameS();
+
+  CHECK(master()->dtm_bytes == (UDOUBLE)LINE_BYTES * EPD_13IN3E_HEIGHT);
+  CHECK(slave()->dtm_bytes == (UDOUBLE)LINE_BYTES * EPD_13IN3E_HEIGHT);
+  CHECK(master()->dtm_crc == crc_m);
+  CHECK(slave()->dtm_crc == crc_s);
+  EPD_13IN3E_PowerOff();
+}
+
+// The refresh holds BUSY for 20 s; the wait must keep the watchdog fed
+static void testRefreshTiming(void)
+{
+  startPanel();
+  EPD_13IN3E_Init();
+
+  UDOUBLE start = DEV_Time_ms();
+  EPD_13IN3E_RefreshStart();
+  CHECK(EPD_13IN3E_Busy());
+  CHECK(master()->refreshes == 1 && slave()->refreshes == 1);
+  CHECK(master()->power_offs == 0);
+  EPD_13IN3E_RefreshWait();
+  CHECK(!EPD_13IN3E_Busy());
+  CHECK(DEV_Time_ms() - start >= 20000);
+  CHECK(master()->power_offs == 1 && slave()->power_offs == 1);
+
+  DEV_Host_Watchdog wdt = DEV_Host_GetWatchdog();
+  CHECK(wdt.feeds >= 2000);
+  CHECK(wdt.max_gap_ms < 1000);
+  EPD_13IN3E_PowerOff();
+}
+
+static void testTextScreen(void)
+{
+  static const char *const texts[6] = {"BLACK", "WHITE", "YELLOW", "RED", "BLUE", "GREEN"};
+
+  startPanel();
+  EPD_13IN3E_DisplayTextScreen(texts);
+  CHECK(master()->dtm_bytes == (UDOUBLE)LINE_BYTES * EPD_13IN3E_HEIGHT);
+  CHECK(slave()->dtm_bytes == (UDOUBLE)LINE_BYTES * EPD_13IN3E_HEIGHT);
+  CHECK(master()->refreshes == 1 && master()->power_offs == 1);
+  EPD_13IN3E_PowerOff();
+}
+
+int main(void)
+{
+  RUN(testInitSequence());
+  RUN(testFrameStream());
+  RUN(testRefreshTiming());
+  RUN(testTextScreen());
+  return Test_Result();
+}
@@ -0,0 +1,101 @@
+/**
+ * Dual-bus streaming (EPD_DUAL_BUS builds only): a row-major frame split
+ * across both SPI hosts, through WriteRow and the zero-copy
+ * AcquireRow/SubmitRow, with both halves on the wire at once.
+ */
+
+#include "Test.h"
+#include "DEV_Host.h"
+#include "EPD_13in3e.h"
+#include "esp_rom_crc.h"
+#include <inttypes.h>
+
+#define LINE_BYTES  (EPD_13IN3E_WIDTH / 4)
+#define HALF_BYTES  ((UDOUBLE)LINE_BYTES * EPD_13IN3E_HEIGHT)
+
+static const DEV_Host_Controller *master(void) { return DEV_Host_GetController(0); }
+static const DEV_Host_Controller *slave(void) { return DEV_Host_GetController(1); }
+
+static void startPanel(void)
+{
+  DEV_Host_Reset();
+  DEV_Host_SetBusyTime(30, 20000);
+  CHECK(DEV_Module_Init() == 0);
+}
+
+static void makeRow(UBYTE *row, int y)
+{
+  for (int i = 0; i < 2 * LINE_BYTES; i++) row[i] = (UBYTE)(y * 13 + i * 3) & 0x66;
+}
+
+// Each controller gets exactly its half of every row, in row order; odd
+// rows go through the zero-copy path
+static void testRowMajorFrame(void)
+{
+  UBYTE row[2 * LINE_BYTES];
+  UDOUBLE crc_m = 0, crc_s = 0;
+
+  startPanel();
+  EPD_13IN3E_Init();
+  DEV_SPI_ResetStats();
+  UDOUBLE start = DEV_Time_us();
+  EPD_13IN3E_BeginFrameDual();
+  for (int y = 0; y < EPD_13IN3E_HEIGHT; y++) {
+    makeRow(row, y);
+    crc_m = esp_rom_crc32_le(crc_m, row, LINE_BYTES);
+    crc_s = esp_rom_crc32_le(crc_s, row + LINE_BYTES, LINE_BYTES);
+    if (y % 2 == 0) {
+      EPD_13IN3E_WriteRow(row);
+    } else {
+      UBYTE *left, *right;
+      EPD_13IN3E_AcquireRow(&left, &right);
+      memcpy(left, row, LINE_BYTES);
+      memcpy(right, row + LINE_BYTES, LINE_BYTES);
+      EPD_13IN3E_SubmitRow();
+    }
+  }
+  EPD_13IN3E_Fence();
+  EPD_13IN3E_EndFrameDual();
+  UDOUBLE elapsed = DEV_Time_us() - start;
+
+  CHECK(master()->dtm_bytes == HALF_BYTES);
+  CHECK(slave()->dtm_bytes == HALF_BYTES);
+  CHECK(master()->dtm_crc == crc_m);
+  CHECK(slave()->dtm_crc == crc_s);
+
+  // The slave half on HSPI, in blocks of its own, alongside the master's
+  DEV_Host_Bus m = DEV_Host_GetBus(0), s = DEV_Host_GetBus(1);
+  CHECK(m.blocks == HALF_BYTES / SPI_DMA_BLOCK_SIZE);
+  CHECK(s.blocks == HALF_BYTES / SPI_DMA_BLOCK_SIZE);
+  printf("   dual frame: %" PRIu32 " + %" PRIu32 " us on the wires in %" PRIu32 " us\n",
+         m.wire_us, s.wire_us, elapsed);
+  CHECK(elapsed < (m.wire_us + s.wire_us) * 3 / 4);
+  EPD_13IN3E_PowerOff();
+}
+
+// The one-bus-at-a-time API still lands each half on its own controller
+static void testHalfFrames(void)
+{
+  UBYTE row[2 * LINE_BYTES];
+
+  startPanel();
+  EPD_13IN3E_Init();
+  EPD_13IN3E_BeginFrameS();
+  for (int y = 0; y < EPD_13IN3E_HEIGHT; y++) {
+    makeRow(row, y);
+    EPD_13IN3E_WriteLineS(row);
+  }
+  EPD_13IN3E_Fence();
+  EPD_13IN3E_EndFrameS();
+  CHECK(master()->dtm_bytes == 0);
+  CHECK(slave()->dtm_bytes == HALF_BYTES);
+  CHECK(DEV_Host_GetBus(0).blocks == 0);
+  EPD_13IN3E_PowerOff();
+}
+
+int main(void)
+{
+  RUN(testRowMajorFrame());
+  RUN(testHalfFrames());
+  return Test_Result();
+}
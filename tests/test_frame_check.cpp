@@ -0,0 +1,121 @@
+/**
+ * FrameCheck: CRC32 and MD5 verification, malformed and opaque digests,
+ * and the per-byte cost of each mode.
+ */
+
+#include "Test.h"
+#include "FrameCheck.h"
+#include "esp_rom_crc.h"
+#include <chrono>
+#include <ctype.h>
+
+#define FRAME_BYTES  (300 * 1600)
+
+static UBYTE frame[FRAME_BYTES];
+
+// Fed in uneven chunks, as the socket hands them over
+static bool feed(FrameCheck *fc, const UBYTE *data, UDOUBLE len)
+{
+  UDOUBLE chunk = 1;
+  for (UDOUBLE at = 0; at < len; at += chunk) {
+    chunk = 1 + (at * 13) % 1460;
+    if (chunk > len - at) chunk = len - at;
+    FrameCheck_Update(fc, data + at, chunk);
+  }
+  return FrameCheck_Verify(fc);
+}
+
+static void testCrc(void)
+{
+  char hex[12];
+  uint32_t crc = esp_rom_crc32_le(0, frame, FRAME_BYTES);
+  FrameCheck fc;
+
+  snprintf(hex, sizeof(hex), "%08X", (unsigned)crc);
+  CHECK(FrameCheck_Begin(&fc, "ignored", hex));
+  CHECK(fc.mode == FRAME_CHECK_CRC32);
+  CHECK(feed(&fc, frame, FRAME_BYTES));
+  CHECK(fc.bytes == FRAME_BYTES);
+
+  snprintf(hex, sizeof(hex), "%08x", (unsigned)(crc ^ 1));
+  CHECK(FrameCheck_Begin(&fc, NULL, hex));
+  CHECK(!feed(&fc, frame, FRAME_BYTES));
+
+  // Leading zeros may be dropped by the server
+  CHECK(FrameCheck_Begin(&fc, NULL, "0"));
+  CHECK(FrameCheck_Verify(&fc));
+}
+
+static void testMalformedCrc(void)
+{
+  static const char *bad[] = {"123456789", "xyz", "12 34", "0x1234"};
+  FrameCheck fc;
+  for (const char *crc : bad) CHECK(!FrameCheck_Begin(&fc, "d41d8cd98f00b204e9800998ecf8427e", crc));
+}
+
+// RFC 1321 vectors, full and truncated as the server advertises them
+static void testMd5(void)
+{
+  static const struct { const char *text, *md5; } vectors[] = {
+    {"", "d41d8cd98f00b204e9800998ecf8427e"},
+    {"abc", "900150983cd24fb0d6963f7d28e17f72"},
+    {"message digest", "f96b697d7cb7938d525a2f31aaf161d0"},
+    {"12345678901234567890123456789012345678901234567890123456789012345678901234567890",
+     "57edf4a22be3c955ac49da2e2107b67a"},
+  };
+  FrameCheck fc;
+  for (const auto &v : vectors) {
+    CHECK(FrameCheck_Begin(&fc, v.md5, NULL));
+    CHECK(fc.mode == FRAME_CHECK_MD5);
+    CHECK(feed(&fc, (const UBYTE *)v.text, strlen(v.text)));
+
+    char prefix[13];
+    snprintf(prefix, sizeof(prefix), "%.12s", v.md5);
+    prefix[0] = toupper((unsigned char)prefix[0]);
+    CHECK(FrameCheck_Begin(&fc, prefix, ""));
+    CHECK(feed(&fc, (const UBYTE *)v.text, strlen(v.text)));
+  }
+
+  CHECK(FrameCheck_Begin(&fc, "d41d8cd98f01", NULL));
+  CHECK(!FrameCheck_Verify(&fc));
+}
+
+// An ETag or a short hash leaves the frame unverified, not rejected
+static void testUnverified(void)
+{
+  static const char *opaque[] = {"W/\"5f3a-17c\"", "abc123", "d41d8cd98f00b204e9800998ecf8427e00"};
+  FrameCheck fc;
+  for (const char *hash : opaque) {
+    CHECK(FrameCheck_Begin(&fc, hash, NULL));
+    CHECK(fc.mode == FRAME_CHECK_NONE);
+    CHECK(feed(&fc, frame, 1000));
+    CHECK(fc.bytes == 0);
+  }
+  CHECK(FrameCheck_Begin(&fc, NULL, NULL));
+  CHECK(fc.mode == FRAME_CHECK_NONE);
+}
+
+// Host numbers only show the ratio between the modes
+static void testCost(void)
+{
+  FrameCheck fc;
+  for (int mode = 0; mode < 2; mode++) {
+    FrameCheck_Begin(&fc, mode ? "d41d8cd98f00" : NULL, mode ? NULL : "0");
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    FrameCheck_Update(&fc, frame, FRAME_BYTES);
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    printf("   %-5s %.2f ns/byte\n", FrameCheck_ModeName(&fc), ns / FRAME_BYTES);
+  }
+}
+
+int main(void)
+{
+  for (int i = 0; i < FRAME_BYTES; i++) frame[i] = (UBYTE)(i * 31 + (i >> 8));
+
+  RUN(testCrc());
+  RUN(testMalformedCrc());
+  RUN(testMd5());
+  RUN(testUnverified());
+  RUN(testCost());
+  return Test_Result();
+}
@@ -0,0 +1,187 @@
+/**
+ * FrameCodec: round trips fed in uneven chunks, the per-row bound against
+ * its worst case and random rows, and malformed streams.
+ */
+
+#include "Test.h"
+#include "FrameCodec.h"
+#include <string.h>
+#include <vector>
+
+#define ROWS  200
+
+static uint32_t rng = 1;
+
+static uint32_t nextRandom(void)
+{
+  rng = rng * 1103515245u + 12345u;
+  return rng >> 8;
+}
+
+// Encode rows back to back, checking every row against the bound
+static std::vector<uint8_t> encode(const std::vector<uint8_t> &frame, uint16_t width, size_t *worst)
+{
+  static uint8_t out[FRAME_CODEC_ROW_BOUND(FRAME_CODEC_MAX_WIDTH)];
+  static FrameCodec_Encoder e;
+  std::vector<uint8_t> coded;
+  const size_t bound = FRAME_CODEC_ROW_BOUND(width);
+  FrameCodec_EncoderInit(&e, width);
+  for (size_t at = 0; at < frame.size(); at += width) {
+    size_t n = FrameCodec_EncodeRow(&e, frame.data() + at, out);
+    CHECK(n <= bound);
+    if (worst && n > *worst) *worst = n;
+    coded.insert(coded.end(), out, out + n);
+  }
+  size_t n = FrameCodec_EncodeFinish(&e, out);
+  coded.insert(coded.end(), out, out + n);
+  return coded;
+}
+
+// Decode in chunks of 1..max_chunk bytes; true when every row matches
+static bool decode(const std::vector<uint8_t> &coded, const std::vector<uint8_t> &frame,
+                   uint16_t width, size_t max_chunk)
+{
+  static FrameCodec_Decoder d;
+  static uint8_t row[FRAME_CODEC_MAX_WIDTH];
+  FrameCodec_DecoderInit(&d, width);
+  size_t at = 0, rows = 0, total = frame.size() / width;
+
+  while (rows < total) {
+    size_t chunk = 1 + nextRandom() % max_chunk;
+    if (chunk > coded.size() - at) chunk = coded.size() - at;
+    bool row_done;
+    at += FrameCodec_Decode(&d, coded.data() + at, chunk, row, &row_done);
+    if (d.error) return false;
+    if (row_done) {
+      if (memcmp(row, frame.data() + rows * width, width) != 0) return false;
+      rows++;
+    } else if (at == coded.size()) {
+      return false;
+    }
+  }
+  return at == coded.size() && !FrameCodec_Pending(&d) && d.rows == total;
+}
+
+// Flat bands, noise, runs of identical rows and small edits of the row above
+static std::vector<uint8_t> makeFrame(uint16_t width)
+{
+  std::vector<uint8_t> frame(width * ROWS);
+  for (int r = 0; r < ROWS; r++) {
+    uint8_t *row = frame.data() + r * width;
+    const uint8_t *prev = r ? row - width : NULL;
+    switch ((r / 10) % 5) {
+    case 0:
+      memset(row, 0x11 * (r % 7), width);
+      break;
+    case 1:
+      for (int i = 0; i < width; i++) row[i] = nextRandom();
+      break;
+    case 2:
+      memcpy(row, prev, width);
+      break;
+    case 3:
+      memcpy(row, prev, width);
+      for (int i = 0; i < 20; i++) row[nextRandom() % width] = nextRandom();
+      break;
+    default:
+      for (int i = 0; i < width; i++) row[i] = (nextRandom() % 3) * 0x11;
+      break;
+    }
+  }
+  return frame;
+}
+
+static void testRoundTrip(uint16_t width)
+{
+  std::vector<uint8_t> frame = makeFrame(width);
+  std::vector<uint8_t> coded = encode(frame, width, NULL);
+  CHECK(coded.size() < frame.size());
+  CHECK(decode(coded, frame, width, 1));
+  CHECK(decode(coded, frame, width, 7));
+  CHECK(decode(coded, frame, width, 4096));
+
+  // More identical rows than one REPEAT op holds
+  std::vector<uint8_t> flat(width * ROWS, 0x33);
+  coded = encode(flat, width, NULL);
+  CHECK(coded.size() < 16);
+  CHECK(decode(coded, flat, width, 3));
+}
+
+// 64 literal bytes then 2 copied from the row above, repeated, after a
+// pending REPEAT: the costliest row the encoder can produce
+static void testWorstCase(uint16_t width)
+{
+  std::vector<uint8_t> frame(width * 3);
+  uint8_t *prev = frame.data();
+  for (int i = 0; i < width; i++) prev[i] = (uint8_t)(i * 5 + 1);
+  memcpy(prev + width, prev, width);
+  uint8_t *row = prev + 2 * width;
+  for (int i = 0; i < width; i++) {
+    bool copied = i % 66 >= 64 && i < width / 66 * 66;
+    row[i] = copied ? prev[i] : (uint8_t)(i * 5 + 2);
+  }
+
+  const size_t bound = FRAME_CODEC_ROW_BOUND(width);
+  size_t worst = 0;
+  std::vector<uint8_t> coded = encode(frame, width, &worst);
+  printf("   width %u: worst row %zu bytes, bound %zu\n", width, worst, bound);
+  CHECK(worst == bound);
+  CHECK(decode(coded, frame, width, 5));
+}
+
+// Rows built to tempt the encoder: short runs, short matches with the row
+// above and literals of every length around the 64-byte split
+static void testBoundRandom(uint16_t width)
+{
+  size_t worst = 0;
+  for (int round = 0; round < 40; round++) {
+    std::vector<uint8_t> frame(width * ROWS);
+    for (int r = 0; r < ROWS; r++) {
+      uint8_t *row = frame.data() + r * width;
+      for (int i = 0; i < width; i++) {
+        uint32_t pick = nextRandom() % 16;
+        if (r > 0 && pick < 3) row[i] = row[i - width];
+        else if (i > 0 && pick < 5) row[i] = row[i - 1];
+        else row[i] = nextRandom();
+      }
+      if (r > 0 && nextRandom() % 8 == 0) memcpy(row, row - width, width);
+    }
+    std::vector<uint8_t> coded = encode(frame, width, &worst);
+    CHECK(decode(coded, frame, width, 64));
+  }
+  CHECK(worst <= (size_t)FRAME_CODEC_ROW_BOUND(width));
+}
+
+static void testMalformed(void)
+{
+  FrameCodec_Decoder d;
+  uint8_t row[FRAME_CODEC_MAX_WIDTH];
+  bool row_done;
+
+  // REPEAT in the middle of a row
+  static const uint8_t mid_repeat[] = {FRAME_CODEC_COPY | 10, FRAME_CODEC_REPEAT | 1};
+  FrameCodec_DecoderInit(&d, 300);
+  FrameCodec_Decode(&d, mid_repeat, sizeof(mid_repeat), row, &row_done);
+  CHECK(d.error && !row_done);
+
+  // Run past the end of the row
+  static const uint8_t overrun[] = {FRAME_CODEC_FILL, 255, 0x11, FRAME_CODEC_FILL | 1, 0x22};
+  FrameCodec_DecoderInit(&d, 300);
+  FrameCodec_Decode(&d, overrun, sizeof(overrun), row, &row_done);
+  CHECK(d.error);
+
+  FrameCodec_DecoderInit(&d, FRAME_CODEC_MAX_WIDTH + 1);
+  CHECK(d.error);
+}
+
+int main(void)
+{
+  static const uint16_t widths[] = {300, 600};
+  for (uint16_t width : widths) {
+    RUN(testRoundTrip(width));
+    RUN(testWorstCase(width));
+    RUN(testBoundRandom(width));
+  }
+  RUN(testMalformed());
+  return Test_Result();
+}
@@ -0,0 +1,225 @@
+/**
+ * FrameInflate: gzip (with every optional header field), zlib and raw
+ * deflate bodies fed in split reads, header bytes in the input count,
+ * truncated and malformed streams, and the inflate throughput.
+ */
+
+#include "Test.h"
+#include "FrameInflate.h"
+#include <zlib.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+
+#define FRAME_BYTES 960000
+#define SMALL_BYTES 48000   // For the byte-at-a-time runs
+#define READ_BYTES  1460    // One TCP segment, as the sketch reads
+
+static uint32_t rng = 1;
+
+static uint32_t nextRandom(void)
+{
+  rng = rng * 1103515245u + 12345u;
+  return rng >> 16;
+}
+
+// Colour bands with dithered stretches: compresses the way real frames do
+static std::vector<uint8_t> makeFrame(size_t len)
+{
+  std::vector<uint8_t> frame(len);
+  for (size_t i = 0; i < len; i++) {
+    uint8_t band = (uint8_t)(i / 7000 % 6);
+    frame[i] = (i / 300) % 5 == 0 ? (uint8_t)(nextRandom() % 7 * 0x11) : (uint8_t)(band * 0x11);
+  }
+  return frame;
+}
+
+// zlib's deflate with the given window bits: 31 gzip, 15 zlib, -15 raw
+static std::vector<uint8_t> compress(const std::vector<uint8_t> &frame, int bits, int level,
+                                     gz_header *header)
+{
+  z_stream zs;
+  memset(&zs, 0, sizeof(zs));
+  deflateInit2(&zs, level, Z_DEFLATED, bits, 8, Z_DEFAULT_STRATEGY);
+  if (header) deflateSetHeader(&zs, header);
+  std::vector<uint8_t> coded(deflateBound(&zs, frame.size()) + 256);
+  zs.next_in = (Bytef *)frame.data();
+  zs.avail_in = frame.size();
+  zs.next_out = coded.data();
+  zs.avail_out = coded.size();
+  CHECK(deflate(&zs, Z_FINISH) == Z_STREAM_END);
+  coded.resize(zs.total_out);
+  deflateEnd(&zs);
+  return coded;
+}
+
+// Feed the body the way the sketch's readFrameBody does: new input only
+// once the inflater has used up the last read and owes no more output
+static std::vector<uint8_t> inflate(FrameInflate *z, const std::vector<uint8_t> &coded, size_t available,
+                                    size_t max_read, size_t max_out)
+{
+  std::vector<uint8_t> out;
+  static uint8_t buf[FRAME_BYTES];
+  const uint8_t *wire = NULL;
+  size_t wire_len = 0;
+  size_t pos = 0;
+
+  while (true) {
+    UDOUBLE n = 1 + nextRandom() % max_out;
+    UDOUBLE used = FrameInflate_Run(z, wire, wire_len, buf, &n);
+    wire += used;
+    wire_len -= used;
+    if (z->error) break;
+    if (n > 0) {
+      out.insert(out.end(), buf, buf + n);
+      continue;
+    }
+    if (z->done) break;
+    CHECK(wire_len == 0);  // The next read overwrites what is left
+    if (pos == available) break;
+    size_t len = 1 + nextRandom() % max_read;
+    if (len > available - pos) len = available - pos;
+    wire = coded.data() + pos;
+    wire_len = len;
+    pos += len;
+  }
+  return out;
+}
+
+static void testGzipHeaderFields(void)
+{
+  std::vector<uint8_t> frame = makeFrame(SMALL_BYTES);
+  static uint8_t extra[] = {'E', 'P', 4, 0, 1, 2, 3, 4};
+  gz_header header;
+  memset(&header, 0, sizeof(header));
+  header.extra = extra;
+  header.extra_len = sizeof(extra);
+  header.name = (Bytef *)"frame.bin";
+  header.comment = (Bytef *)"test frame";
+  header.hcrc = 1;
+  std::vector<uint8_t> coded = compress(frame, 31, 6, &header);
+  CHECK(coded[3] == 0x1E);  // FHCRC | FEXTRA | FNAME | FCOMMENT
+
+  for (size_t max_read : {(size_t)1, (size_t)3, (size_t)READ_BYTES}) {
+    FrameInflate z;
+    CHECK(FrameInflate_Begin(&z, FRAME_INFLATE_GZIP));
+    std::vector<uint8_t> out = inflate(&z, coded, coded.size(), max_read, 257);
+    CHECK(!z.error);
+    CHECK(z.done);
+    CHECK(out == frame);
+    CHECK(z.out_total == frame.size());
+    // Everything but the 8-byte trailer, header included
+    CHECK(z.in_total == coded.size() - 8);
+    FrameInflate_End(&z);
+  }
+}
+
+static void testZlib(void)
+{
+  std::vector<uint8_t> frame = makeFrame(FRAME_BYTES);
+  std::vector<uint8_t> coded = compress(frame, 15, 6, NULL);
+  FrameInflate z;
+  CHECK(FrameInflate_Begin(&z, FRAME_INFLATE_ZLIB));
+  std::vector<uint8_t> out = inflate(&z, coded, coded.size(), READ_BYTES, 300);
+  CHECK(z.done && !z.error);
+  CHECK(out == frame);
+  CHECK(z.in_total == coded.size() - 4);  // Adler-32 trailer left unread
+  FrameInflate_End(&z);
+}
+
+// Content-Encoding: deflate without the zlib wrapper, including a stored
+// first block (level 0), whose first byte is 0x00 or 0x01
+static void testRawDeflate(void)
+{
+  std::vector<uint8_t> frame = makeFrame(SMALL_BYTES);
+  for (int level : {0, 1, 9}) {
+    std::vector<uint8_t> coded = compress(frame, -15, level, NULL);
+    for (size_t max_read : {(size_t)1, (size_t)READ_BYTES}) {
+      FrameInflate z;
+      CHECK(FrameInflate_Begin(&z, FRAME_INFLATE_ZLIB));
+      std::vector<uint8_t> out = inflate(&z, coded, coded.size(), max_read, 300);
+      CHECK(z.done && !z.error);
+      CHECK(out == frame);
+      CHECK(z.in_total == coded.size());
+      FrameInflate_End(&z);
+    }
+  }
+}
+
+// A body cut short is no error, just never done: the caller resumes or fails
+static void testTruncated(void)
+{
+  std::vector<uint8_t> frame = makeFrame(FRAME_BYTES);
+  std::vector<uint8_t> coded = compress(frame, 31, 6, NULL);
+  FrameInflate z;
+  CHECK(FrameInflate_Begin(&z, FRAME_INFLATE_GZIP));
+  std::vector<uint8_t> out = inflate(&z, coded, coded.size() / 2, READ_BYTES, 300);
+  CHECK(!z.done && !z.error);
+  CHECK(z.in_total == coded.size() / 2);
+  CHECK(out.size() > 0 && out.size() < frame.size());
+  CHECK(memcmp(out.data(), frame.data(), out.size()) == 0);
+  FrameInflate_End(&z);
+
+  // Only part of the gzip header: nothing inflated yet, all of it consumed
+  CHECK(FrameInflate_Begin(&z, FRAME_INFLATE_GZIP));
+  out = inflate(&z, coded, 6, 1, 300);
+  CHECK(out.empty() && !z.done && !z.error);
+  CHECK(z.in_total == 6);
+  FrameInflate_End(&z);
+}
+
+static void testMalformed(void)
+{
+  std::vector<uint8_t> frame = makeFrame(SMALL_BYTES);
+  FrameInflate z;
+
+  // A zlib body announced as gzip
+  std::vector<uint8_t> coded = compress(frame, 15, 6, NULL);
+  CHECK(FrameInflate_Begin(&z, FRAME_INFLATE_GZIP));
+  inflate(&z, coded, coded.size(), READ_BYTES, 300);
+  CHECK(z.error);
+  FrameInflate_End(&z);
+
+  // zlib header asking for a preset dictionary
+  static const uint8_t fdict[] = {0x78, 0xBB, 0, 0, 0, 1, 0x03, 0x00};
+  coded.assign(fdict, fdict + sizeof(fdict));
+  CHECK(FrameInflate_Begin(&z, FRAME_INFLATE_ZLIB));
+  inflate(&z, coded, coded.size(), READ_BYTES, 300);
+  CHECK(z.error);
+  FrameInflate_End(&z);
+
+  // Corrupt deflate data after a good gzip header
+  coded = compress(frame, 31, 6, NULL);
+  for (size_t i = 10; i < 40; i++) coded[i] = 0xFF;
+  CHECK(FrameInflate_Begin(&z, FRAME_INFLATE_GZIP));
+  inflate(&z, coded, coded.size(), READ_BYTES, 300);
+  CHECK(z.error);
+  FrameInflate_End(&z);
+}
+
+// Whole frame, segment-sized reads, line-sized output (host inflater)
+static void testThroughput(void)
+{
+  std::vector<uint8_t> frame = makeFrame(FRAME_BYTES);
+  std::vector<uint8_t> coded = compress(frame, 31, 6, NULL);
+  FrameInflate z;
+  CHECK(FrameInflate_Begin(&z, FRAME_INFLATE_GZIP));
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  std::vector<uint8_t> out = inflate(&z, coded, coded.size(), READ_BYTES, 300);
+  double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  CHECK(out == frame);
+  printf("   gzip frame: %zu -> %zu bytes, %.1f MB/s out, %lu bytes working set\n",
+         coded.size(), out.size(), out.size() / s / 1e6, (unsigned long)FrameInflate_Footprint());
+  FrameInflate_End(&z);
+}
+
+int main(void)
+{
+  RUN(testGzipHeaderFields());
+  RUN(testZlib());
+  RUN(testRawDeflate());
+  RUN(testTruncated());
+  RUN(testMalformed());
+  RUN(testThroughput());
+  return Test_Result();
+}
@@ -0,0 +1,90 @@
+/**
+ * FramePack: bit layout against a per-pixel reference, round trips,
+ * rejected codes and the packed sizes.
+ */
+
+#include "Test.h"
+#include "FramePack.h"
+#include <string.h>
+
+#define WIDTH  600
+
+static uint32_t rng = 1;
+
+static uint8_t nextCode(void)
+{
+  rng = rng * 1103515245u + 12345u;
+  return (rng >> 16) % 7;
+}
+
+// One pixel at a time: pixel p takes bits 3p..3p+2 from the top of the line
+static void referencePack(const uint8_t *in, uint8_t *out, size_t width)
+{
+  memset(out, 0, FRAME_PACK_BYTES(width));
+  for (size_t p = 0; p < width * 2; p++) {
+    uint8_t code = p & 1 ? in[p / 2] & 0x07 : in[p / 2] >> 4;
+    for (int b = 0; b < 3; b++) {
+      if (code & (4 >> b)) out[(p * 3 + b) / 8] |= 0x80 >> ((p * 3 + b) % 8);
+    }
+  }
+}
+
+static void testSizes(void)
+{
+  CHECK(FRAME_PACK_BYTES(300) == 225);
+  CHECK(FRAME_PACK_BYTES(600) == 450);
+  CHECK(FRAME_PACK_BYTES(600) * 1600 == 720000);
+}
+
+static void testRoundTrip(void)
+{
+  static uint8_t line[WIDTH], packed[FRAME_PACK_BYTES(WIDTH)], expected[FRAME_PACK_BYTES(WIDTH)];
+  static uint8_t unpacked[WIDTH + 4];
+
+  for (int round = 0; round < 200; round++) {
+    for (int i = 0; i < WIDTH; i++) line[i] = (uint8_t)(nextCode() << 4 | nextCode());
+    size_t width = round & 1 ? 300 : WIDTH;
+
+    CHECK(FramePack_Pack(line, packed, width));
+    referencePack(line, expected, width);
+    CHECK(memcmp(packed, expected, FRAME_PACK_BYTES(width)) == 0);
+
+    // Nothing written past the line
+    memset(unpacked, 0xEE, sizeof(unpacked));
+    FramePack_Unpack(packed, unpacked, width);
+    CHECK(memcmp(unpacked, line, width) == 0);
+    CHECK(unpacked[width] == 0xEE);
+  }
+
+  // Every pixel pair, including code 7 which fits the wire
+  for (int b = 0; b < 256; b++) {
+    if (b & 0x88) continue;
+    uint8_t in[4] = {(uint8_t)b, (uint8_t)b, 0x70, 0x07}, out[3], back[4];
+    CHECK(FramePack_Pack(in, out, 4));
+    FramePack_Unpack(out, back, 4);
+    CHECK(memcmp(in, back, 4) == 0);
+  }
+}
+
+// A nibble code of 8 or more anywhere in the line is refused
+static void testRejected(void)
+{
+  static uint8_t line[300], packed[FRAME_PACK_BYTES(300)];
+  static const uint8_t bad[] = {0x80, 0x08, 0xF0, 0x0F, 0x99};
+  static const int positions[] = {0, 3, 151, 299};
+  for (uint8_t value : bad) {
+    for (int at : positions) {
+      memset(line, 0x12, sizeof(line));
+      line[at] = value;
+      CHECK(!FramePack_Pack(line, packed, sizeof(line)));
+    }
+  }
+}
+
+int main(void)
+{
+  RUN(testSizes());
+  RUN(testRoundTrip());
+  RUN(testRejected());
+  return Test_Result();
+}
@@ -0,0 +1,231 @@
+/**
+ * FrameStore on a file-backed partition: commit and read back, restore
+ * after a reboot, prefetch and eviction, the cache selection and
+ * duplicates, and a power cut at every flash operation of an update.
+ */
+
+#include "Test.h"
+#include "DEV_Host.h"
+#include "FrameStore.h"
+#include <stdlib.h>
+#include <unistd.h>
+#include <vector>
+
+#define PART_SIZE    0x260000              // As in partitions.csv
+#define RECORD       300
+#define FRAME_BYTES  (1600 * 600)
+#define SMALL_BYTES  (160 * 600)
+
+static char path[] = "/tmp/frame_store_XXXXXX";
+
+static std::vector<UBYTE> makeFrame(int seed, size_t len)
+{
+  std::vector<UBYTE> frame(len);
+  uint32_t x = seed * 2654435761u + 1;
+  for (size_t i = 0; i < len; i++) {
+    x = x * 1103515245u + 12345u;
+    frame[i] = (UBYTE)(((x >> 16) % 7) << 4 | (x >> 24) % 7);
+  }
+  return frame;
+}
+
+static const char *hashOf(int seed)
+{
+  static char hash[16];
+  snprintf(hash, sizeof(hash), "frame%04d", seed);
+  return hash;
+}
+
+static bool stage(int seed, size_t len, bool select)
+{
+  std::vector<UBYTE> frame = makeFrame(seed, len);
+  if (!FrameStore_BeginStaging()) return false;
+  for (size_t at = 0; at < len; at += RECORD) {
+    if (!FrameStore_Write(frame.data() + at, RECORD)) return false;
+  }
+  return FrameStore_Commit(hashOf(seed), select);
+}
+
+// Stage, and when shown mark it current as after the refresh
+static bool store(int seed, size_t len, bool shown)
+{
+  return stage(seed, len, shown) && (!shown || FrameStore_MarkCurrent());
+}
+
+// Current frame read back in odd-sized pieces at unaligned offsets
+static bool matches(int seed, size_t len)
+{
+  std::vector<UBYTE> frame = makeFrame(seed, len);
+  static UBYTE got[5000];
+  if (FrameStore_Length() != len || strcmp(FrameStore_Hash(), hashOf(seed)) != 0) return false;
+  for (size_t at = 0, n = 1; at < len; at += n, n = n * 7 % 4999 + 1) {
+    if (n > len - at) n = len - at;
+    if (!FrameStore_Read(at, got, n) || memcmp(got, frame.data() + at, n) != 0) return false;
+  }
+  return true;
+}
+
+// Power off and on: the file is all that survives
+static void reboot(void)
+{
+  DEV_Host_FlashPowerOn();
+  DEV_Host_DetachFlash();
+  CHECK(DEV_Host_AttachFlash(path, PART_SIZE));
+  CHECK(FrameStore_Init(RECORD));
+}
+
+static void freshFlash(void)
+{
+  DEV_Host_DetachFlash();
+  CHECK(truncate(path, 0) == 0);
+  CHECK(DEV_Host_AttachFlash(path, PART_SIZE));
+  CHECK(FrameStore_Init(RECORD));
+}
+
+static void testEmpty(void)
+{
+  DEV_Host_DetachFlash();
+  CHECK(!FrameStore_Init(RECORD));
+  CHECK(!FrameStore_Ready());
+
+  freshFlash();
+  CHECK(FrameStore_Slots() == 3);
+  CHECK(FrameStore_Cached() == 0);
+  CHECK(FrameStore_Hash()[0] == '\0');
+}
+
+static void testCommitAndRestore(void)
+{
+  freshFlash();
+  CHECK(store(1, FRAME_BYTES, true));
+  DEV_Host_Flash flash = DEV_Host_GetFlash();
+  printf("   staging a frame: %lu bytes written, %lu sectors erased, ~%lu ms of flash time\n",
+         (unsigned long)flash.write_bytes, (unsigned long)flash.erased_sectors,
+         (unsigned long)flash.busy_ms);
+  CHECK(flash.write_bytes < FRAME_BYTES);
+  CHECK(matches(1, FRAME_BYTES));
+
+  reboot();
+  CHECK(matches(1, FRAME_BYTES));
+  CHECK(FrameStore_Cached() == 1);
+
+  // Stored with another stream record size: not usable
+  CHECK(FrameStore_Init(2 * RECORD));
+  CHECK(FrameStore_Hash()[0] == '\0');
+  CHECK(FrameStore_Cached() == 0);
+}
+
+// Prefetched frames stay cached; the frame on screen is never evicted
+static void testPrefetchAndEviction(void)
+{
+  freshFlash();
+  CHECK(store(1, SMALL_BYTES, true));
+  CHECK(store(2, SMALL_BYTES, false));
+  CHECK(matches(1, SMALL_BYTES));
+  CHECK(FrameStore_Contains(hashOf(2)));
+
+  for (int seed = 3; seed < 10; seed++) {
+    CHECK(store(seed, SMALL_BYTES, false));
+    CHECK(matches(1, SMALL_BYTES));
+    CHECK(FrameStore_Contains(hashOf(seed)));
+    CHECK(FrameStore_Cached() == 3);
+  }
+  CHECK(!FrameStore_Contains(hashOf(2)));
+
+  reboot();
+  CHECK(matches(1, SMALL_BYTES));
+  CHECK(FrameStore_Contains(hashOf(9)));
+}
+
+// A selected frame only becomes the one restored after a reboot once it
+// is marked current; staging never takes the current or the selected slot
+static void testSelection(void)
+{
+  freshFlash();
+  CHECK(store(1, SMALL_BYTES, true));
+  CHECK(store(2, SMALL_BYTES, false));
+  CHECK(!FrameStore_Select(hashOf(7)));
+  CHECK(FrameStore_Select(hashOf(2)));
+  CHECK(matches(2, SMALL_BYTES));
+
+  CHECK(store(3, SMALL_BYTES, false));
+  CHECK(FrameStore_Contains(hashOf(1)) && FrameStore_Contains(hashOf(2)));
+  CHECK(store(4, SMALL_BYTES, false));
+  CHECK(FrameStore_Contains(hashOf(1)) && FrameStore_Contains(hashOf(2)));
+  CHECK(!FrameStore_Contains(hashOf(3)));
+
+  // Refresh never finished
+  reboot();
+  CHECK(matches(1, SMALL_BYTES));
+
+  CHECK(FrameStore_Select(hashOf(2)));
+  CHECK(FrameStore_MarkCurrent());
+  reboot();
+  CHECK(matches(2, SMALL_BYTES));
+}
+
+// Downloading the frame on screen again keeps the copy on screen
+static void testDuplicate(void)
+{
+  freshFlash();
+  CHECK(store(1, SMALL_BYTES, true));
+  CHECK(store(2, SMALL_BYTES, false));
+  CHECK(store(1, SMALL_BYTES, true));
+  CHECK(FrameStore_Cached() == 2);
+  CHECK(matches(1, SMALL_BYTES));
+  reboot();
+  CHECK(matches(1, SMALL_BYTES));
+
+  // A cached copy that is not on screen gives way to the new one
+  CHECK(stage(2, SMALL_BYTES, false));
+  CHECK(FrameStore_Cached() == 2);
+  CHECK(FrameStore_Select(hashOf(2)));
+  CHECK(matches(2, SMALL_BYTES));
+}
+
+// Until the directory write that marks the new frame current completes, a
+// reboot finds the old frame; after it, the new one
+static void testPowerCut(void)
+{
+  freshFlash();
+  CHECK(store(1, SMALL_BYTES, true));
+  UDOUBLE before = DEV_Host_GetFlash().ops;
+  CHECK(store(2, SMALL_BYTES, true));
+  UDOUBLE ops = DEV_Host_GetFlash().ops - before;
+  CHECK(ops > 4);
+
+  for (UDOUBLE cut = 0; cut < ops; cut++) {
+    freshFlash();
+    CHECK(store(1, SMALL_BYTES, true));
+    DEV_Host_FlashCutAfter(cut);
+    CHECK(!store(2, SMALL_BYTES, true));
+    reboot();
+    CHECK(matches(1, SMALL_BYTES));
+
+    // And the store carries on from there
+    CHECK(store(2, SMALL_BYTES, true));
+    reboot();
+    CHECK(matches(2, SMALL_BYTES));
+  }
+}
+
+int main(void)
+{
+  int fd = mkstemp(path);
+  if (fd < 0) {
+    perror("mkstemp");
+    return 1;
+  }
+  close(fd);
+
+  RUN(testEmpty());
+  RUN(testCommitAndRestore());
+  RUN(testPrefetchAndEviction());
+  RUN(testSelection());
+  RUN(testDuplicate());
+  RUN(testPowerCut());
+
+  DEV_Host_DetachFlash();
+  unlink(path);
+  return Test_Result();
+}
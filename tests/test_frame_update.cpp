@@ -0,0 +1,833 @@
+/**
+ * FrameUpdate end to end against a loopback server: the info request, the
+ * download through the receive task into the panel or the frame store,
+ * frames shown again from the flash cache, the raw stream's reads and
+ * throughput, the line ring behind a throttled server, Range resumes
+ * after dropped connections, deltas against the stored frame, a playlist
+ * rotating through the flash cache, the next frame prefetched while the
+ * panel refreshes, one connection kept across requests and polls,
+ * conditional polls of the stream itself, and long polls held until the
+ * frame changes.
+ */
+
+#include "Test.h"
+#include "DEV_Host.h"
+#include "FrameUpdate.h"
+#include "FrameStore.h"
+#include "NET_Stream.h"
+#include "esp_rom_crc.h"
+#include "lwip/sockets.h"
+#include <MD5Builder.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <inttypes.h>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#define PART_SIZE   0x260000               // As in partitions.csv
+#define LINE_BYTES  (EPD_13IN3E_WIDTH / 4)
+#define HALF_BYTES  ((UDOUBLE)LINE_BYTES * EPD_13IN3E_HEIGHT)
+#define PACE_BYTES  8192
+
+typedef std::vector<UBYTE> Frame;
+
+static char flash_path[] = "/tmp/frame_update_XXXXXX";
+
+// Frame body as the server sends it for this build's layout
+static Frame makeFrame(int seed)
+{
+  Frame frame(FRAME_UPDATE_BYTES);
+  uint32_t x = seed * 2654435761u + 1;
+  for (size_t i = 0; i < frame.size(); i++) {
+    x = x * 1103515245u + 12345u;
+    frame[i] = (UBYTE)(((x >> 16) % 7) << 4 | (x >> 24) % 7);
+  }
+  return frame;
+}
+
+static std::string md5Of(const Frame &frame)
+{
+  MD5Builder md5;
+  char hex[33];
+  md5.begin();
+  md5.add(frame.data(), frame.size());
+  md5.calculate();
+  md5.getChars(hex);
+  return hex;
+}
+
+// CRC of the bytes controller index (0 = master) should have received
+static UDOUBLE panelCrc(const Frame &frame, int index)
+{
+#ifdef EPD_DUAL_BUS
+  UDOUBLE crc = 0;
+  for (UDOUBLE y = 0; y < EPD_13IN3E_HEIGHT; y++) {
+    crc = esp_rom_crc32_le(crc, frame.data() + (2 * y + index) * LINE_BYTES, LINE_BYTES);
+  }
+  return crc;
+#else
+  return esp_rom_crc32_le(0, frame.data() + index * HALF_BYTES, HALF_BYTES);
+#endif
+}
+
+static void putLE(Frame *out, UDOUBLE v)
+{
+  for (int i = 0; i < 4; i++) out->push_back((UBYTE)(v >> (8 * i)));
+}
+
+// Delta body: the ranges where target differs from base (gaps shorter
+// than a range header merged), then a zero-length terminator
+static Frame makeDelta(const Frame &base, const Frame &target)
+{
+  Frame out;
+  size_t i = 0;
+  while (i < target.size()) {
+    if (base[i] == target[i]) { i++; continue; }
+    size_t end = i + 1, same = 0;
+    for (size_t j = end; j < target.size() && same < 8; j++) {
+      if (base[j] == target[j]) { same++; continue; }
+      same = 0;
+      end = j + 1;
+    }
+    putLE(&out, i);
+    putLE(&out, end - i);
+    out.insert(out.end(), target.begin() + i, target.begin() + end);
+    i = end;
+  }
+  putLE(&out, 0);
+  putLE(&out, 0);
+  return out;
+}
+
+// Image server on a loopback socket, one thread per connection:
+// /api/image/info names the current frame (held up to wait= seconds while
+// it is the known= one), /api/image/stream sends it
+// (or the one named by hash=), as a delta when it knows the base= frame,
+// tagged with its hash; If-None-Match of the current frame gets a 304
+struct FrameServer {
+  int fd = -1;
+  uint16_t port = 0;
+  std::thread thread;
+  std::mutex lock;
+  std::condition_variable changed;     // Current frame replaced
+  std::vector<std::thread> workers;
+  std::vector<int> conns;
+  std::map<std::string, Frame> frames;
+  std::string current;
+  std::string info_extra;              // More members for the info JSON (", \"key\": ...")
+  std::string advance_to;              // Becomes current once a frame response is sent
+  std::vector<std::string> requests;   // Request lines, in order
+  std::atomic<int> accepted{0};
+  std::atomic<int> pace_us{0};         // Pause per PACE_BYTES of a frame body
+  std::atomic<long> drop_at{-1};       // Close the next frame response after this many body bytes
+  std::atomic<bool> drop_always{false};// ... and every one after it
+  std::atomic<bool> ignore_range{false};
+  std::atomic<long> body_sent{0};      // Frame body bytes sent, resent ones included
+  std::atomic<int> not_modified{0};    // 304 responses
+
+  bool start() {
+    fd = socket(AF_INET, SOCK_STREAM, 0);
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(addr);
+    if (bind(fd, (struct sockaddr *)&addr, len) != 0 || listen(fd, 4) != 0) return false;
+    getsockname(fd, (struct sockaddr *)&addr, &len);
+    port = ntohs(addr.sin_port);
+    thread = std::thread([this]() { run(); });
+    return true;
+  }
+
+  // Server side of an idle timeout: every open connection is closed
+  void closeConnections() {
+    std::lock_guard<std::mutex> hold(lock);
+    for (int c : conns) if (c >= 0) shutdown(c, SHUT_RDWR);
+  }
+
+  void stop() {
+    closeConnections();
+    shutdown(fd, SHUT_RDWR);
+    close(fd);
+    thread.join();
+    for (std::thread &t : workers) t.join();
+  }
+
+  // Add a frame and make it the current one
+  std::string publish(int seed) {
+    return publish(makeFrame(seed));
+  }
+
+  std::string publish(const Frame &frame) {
+    std::string hash = md5Of(frame);
+    std::lock_guard<std::mutex> hold(lock);
+    frames[hash] = frame;
+    current = hash;
+    changed.notify_all();
+    return hash;
+  }
+
+  int count(const char *prefix) {
+    std::lock_guard<std::mutex> hold(lock);
+    int n = 0;
+    for (const std::string &r : requests) n += r.compare(0, strlen(prefix), prefix) == 0;
+    return n;
+  }
+
+  // Last request starting with prefix
+  std::string last(const char *prefix) {
+    std::lock_guard<std::mutex> hold(lock);
+    for (auto r = requests.rbegin(); r != requests.rend(); ++r) {
+      if (r->compare(0, strlen(prefix), prefix) == 0) return *r;
+    }
+    return "";
+  }
+
+  void run() {
+    for (;;) {
+      int c = accept(fd, NULL, NULL);
+      if (c < 0) return;
+      accepted++;
+      std::lock_guard<std::mutex> hold(lock);
+      conns.push_back(c);
+      workers.emplace_back([this, c]() {
+        serve(c);
+        std::lock_guard<std::mutex> hold(lock);
+        for (int &open : conns) if (open == c) open = -1;
+        close(c);
+      });
+    }
+  }
+
+  static std::string param(const std::string &path, const char *name) {
+    std::string key = std::string(name) + "=";
+    size_t at = path.find(key);
+    if (at == std::string::npos || (path[at - 1] != '?' && path[at - 1] != '&')) return "";
+    at += key.size();
+    return path.substr(at, path.find('&', at) - at);
+  }
+
+  bool sendAll(int c, const char *data, size_t len) {
+    return ::send(c, data, len, MSG_NOSIGNAL) == (ssize_t)len;
+  }
+
+  // Header and the first body bytes in one segment; a paced body follows
+  // in PACE_BYTES pieces. With cut the connection is closed after that
+  // many body bytes instead.
+  bool send(int c, const std::string &head, const UBYTE *body, size_t len, long cut = -1) {
+    std::string response = head + "Connection: keep-alive\r\n\r\n";
+    size_t end = cut >= 0 ? std::min(len, (size_t)cut) : len;
+    size_t first = pace_us > 0 ? std::min(end, (size_t)PACE_BYTES) : end;
+    response.append((const char *)body, first);
+    if (!sendAll(c, response.data(), response.size())) return false;
+    for (size_t at = first; at < end; at += PACE_BYTES) {
+      std::this_thread::sleep_for(std::chrono::microseconds(pace_us.load()));
+      if (!sendAll(c, (const char *)body + at, std::min(end - at, (size_t)PACE_BYTES))) return false;
+    }
+    return end == len;
+  }
+
+  // Requests on one connection until the client closes it
+  void serve(int c) {
+    std::string request;
+    char buf[512];
+    for (;;) {
+      size_t end;
+      while ((end = request.find("\r\n\r\n")) == std::string::npos) {
+        int n = recv(c, buf, sizeof(buf), 0);
+        if (n <= 0) return;
+        request.append(buf, n);
+      }
+      std::string head = request.substr(0, end);
+      request.erase(0, end + 4);
+      std::string path = head.substr(4, head.find(' ', 4) - 4);
+      {
+        std::lock_guard<std::mutex> hold(lock);
+        requests.push_back(path);
+      }
+      if (!respond(c, path, head)) return;
+    }
+  }
+
+  bool respond(int c, const std::string &path, const std::string &request) {
+    char head[256];
+    std::unique_lock<std::mutex> hold(lock);
+#ifdef EPD_DUAL_BUS
+    // Row-major frames (and digests over them) only when asked for
+    if (path.find("layout=rows") == std::string::npos) {
+      hold.unlock();
+      return send(c, "HTTP/1.1 400 Bad Request\r\nContent-Length: 0\r\n", NULL, 0);
+    }
+#endif
+    if (path.compare(0, 15, "/api/image/info") == 0) {
+      std::string wait = param(path, "wait"), known = param(path, "known");
+      if (!wait.empty() && known == current) {
+        changed.wait_for(hold, std::chrono::seconds(atoi(wait.c_str())),
+                         [&]() { return current != known; });
+      }
+      std::string json = "{\"hash\": \"" + current + "\", \"size\": " +
+                         std::to_string(FRAME_UPDATE_BYTES) + info_extra + "}";
+      hold.unlock();
+      snprintf(head, sizeof(head), "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\n"
+               "Content-Length: %u\r\n", (unsigned)json.size());
+      return send(c, head, (const UBYTE *)json.data(), json.size());
+    }
+
+    std::string hash = param(path, "hash");
+    if (hash.empty()) hash = current;
+    if (request.find("If-None-Match: \"" + hash + "\"") != std::string::npos) {
+      hold.unlock();
+      not_modified++;
+      return send(c, "HTTP/1.1 304 Not Modified\r\nContent-Length: 0\r\n", NULL, 0);
+    }
+    if (!frames.count(hash)) {
+      hold.unlock();
+      return send(c, "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n", NULL, 0);
+    }
+    std::string base = param(path, "base");
+    bool delta = !base.empty() && base != hash && frames.count(base);
+    const Frame frame = delta ? makeDelta(frames[base], frames[hash]) : frames[hash];
+    hold.unlock();
+
+    unsigned long offset = 0;
+    size_t range = request.find("Range: bytes=");
+    if (range != std::string::npos && !ignore_range) {
+      offset = strtoul(request.c_str() + range + 13, NULL, 10);
+    }
+    if (offset > 0) {
+      snprintf(head, sizeof(head), "HTTP/1.1 206 Partial Content\r\nContent-Length: %lu\r\n"
+               "Content-Range: bytes %lu-%u/%u\r\n", frame.size() - offset, offset,
+               (unsigned)frame.size() - 1, (unsigned)frame.size());
+    } else {
+      snprintf(head, sizeof(head), "HTTP/1.1 200 OK\r\nContent-Length: %u\r\n", (unsigned)frame.size());
+    }
+    std::string header = head;
+    header += "ETag: \"" + hash + "\"\r\n";
+    if (delta) header += "X-Frame-Delta: " + base + "\r\n";
+    long cut = drop_always ? drop_at.load() : drop_at.exchange(-1);
+    body_sent += cut >= 0 ? std::min((unsigned long)cut, frame.size() - offset) : frame.size() - offset;
+    if (!send(c, header, frame.data() + offset, frame.size() - offset, cut)) return false;
+    hold.lock();
+    if (!advance_to.empty()) current = advance_to;
+    advance_to.clear();
+    return true;
+  }
+};
+
+static FrameServer server;
+
+static void startPanel(void)
+{
+  DEV_Host_Reset();
+  DEV_Host_SetBusyTime(30, 20000);
+  CHECK(DEV_Module_Init() == 0);
+}
+
+// The panel holds exactly this frame, refreshed once
+static void checkPanel(const std::string &hash)
+{
+  const Frame &frame = server.frames[hash];
+  for (int i = 0; i < 2; i++) {
+    const DEV_Host_Controller *c = DEV_Host_GetController(i);
+    CHECK(c->dtm_bytes == HALF_BYTES);
+    CHECK(c->dtm_crc == panelCrc(frame, i));
+    CHECK(c->refreshes == 1);
+  }
+}
+
+// Empty frame store on a fresh partition file
+static void useStore(void)
+{
+  DEV_Host_DetachFlash();
+  unlink(flash_path);
+  CHECK(DEV_Host_AttachFlash(flash_path, PART_SIZE));
+  CHECK(FrameStore_Init(FRAME_UPDATE_RECORD_BYTES));
+}
+
+// One poll cycle as loop() runs it: ask, then download and show
+static bool pollAndShow(FrameUpdate *u)
+{
+  startPanel();
+  return FrameUpdate_Check(u, 0) && FrameUpdate_Show(u);
+}
+
+// No frame store: the body goes through the ring straight into the controllers
+static void testDirectToPanel(void)
+{
+  FrameUpdate u;
+  FrameUpdate_Init(&u, "127.0.0.1", server.port);
+  std::string hash = server.publish(1);
+
+  UDOUBLE start = DEV_Time_ms();
+  CHECK(pollAndShow(&u));
+  printf("   poll, download and refresh: %" PRIu32 " ms (virtual clock)\n", DEV_Time_ms() - start);
+  CHECK(hash == u.last_hash);
+  checkPanel(hash);
+  CHECK(u.next_poll_s == POLL_INTERVAL_S);
+
+  // Same frame again: one more info request, nothing downloaded
+  CHECK(!pollAndShow(&u));
+  CHECK(u.info_requests == 2);
+  CHECK(server.count("/api/image/stream") == 1);
+}
+
+// Raw body off the socket in large reads, each byte copied once into the
+// ring (plus the header residue); end-to-end rate over loopback
+static void testRawThroughput(void)
+{
+  FrameUpdate u;
+  FrameUpdate_Init(&u, "127.0.0.1", server.port);
+  std::string hash = server.publish(8);
+
+  startPanel();
+  CHECK(FrameUpdate_Check(&u, 0));
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  CHECK(FrameUpdate_Show(&u));
+  long elapsed_us = std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - start).count();
+  checkPanel(hash);
+
+  NET_Stream_Stats stats = NET_Stream_GetStats();
+  printf("   raw frame: %" PRIu32 " bytes in %" PRIu32 " reads (%" PRIu32 " via residue), "
+         "%ld us, %.1f MB/s\n", stats.bytes, stats.recv_calls, stats.residue_bytes, elapsed_us,
+         elapsed_us ? (double)stats.bytes / elapsed_us : 0.0);
+  CHECK(stats.bytes == FRAME_UPDATE_BYTES);
+  CHECK(stats.skipped_bytes == 0);
+  CHECK(stats.residue_bytes < NET_HEAD_SIZE);
+  CHECK(stats.recv_calls * FRAME_UPDATE_RECORD_BYTES < stats.bytes);  // Not a read per line
+}
+
+// A server slower than the panel: the display side mostly waits on an
+// empty ring rather than the receive task on a full one, and the frame
+// takes about as long as the server's pacing
+static void testThrottledServer(void)
+{
+  FrameUpdate u;
+  FrameUpdate_Init(&u, "127.0.0.1", server.port);
+  std::string hash = server.publish(9);
+
+  startPanel();
+  CHECK(FrameUpdate_Check(&u, 0));
+  server.pace_us = 2000;
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  CHECK(FrameUpdate_Show(&u));
+  long elapsed_us = std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - start).count();
+  server.pace_us = 0;
+  checkPanel(hash);
+
+  long paced_us = (long)(FRAME_UPDATE_BYTES / PACE_BYTES) * 2000;
+  printf("   throttled: %ld us for %ld us of pacing, ring peak %" PRIu32 " bytes, "
+         "%" PRIu32 " producer / %" PRIu32 " consumer stalls\n", elapsed_us, paced_us,
+         u.stats.ring_peak, u.stats.producer_stalls, u.stats.consumer_stalls);
+  CHECK(u.stats.wire_bytes == FRAME_UPDATE_BYTES);
+  CHECK(u.stats.consumer_stalls > u.stats.producer_stalls);
+  CHECK(u.stats.ring_peak <= 24000);
+  CHECK(elapsed_us < 2 * paced_us);
+}
+
+// Connections dropped at random offsets: each resumed with a Range
+// request, nothing sent twice, the frame completes on the first attempt
+static void testRangeResume(void)
+{
+  FrameUpdate u;
+  FrameUpdate_Init(&u, "127.0.0.1", server.port);
+  uint32_t x = 20250101;
+
+  for (int i = 0; i < 3; i++) {
+    x = x * 1103515245u + 12345u;
+    long offset = 1 + x % (FRAME_UPDATE_BYTES - 1);
+    std::string hash = server.publish(110 + i);
+    startPanel();
+    CHECK(FrameUpdate_Check(&u, 0));
+    server.body_sent = 0;
+    server.drop_at = offset;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    CHECK(FrameUpdate_Show(&u));
+    long elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    checkPanel(hash);
+    long resent = server.body_sent - (long)FRAME_UPDATE_BYTES;
+    printf("   dropped at %ld: %u resume(s), %ld bytes re-sent, %ld ms\n",
+           offset, u.stats.resumes, resent, elapsed_ms);
+    CHECK(u.stats.resumes == 1);
+    CHECK(resent == 0);
+  }
+}
+
+// A server that ignores Range: the resume re-reads and drops the head
+static void testResumeWithoutRange(void)
+{
+  FrameUpdate u;
+  FrameUpdate_Init(&u, "127.0.0.1", server.port);
+  std::string hash = server.publish(120);
+
+  startPanel();
+  CHECK(FrameUpdate_Check(&u, 0));
+  server.ignore_range = true;
+  server.body_sent = 0;
+  server.drop_at = 300000;
+  CHECK(FrameUpdate_Show(&u));
+  server.ignore_range = false;
+  checkPanel(hash);
+  printf("   without Range: %" PRIu32 " bytes re-sent\n", NET_Stream_GetStats().skipped_bytes);
+  CHECK(u.stats.resumes == 1);
+  CHECK(NET_Stream_GetStats().skipped_bytes == 300000);
+  CHECK(server.body_sent == (long)FRAME_UPDATE_BYTES + 300000);
+}
+
+// Every connection drops: bounded retries, then the frame is given up and
+// the panel is left as it was
+static void testResumeBudget(void)
+{
+  FrameUpdate u;
+  FrameUpdate_Init(&u, "127.0.0.1", server.port);
+  server.publish(121);
+
+  startPanel();
+  CHECK(FrameUpdate_Check(&u, 0));
+  server.drop_always = true;
+  server.drop_at = 100000;
+  CHECK(!FrameUpdate_Show(&u));
+  server.drop_always = false;
+  server.drop_at = -1;
+  CHECK(u.stats.resumes == 3);
+  CHECK(u.last_hash[0] == '\0');
+  CHECK(DEV_Host_GetController(0)->refreshes == 0);
+  CHECK(DEV_Host_GetController(1)->refreshes == 0);
+}
+
+// With a frame store: staged, verified, committed, then pushed from flash;
+// a frame shown before comes back from the cache without a download
+static void testThroughStore(void)
+{
+  FrameUpdate u;
+  FrameUpdate_Init(&u, "127.0.0.1", server.port);
+  useStore();
+
+  std::string first = server.publish(2);
+  CHECK(pollAndShow(&u));
+  checkPanel(first);
+  CHECK(first == FrameStore_Hash());
+
+  std::string second = server.publish(3);
+  CHECK(pollAndShow(&u));
+  checkPanel(second);
+  int streams = server.count("/api/image/stream");
+
+  server.current = first;
+  CHECK(pollAndShow(&u));
+  checkPanel(first);
+  CHECK(first == u.last_hash);
+  CHECK(server.count("/api/image/stream") == streams);
+}
+
+// Typical dashboard edits sent as deltas against the frame on screen
+// (bytes on air per update); a base the server does not know means a
+// full download
+static void testDelta(void)
+{
+  FrameUpdate u;
+  FrameUpdate_Init(&u, "127.0.0.1", server.port);
+  useStore();
+  Frame frame = makeFrame(160);
+  std::string hash = server.publish(frame);
+  CHECK(pollAndShow(&u));
+  checkPanel(hash);
+  CHECK(u.stats.wire_bytes == FRAME_UPDATE_BYTES);  // Nothing stored to patch
+
+  struct Edit { const char *name; size_t offset, len, count, stride; };
+  static const Edit edits[] = {
+    {"clock", 40 * 600 + 120, 24, 16, 600},         // A few digits
+    {"weather", 300 * 600 + 400, 60, 48, 600},      // A number and an icon
+    {"calendar", 900 * 600, 600, 40, 600},          // One entry, whole rows
+  };
+  for (const Edit &edit : edits) {
+    for (size_t r = 0; r < edit.count; r++) {
+      for (size_t i = 0; i < edit.len; i++) frame[edit.offset + r * edit.stride + i] ^= 0x11;
+    }
+    hash = server.publish(frame);
+    CHECK(pollAndShow(&u));
+    checkPanel(hash);
+    printf("   %s: %" PRIu32 " bytes on air, %" PRIu32 " patched\n", edit.name,
+           u.stats.wire_bytes, u.stats.patched);
+    CHECK(u.stats.patched == edit.len * edit.count);
+    CHECK(u.stats.wire_bytes < edit.len * edit.count + 8 * (edit.count + 1) + 8 * 8);
+  }
+
+  // The server lost the stored frame: the whole frame comes again
+  {
+    std::lock_guard<std::mutex> hold(server.lock);
+    server.frames.erase(u.last_hash);
+  }
+  hash = server.publish(161);
+  CHECK(pollAndShow(&u));
+  checkPanel(hash);
+  CHECK(u.stats.wire_bytes == FRAME_UPDATE_BYTES);
+  CHECK(u.stats.patched == 0);
+}
+
+// Playlist entries are downloaded once (by hash=), then shown from the
+// cache on every later turn; the interval holds an entry on screen
+static void testPlaylist(void)
+{
+  FrameUpdate u;
+  FrameUpdate_Init(&u, "127.0.0.1", server.port);
+  useStore();
+  std::string list[3];
+  for (int i = 0; i < 3; i++) list[i] = server.publish(170 + i);
+  server.info_extra = ", \"playlist\": \"" + list[0] + "," + list[1] + "," + list[2] +
+                      "\", \"playlist_interval\": 0";
+  int streams = server.count("/api/image/stream");
+
+  for (int turn = 0; turn < 6; turn++) {
+    CHECK(pollAndShow(&u));
+    checkPanel(list[turn % 3]);
+    CHECK(list[turn % 3] == u.last_hash);
+    CHECK(server.count("/api/image/stream") == streams + std::min(turn + 1, 3));
+  }
+  CHECK(server.count("/api/image/stream?hash=") + server.count("/api/image/stream?layout=rows&hash=") == 2);
+  printf("   playlist: 6 turns, %d downloads\n", server.count("/api/image/stream") - streams);
+
+  // Same list, an hour per entry: the one on screen stays
+  server.info_extra = ", \"playlist\": \"" + list[0] + "," + list[1] + "," + list[2] +
+                      "\", \"playlist_interval\": 3600";
+  CHECK(!pollAndShow(&u));
+  CHECK(list[2] == u.last_hash);
+  server.info_extra = "";
+}
+
+// Show the pending frame; virtual time from the start of the update until
+// the panel is refreshed and off
+static UDOUBLE timedShow(FrameUpdate *u)
+{
+  UDOUBLE start = DEV_Time_ms();
+  CHECK(FrameUpdate_Show(u));
+  for (int i = 0; i < 2; i++) CHECK(DEV_Host_GetController(i)->power_offs >= 1);
+  return DEV_Time_ms() - start;
+}
+
+// Slideshow with prefetch: every entry after the first is already in flash
+// when its turn comes, so an update costs the push and the refresh only
+static void testPrefetchPlaylist(void)
+{
+  FrameUpdate u;
+  FrameUpdate_Init(&u, "127.0.0.1", server.port);
+  u.prefetch = true;
+  useStore();
+  std::string list[3];
+  for (int i = 0; i < 3; i++) list[i] = server.publish(180 + i);
+  server.info_extra = ", \"playlist\": \"" + list[0] + "," + list[1] + "," + list[2] +
+                      "\", \"playlist_interval\": 0";
+  static const int downloads[] = {2, 1, 0, 0};  // Shown entry and/or the next one
+
+  for (int turn = 0; turn < 4; turn++) {
+    int streams = server.count("/api/image/stream");
+    startPanel();
+    CHECK(FrameUpdate_Check(&u, 0));
+    UDOUBLE update_ms = timedShow(&u);
+    checkPanel(list[turn % 3]);
+    CHECK(server.count("/api/image/stream") - streams == downloads[turn]);
+    printf("   turn %d: %" PRIu32 " ms to a refreshed panel, %d download(s)\n",
+           turn, update_ms, downloads[turn]);
+    if (turn > 0) CHECK(update_ms < 20000 + 30 + 2000);  // Refresh, PON and the flash push
+  }
+  server.info_extra = "";
+}
+
+// Without a playlist the info endpoint names the next frame during the
+// refresh; the following poll finds it in flash
+static void testPrefetchNext(void)
+{
+  FrameUpdate u;
+  FrameUpdate_Init(&u, "127.0.0.1", server.port);
+  u.prefetch = true;
+  useStore();
+  std::string first = server.publish(190);
+  std::string second = server.publish(191);
+  server.current = first;
+  server.advance_to = second;
+
+  CHECK(pollAndShow(&u));
+  checkPanel(first);
+  CHECK(FrameStore_Contains(second.c_str()));
+  int streams = server.count("/api/image/stream");
+  startPanel();
+  CHECK(FrameUpdate_Check(&u, 0));
+  timedShow(&u);
+  checkPanel(second);
+  CHECK(server.count("/api/image/stream") == streams);
+}
+
+// Info and stream on one connection, the next poll on the same one, one
+// resolver call for all of it; a connection the server closed while
+// parked costs one reconnect
+static void testKeepAlive(void)
+{
+  FrameUpdate u;
+  FrameUpdate_Init(&u, "localhost", server.port);
+  std::string hash = server.publish(200);
+  server.closeConnections();
+  int accepted = server.accepted;
+
+  NET_Stream_ResetConnStats();
+  CHECK(pollAndShow(&u));
+  checkPanel(hash);
+  CHECK(!pollAndShow(&u));
+  NET_Stream_ConnStats conn = NET_Stream_GetConnStats();
+  printf("   2 polls: %" PRIu32 " requests, %" PRIu32 " connect(s), %" PRIu32 " reused, "
+         "%" PRIu32 " DNS lookup(s), %" PRIu32 " ms connecting, %" PRIu32 " ms to first byte\n",
+         conn.requests, conn.connects, conn.reused, conn.dns_lookups, conn.connect_ms, conn.ttfb_ms);
+  CHECK(conn.requests == 3);
+  CHECK(conn.connects == 1);
+  CHECK(conn.reused == 2);
+  CHECK(conn.dns_lookups <= 1);
+  CHECK(server.accepted == accepted + 1);
+
+  server.closeConnections();
+  NET_Stream_ResetConnStats();
+  CHECK(!pollAndShow(&u));
+  conn = NET_Stream_GetConnStats();
+  CHECK(conn.stale == 1);
+  CHECK(conn.connects == 1);
+  CHECK(conn.dns_lookups == 0);
+}
+
+// Conditional polls: the stream request carries If-None-Match, so a new
+// frame costs one request and an unchanged one a bodiless 304
+static void testConditional(void)
+{
+  FrameUpdate u;
+  FrameUpdate_Init(&u, "127.0.0.1", server.port);
+  u.conditional = true;
+  std::string hash = server.publish(210);
+  int info = server.count("/api/image/info");
+  int stream = server.count("/api/image/stream");
+
+  startPanel();
+  UDOUBLE start = DEV_Time_ms();
+  FrameUpdate_BeginConditional(&u);
+  CHECK(FrameUpdate_Show(&u));
+  UDOUBLE changed_ms = DEV_Time_ms() - start;
+  checkPanel(hash);
+  CHECK(hash == u.last_hash);
+
+  startPanel();
+  start = DEV_Time_ms();
+  FrameUpdate_BeginConditional(&u);
+  CHECK(!FrameUpdate_Show(&u));
+  UDOUBLE unchanged_ms = DEV_Time_ms() - start;
+  CHECK(DEV_Host_GetController(0)->dtm_bytes == 0);
+  CHECK(DEV_Host_GetController(0)->refreshes == 0);
+
+  CHECK(server.not_modified == 1);
+  CHECK(server.count("/api/image/info") == info);
+  CHECK(server.count("/api/image/stream") == stream + 2);
+  printf("   conditional: new frame on screen in %" PRIu32 " ms (refresh included), "
+         "304 in %" PRIu32 " ms\n", changed_ms, unchanged_ms);
+}
+
+static long msSince(std::chrono::steady_clock::time_point start)
+{
+  return (long)std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - start).count();
+}
+
+// Long poll: the info request is held until the frame changes, so news
+// arrives within a round trip of its publication, and an idle server
+// answers once per wait
+static void testLongPoll(void)
+{
+  FrameUpdate u;
+  FrameUpdate_Init(&u, "127.0.0.1", server.port);
+  std::string before = server.publish(230);
+  CHECK(pollAndShow(&u));
+
+  std::string after;
+  std::thread publisher([&]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    after = server.publish(231);
+  });
+  startPanel();
+  auto start = std::chrono::steady_clock::now();
+  CHECK(FrameUpdate_Check(&u, 5));
+  long news_ms = msSince(start);
+  publisher.join();
+  CHECK(after == u.pending_hash);
+  CHECK(news_ms >= 300 && news_ms < 1500);
+  CHECK(server.last("/api/image/info").find("known=" + before) != std::string::npos);
+  CHECK(FrameUpdate_Show(&u));
+  checkPanel(after);
+
+  // Nothing new: held for the whole wait, then asked again right away
+  server.info_extra = ", \"poll_interval\": 0";
+  start = std::chrono::steady_clock::now();
+  CHECK(!FrameUpdate_Check(&u, 2));
+  long held_ms = msSince(start);
+  CHECK(held_ms >= 2000);
+  CHECK(u.next_poll_s == 0);
+  printf("   long poll: news %ld ms after publication, idle answer held %ld ms "
+         "(%ld requests per hour)\n", news_ms, held_ms, 3600000 / held_ms);
+  server.info_extra = "";
+}
+
+// With a playlist the frame on screen is an entry, not the server's current
+// frame; the long poll still names the latter, so it is held rather than
+// answered at once (which would pin the cadence to the floor)
+static void testLongPollPlaylist(void)
+{
+  FrameUpdate u;
+  FrameUpdate_Init(&u, "127.0.0.1", server.port);
+  useStore();
+  std::string list[2];
+  for (int i = 0; i < 2; i++) list[i] = server.publish(240 + i);
+  server.info_extra = ", \"playlist\": \"" + list[0] + "," + list[1] +
+                      "\", \"playlist_interval\": 3600, \"poll_interval\": 0";
+  CHECK(pollAndShow(&u));
+  checkPanel(list[0]);
+
+  auto start = std::chrono::steady_clock::now();
+  CHECK(!FrameUpdate_Check(&u, 2));
+  long held_ms = msSince(start);
+  CHECK(server.last("/api/image/info").find("known=" + list[1]) != std::string::npos);
+  CHECK(held_ms >= 2000);
+  CHECK(u.next_poll_s == 0);
+  CHECK(list[0] == u.last_hash);
+  server.info_extra = "";
+}
+
+int main(void)
+{
+  int fd = mkstemp(flash_path);
+  CHECK(fd >= 0);
+  close(fd);
+  unlink(flash_path);
+  CHECK(server.start());
+
+  RUN(testDirectToPanel());
+  RUN(testRawThroughput());
+  RUN(testThrottledServer());
+  RUN(testRangeResume());
+  RUN(testResumeWithoutRange());
+  RUN(testResumeBudget());
+  RUN(testThroughStore());
+  RUN(testDelta());
+  RUN(testPlaylist());
+  RUN(testPrefetchPlaylist());
+  RUN(testPrefetchNext());
+  RUN(testKeepAlive());
+  RUN(testConditional());
+  RUN(testLongPoll());
+  RUN(testLongPollPlaylist());
+
+  server.stop();
+  DEV_Host_DetachFlash();
+  unlink(flash_path);
+  return Test_Result();
+}
@@ -0,0 +1,143 @@
+/**
+ * ImageInfo: a full response fed in every chunk size, quoted and bare
+ * values, both playlist forms, skipped containers and malformed bodies.
+ */
+
+#include "Test.h"
+#include "ImageInfo.h"
+#include <stdio.h>
+#include <string.h>
+
+static const char response[] =
+  "{\"hash\": \"0123456789abcdef0123456789abcdef\", \"crc32\": \"1a2B3c4D\",\n"
+  " \"codecs\": \"rowop, packed3\", \"meta\": {\"a\": [1, {\"b\": \"}]\"}], \"c\": \"\\\"\"},\n"
+  " \"playlist\": \"aaaa1111, bbbb2222,cccc3333\", \"playlist_interval\": 300,\n"
+  " \"poll_interval\": \"0\", \"size\": 960000, \"note\": \"tab\\there\", \"ok\": true}";
+
+static bool parse(const char *body, size_t chunk, ImageInfo *info)
+{
+  ImageInfo_Parser parser;
+  ImageInfo_Begin(&parser, info);
+  size_t len = strlen(body);
+  for (size_t at = 0; at < len; at += chunk) {
+    size_t n = len - at < chunk ? len - at : chunk;
+    if (!ImageInfo_Feed(&parser, body + at, n)) return false;
+  }
+  return ImageInfo_End(&parser) && parser.bytes == len;
+}
+
+// The tokenizer carries its state across any split of the body
+static void testChunking(void)
+{
+  for (size_t chunk = 1; chunk <= sizeof(response); chunk++) {
+    ImageInfo info;
+    CHECK(parse(response, chunk, &info));
+    CHECK(strcmp(info.hash, "0123456789abcdef0123456789abcdef") == 0);
+    CHECK(strcmp(info.crc32, "1a2B3c4D") == 0);
+    CHECK(strcmp(info.codecs, "rowop, packed3") == 0);
+    CHECK(info.playlist_len == 3);
+    CHECK(strcmp(info.playlist[0], "aaaa1111") == 0);
+    CHECK(strcmp(info.playlist[2], "cccc3333") == 0);
+    CHECK(info.playlist_interval == 300);
+    CHECK(info.poll_interval == 0);
+    CHECK(info.size == 960000);
+  }
+}
+
+// Bare values only count for numeric fields
+static void testBareValues(void)
+{
+  ImageInfo info;
+  CHECK(parse("{\"hash\": null, \"crc32\": 12345678, \"codecs\": false, \"playlist\": null,"
+              " \"poll_interval\": 30, \"size\": \"960000\"}", 7, &info));
+  CHECK(info.hash[0] == '\0');
+  CHECK(info.crc32[0] == '\0');
+  CHECK(info.codecs[0] == '\0');
+  CHECK(info.playlist_len == 0);
+  CHECK(info.poll_interval == 30);
+  CHECK(info.size == 960000);
+
+  CHECK(parse("{\"poll_interval\": null, \"size\": -5}", 3, &info));
+  CHECK(info.poll_interval == -1);
+  CHECK(info.size == -1);
+  CHECK(info.playlist_interval == -1);
+}
+
+// The array form of the playlist: string entries in order, bare ones and
+// nested containers skipped, the rest of the object still parsed
+static void testPlaylistArray(void)
+{
+  static const char body[] =
+    "{\"playlist\": [\"aaaa1111\", 42, \"bb\\\"bb\", null, {\"x\": [\"zz\"]}, [\"yy\"],\n"
+    " \"0123456789abcdef0123456789abcdef0123\", -7.5e3, true, \"cccc3333\"],\n"
+    " \"hash\": \"dddd4444\", \"playlist_interval\": 60}";
+  for (size_t chunk = 1; chunk <= sizeof(body); chunk++) {
+    ImageInfo info;
+    CHECK(parse(body, chunk, &info));
+    CHECK(info.playlist_len == 3);
+    CHECK(strcmp(info.playlist[0], "aaaa1111") == 0);
+    CHECK(strcmp(info.playlist[1], "bb\"bb") == 0);
+    CHECK(strcmp(info.playlist[2], "cccc3333") == 0);
+    CHECK(strcmp(info.hash, "dddd4444") == 0);
+    CHECK(info.playlist_interval == 60);
+  }
+
+  // Numbers only, an empty array, and the string form after all
+  ImageInfo info;
+  CHECK(parse("{\"playlist\": [1, 2, 3], \"size\": 5}", 2, &info));
+  CHECK(info.playlist_len == 0);
+  CHECK(info.size == 5);
+  CHECK(parse("{\"playlist\": []}", 1, &info));
+  CHECK(info.playlist_len == 0);
+  CHECK(parse("{\"playlist\": \" aaaa1111,,bbbb2222 \"}", 3, &info));
+  CHECK(info.playlist_len == 2);
+  CHECK(strcmp(info.playlist[1], "bbbb2222") == 0);
+
+  // More entries than fit: the first ones are kept
+  char many[512] = "{\"playlist\": [";
+  for (int i = 0; i < IMAGE_INFO_PLAYLIST_MAX + 3; i++) {
+    snprintf(many + strlen(many), sizeof(many) - strlen(many), "%s\"e%d\"", i ? ", " : "", i);
+  }
+  strcat(many, "]}");
+  CHECK(parse(many, 4, &info));
+  CHECK(info.playlist_len == IMAGE_INFO_PLAYLIST_MAX);
+  CHECK(strcmp(info.playlist[IMAGE_INFO_PLAYLIST_MAX - 1], "e7") == 0);
+}
+
+// Overlong values are cut, not overflowed; an overlong crc32 stays
+// recognisably too long for FrameCheck to reject
+static void testLongValues(void)
+{
+  ImageInfo info;
+  CHECK(parse("{\"hash\": \"0123456789abcdef0123456789abcdef0123\", \"crc32\": \"123456789\","
+              " \"a_key_well_past_the_key_limit\": \"x\"}", 5, &info));
+  CHECK(strlen(info.hash) == IMAGE_INFO_HASH_MAX - 1);
+  CHECK(strcmp(info.crc32, "123456789") == 0);
+}
+
+static void testMalformed(void)
+{
+  static const char *bad[] = {
+    "[1, 2]",
+    "{\"playlist\": [\"x\"}",
+    "{\"hash\" \"x\"}",
+    "{\"hash\": \"x\",}x",
+    "{\"hash\": \"x\"} trailing",
+    "{\"hash\": \"x\"",
+    "",
+  };
+  ImageInfo info;
+  for (const char *body : bad) {
+    for (size_t chunk = 1; chunk < 4; chunk++) CHECK(!parse(body, chunk, &info));
+  }
+}
+
+int main(void)
+{
+  RUN(testChunking());
+  RUN(testBareValues());
+  RUN(testPlaylistArray());
+  RUN(testLongValues());
+  RUN(testMalformed());
+  return Test_Result();
+}
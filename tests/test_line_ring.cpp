@@ -0,0 +1,140 @@
+/**
+ * LineRing: wrap handling, stall accounting and a two-thread stream
+ * checked byte for byte.
+ */
+
+#include "Test.h"
+#include "LineRing.h"
+#include <thread>
+
+#define RECORD  8
+#define RECORDS 4
+
+// Bytes of a counting sequence, the same on both sides
+static UBYTE seqByte(UDOUBLE i)
+{
+  return (UBYTE)(i * 7 + (i >> 9));
+}
+
+// Odd-sized writes walk the write position across the wrap point; the
+// producer never gets a span that runs past the end of the buffer
+static void testWrap(void)
+{
+  LineRing ring;
+  CHECK(LineRing_Init(&ring, RECORDS, RECORD));
+  UDOUBLE produced = 0, consumed = 0;
+
+  for (int round = 0; round < 200; round++) {
+    UDOUBLE len = 1 + round % 11;
+    UBYTE *dst = LineRing_WritePtr(&ring, &len);
+    CHECK(dst + len <= ring.buf + ring.size);
+    for (UDOUBLE i = 0; i < len; i++) dst[i] = seqByte(produced + i);
+    LineRing_Produce(&ring, len);
+    produced += len;
+
+    const UBYTE *record;
+    while ((record = LineRing_Peek(&ring)) != NULL) {
+      for (int i = 0; i < RECORD; i++) CHECK(record[i] == seqByte(consumed + i));
+      LineRing_Consume(&ring);
+      consumed += RECORD;
+    }
+  }
+  CHECK(produced - consumed < RECORD);
+  CHECK(ring.high_water <= ring.size);
+  LineRing_Free(&ring);
+}
+
+// A wait is one stall however many times the side polls during it
+static void testStallCounting(void)
+{
+  LineRing ring;
+  CHECK(LineRing_Init(&ring, RECORDS, RECORD));
+
+  for (int i = 0; i < 3; i++) CHECK(LineRing_Peek(&ring) == NULL);
+  CHECK(ring.consumer_stalls == 1);
+
+  for (int r = 0; r < RECORDS; r++) {
+    UDOUBLE len = RECORD;
+    LineRing_WritePtr(&ring, &len);
+    LineRing_Produce(&ring, len);
+  }
+  for (int i = 0; i < 3; i++) {
+    UDOUBLE len = RECORD;
+    LineRing_WritePtr(&ring, &len);
+    CHECK(len == 0);
+  }
+  CHECK(ring.producer_stalls == 1);
+
+  CHECK(LineRing_Peek(&ring) != NULL);
+  LineRing_Consume(&ring);
+  UDOUBLE len = RECORD;
+  LineRing_WritePtr(&ring, &len);
+  CHECK(len == RECORD);
+  LineRing_Produce(&ring, len);
+  len = RECORD;
+  LineRing_WritePtr(&ring, &len);
+  CHECK(ring.producer_stalls == 2);
+
+  for (int r = 0; r < RECORDS; r++) {
+    CHECK(LineRing_Peek(&ring) != NULL);
+    LineRing_Consume(&ring);
+  }
+  CHECK(LineRing_Peek(&ring) == NULL);
+  CHECK(LineRing_Peek(&ring) == NULL);
+  CHECK(ring.consumer_stalls == 2);
+  LineRing_Free(&ring);
+}
+
+// Producer and consumer on their own threads, as on the two cores
+static void testThreads(void)
+{
+  const UDOUBLE total = 300 * 14000;  // Whole records
+  LineRing ring;
+  CHECK(LineRing_Init(&ring, 16, 300));
+
+  std::thread producer([&ring, total]() {
+    UDOUBLE produced = 0;
+    unsigned chunk = 1;
+    while (produced < total) {
+      chunk = chunk * 1103515245u + 12345u;
+      UDOUBLE len = 1 + (chunk >> 16) % 1460;
+      if (len > total - produced) len = total - produced;
+      UBYTE *dst = LineRing_WritePtr(&ring, &len);
+      if (len == 0) {
+        std::this_thread::yield();
+        continue;
+      }
+      for (UDOUBLE i = 0; i < len; i++) dst[i] = seqByte(produced + i);
+      LineRing_Produce(&ring, len);
+      produced += len;
+    }
+  });
+
+  UDOUBLE consumed = 0;
+  int mismatches = 0;
+  while (consumed < total) {
+    const UBYTE *record = LineRing_Peek(&ring);
+    if (!record) {
+      std::this_thread::yield();
+      continue;
+    }
+    for (UDOUBLE i = 0; i < ring.record; i++) {
+      if (record[i] != seqByte(consumed + i)) mismatches++;
+    }
+    LineRing_Consume(&ring);
+    consumed += ring.record;
+  }
+  producer.join();
+
+  CHECK(mismatches == 0);
+  CHECK(ring.high_water <= ring.size);
+  LineRing_Free(&ring);
+}
+
+int main(void)
+{
+  RUN(testWrap());
+  RUN(testStallCounting());
+  RUN(testThreads());
+  return Test_Result();
+}
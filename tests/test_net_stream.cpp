@@ -0,0 +1,280 @@
+/**
+ * NET_Stream against a loopback HTTP server: header parsing and residue,
+ * connection reuse, Range resumes, held responses, the connect timeout and
+ * an abort from another thread.
+ */
+
+#include "Test.h"
+#include "DEV_Host.h"
+#include "NET_Stream.h"
+#include "lwip/sockets.h"
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+
+#define BODY_BYTES  5000
+
+static UBYTE body[BODY_BYTES];
+
+// One listening socket served by a thread; every response carries `body`
+// (from the Range offset on, unless ignore_range is set)
+struct TestServer {
+  int fd = -1;
+  uint16_t port = 0;
+  std::atomic<bool> ignore_range{false};
+  std::atomic<int> hold_ms{0};     // Delay before each response (long poll)
+  std::atomic<int> accepted{0};
+  std::atomic<int> conn{-1};       // Connection being served
+  std::thread thread;
+
+  bool start() {
+    fd = socket(AF_INET, SOCK_STREAM, 0);
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(addr);
+    if (bind(fd, (struct sockaddr *)&addr, len) != 0 || listen(fd, 4) != 0) return false;
+    getsockname(fd, (struct sockaddr *)&addr, &len);
+    port = ntohs(addr.sin_port);
+    thread = std::thread([this]() { run(); });
+    return true;
+  }
+
+  // Also ends a connection the client keeps parked
+  void stop() {
+    int c = conn.load();
+    if (c >= 0) shutdown(c, SHUT_RDWR);
+    shutdown(fd, SHUT_RDWR);
+    close(fd);
+    thread.join();
+  }
+
+  void run() {
+    for (;;) {
+      int c = accept(fd, NULL, NULL);
+      if (c < 0) return;
+      accepted++;
+      conn = c;
+      serve(c);
+      conn = -1;
+      close(c);
+    }
+  }
+
+  // Requests on one connection until the client closes it
+  void serve(int c) {
+    std::string request;
+    char buf[512];
+    for (;;) {
+      size_t end;
+      while ((end = request.find("\r\n\r\n")) == std::string::npos) {
+        int n = recv(c, buf, sizeof(buf), 0);
+        if (n <= 0) return;
+        request.append(buf, n);
+      }
+      std::string head = request.substr(0, end);
+      request.erase(0, end + 4);
+      if (hold_ms > 0) std::this_thread::sleep_for(std::chrono::milliseconds(hold_ms.load()));
+
+      unsigned long offset = 0;
+      size_t range = head.find("Range: bytes=");
+      if (range != std::string::npos && !ignore_range) {
+        offset = strtoul(head.c_str() + range + 13, NULL, 10);
+      }
+      char header[256];
+      int len;
+      if (offset > 0) {
+        len = snprintf(header, sizeof(header),
+                       "HTTP/1.1 206 Partial Content\r\nContent-Length: %lu\r\n"
+                       "Content-Range: bytes %lu-%d/%d\r\nConnection: keep-alive\r\n\r\n",
+                       BODY_BYTES - offset, offset, BODY_BYTES - 1, BODY_BYTES);
+      } else {
+        len = snprintf(header, sizeof(header),
+                       "HTTP/1.1 200 OK\r\nContent-Length: %d\r\nConnection: keep-alive\r\n\r\n",
+                       BODY_BYTES);
+      }
+      // Header and the first body bytes in one segment, as servers usually send them
+      std::string response(header, len);
+      response.append((const char *)body + offset, BODY_BYTES - offset);
+      if (send(c, response.data(), response.size(), MSG_NOSIGNAL) != (ssize_t)response.size()) return;
+    }
+  }
+};
+
+static bool readBody(NET_Stream *s, UBYTE *dst, UDOUBLE len)
+{
+  return NET_Stream_ReadFully(s, dst, len) && NET_Stream_Read(s, dst, 1) == 0;
+}
+
+static void testOpenAndReuse(TestServer *server)
+{
+  static UBYTE got[BODY_BYTES];
+  NET_Stream net;
+
+  NET_Stream_ResetStats();
+  NET_Stream_ResetConnStats();
+  DEV_Host_Reset();
+  CHECK(NET_Stream_Open(&net, "127.0.0.1", server->port, "/api/image/stream", NULL, 2000));
+  CHECK(net.status == 200);
+  CHECK(net.content_length == BODY_BYTES);
+  CHECK(net.keep_alive);
+  CHECK(readBody(&net, got, BODY_BYTES));
+  CHECK(memcmp(got, body, BODY_BYTES) == 0);
+  NET_Stream_Close(&net);
+
+  // The resolver call is bracketed by watchdog feeds
+  CHECK(DEV_Host_GetWatchdog().feeds >= 2);
+  NET_Stream_Stats stats = NET_Stream_GetStats();
+  CHECK(stats.bytes == BODY_BYTES);
+  CHECK(stats.residue_bytes > 0);
+
+  // Parked connection picked up again, no second lookup
+  memset(got, 0, sizeof(got));
+  CHECK(NET_Stream_Open(&net, "127.0.0.1", server->port, "/api/image/info", NULL, 2000));
+  CHECK(readBody(&net, got, BODY_BYTES));
+  CHECK(memcmp(got, body, BODY_BYTES) == 0);
+  NET_Stream_Close(&net);
+
+  NET_Stream_ConnStats conn = NET_Stream_GetConnStats();
+  CHECK(conn.requests == 2);
+  CHECK(conn.connects == 1);
+  CHECK(conn.reused == 1);
+  CHECK(conn.dns_lookups == 1);
+  CHECK(server->accepted == 1);
+}
+
+// 206 from the offset, or the whole body with the head dropped locally
+static void testRange(TestServer *server)
+{
+  static const UDOUBLE offsets[] = {1, 1000, BODY_BYTES - 1};
+  static UBYTE got[BODY_BYTES];
+
+  for (int ignore = 0; ignore < 2; ignore++) {
+    server->ignore_range = ignore != 0;
+    for (UDOUBLE offset : offsets) {
+      NET_Stream net;
+      NET_Stream_ResetStats();
+      CHECK(NET_Stream_OpenAt(&net, "127.0.0.1", server->port, "/s", NULL, offset, 2000));
+      CHECK(net.status == 206);
+      CHECK(readBody(&net, got, BODY_BYTES - offset));
+      CHECK(memcmp(got, body + offset, BODY_BYTES - offset) == 0);
+      CHECK(NET_Stream_GetStats().skipped_bytes == (ignore ? offset : 0));
+      NET_Stream_Close(&net);
+    }
+  }
+  server->ignore_range = false;
+}
+
+// A response held over several receive slices: the watchdog is fed in
+// between, and the request timeout still holds across the slices
+static void testHeldResponse(TestServer *server)
+{
+  static UBYTE got[BODY_BYTES];
+  NET_Stream net;
+
+  server->hold_ms = 5 * NET_RECV_SLICE_MS;
+  DEV_Host_Reset();
+  CHECK(NET_Stream_Open(&net, "127.0.0.1", server->port, "/api/image/info?wait=25", NULL,
+                        10 * NET_RECV_SLICE_MS));
+  CHECK(readBody(&net, got, BODY_BYTES));
+  NET_Stream_Close(&net);
+  DEV_Host_Watchdog wdt = DEV_Host_GetWatchdog();
+  CHECK(wdt.feeds >= 4);
+  CHECK(wdt.max_gap_ms < 2 * NET_RECV_SLICE_MS);
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  CHECK(!NET_Stream_Open(&net, "127.0.0.1", server->port, "/api/image/info?wait=25", NULL,
+                         3 * NET_RECV_SLICE_MS));
+  long elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - start).count();
+  CHECK(elapsed_ms >= 3 * NET_RECV_SLICE_MS - 50 && elapsed_ms < 5 * NET_RECV_SLICE_MS);
+  server->hold_ms = 0;
+}
+
+// A server whose accept backlog is full never completes the handshake:
+// Open must give up after the request timeout instead of blocking
+static void testConnectTimeout(void)
+{
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  struct sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  socklen_t len = sizeof(addr);
+  CHECK(bind(fd, (struct sockaddr *)&addr, len) == 0 && listen(fd, 0) == 0);
+  getsockname(fd, (struct sockaddr *)&addr, &len);
+
+  // Fill the backlog; nobody ever accepts
+  int filler = socket(AF_INET, SOCK_STREAM, 0);
+  CHECK(connect(filler, (struct sockaddr *)&addr, sizeof(addr)) == 0);
+
+  NET_Stream net;
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  bool opened = NET_Stream_Open(&net, "127.0.0.1", ntohs(addr.sin_port), "/", NULL, 1000);
+  long elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - start).count();
+  CHECK(!opened);
+  CHECK(elapsed_ms >= 900 && elapsed_ms < 3000);
+  if (opened) NET_Stream_Close(&net);
+
+  close(filler);
+  close(fd);
+}
+
+// Abort from another thread ends a blocked request within a slice; only a
+// flag is set, so a socket that took over the descriptor is left alone
+static void testAbort(TestServer *server)
+{
+  static UBYTE got[BODY_BYTES];
+  NET_Stream net;
+
+  server->hold_ms = 6 * NET_RECV_SLICE_MS;
+  std::atomic<bool> opened{true};
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  std::thread reader([&]() {
+    opened = NET_Stream_Open(&net, "127.0.0.1", server->port, "/api/image/stream", NULL,
+                             20 * NET_RECV_SLICE_MS);
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(NET_RECV_SLICE_MS / 2));
+  NET_Stream_Abort(&net);
+  reader.join();
+  long elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - start).count();
+  CHECK(!opened);
+  CHECK(elapsed_ms < 2 * NET_RECV_SLICE_MS);
+  NET_Stream_Close(&net);
+  server->hold_ms = 0;
+
+  // The descriptor is free again and likely handed to the next socket
+  NET_Stream other;
+  CHECK(NET_Stream_Open(&other, "127.0.0.1", server->port, "/api/image/stream", NULL, 20 * NET_RECV_SLICE_MS));
+  NET_Stream_Abort(&net);
+  CHECK(readBody(&other, got, BODY_BYTES));
+  CHECK(memcmp(got, body, BODY_BYTES) == 0);
+  NET_Stream_Close(&other);
+
+  // An aborted stream stays aborted: a resume does not even connect
+  int accepted = server->accepted;
+  CHECK(!NET_Stream_OpenAt(&net, "127.0.0.1", server->port, "/api/image/stream", NULL, 100, 2000));
+  CHECK(server->accepted == accepted);
+}
+
+int main(void)
+{
+  for (int i = 0; i < BODY_BYTES; i++) body[i] = (UBYTE)(i * 31 + (i >> 8));
+
+  TestServer server;
+  if (!server.start()) {
+    fprintf(stderr, "loopback server failed\n");
+    return 1;
+  }
+  RUN(testOpenAndReuse(&server));
+  RUN(testRange(&server));
+  RUN(testHeldResponse(&server));
+  RUN(testConnectTimeout());
+  RUN(testAbort(&server));
+  server.stop();
+  return Test_Result();
+}
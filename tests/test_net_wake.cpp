@@ -0,0 +1,133 @@
+/**
+ * NET_Wake over loopback UDP: a signed notice accepted, forged and
+ * malformed ones dropped, and an accepted counter never taken again, in
+ * the same boot, after deep sleep or after a power loss.
+ */
+
+#include "Test.h"
+#include "DEV_Host.h"
+#include "NET_Wake.h"
+#include "lwip/sockets.h"
+#include "mbedtls/md.h"
+#include <string.h>
+#include <vector>
+
+#define KEY       "change-me"
+#define WAIT_MS   300
+
+typedef std::vector<UBYTE> Datagram;
+
+static uint16_t wake_port;
+
+static void putField(Datagram *d, const char *s)
+{
+  d->push_back((UBYTE)strlen(s));
+  d->insert(d->end(), s, s + strlen(s));
+}
+
+// Notice as the README's sender builds it
+static Datagram makeNotice(UDOUBLE counter, const char *hash, const char *path = "",
+                           const char *key = KEY)
+{
+  Datagram d = {'E', 'P', 'D', 'W', NET_WAKE_VERSION};
+  for (int i = 0; i < 4; i++) d.push_back((UBYTE)(counter >> (8 * i)));
+  putField(&d, hash);
+  putField(&d, path);
+  UBYTE mac[32];
+  mbedtls_md_hmac(mbedtls_md_info_from_type(MBEDTLS_MD_SHA256), (const UBYTE *)key, strlen(key),
+                  d.data(), d.size(), mac);
+  d.insert(d.end(), mac, mac + NET_WAKE_MAC_BYTES);
+  return d;
+}
+
+// Send d and wait for what the listener makes of it
+static bool receive(const Datagram &d, NET_Wake_Notice *notice)
+{
+  int fd = socket(AF_INET, SOCK_DGRAM, 0);
+  struct sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(wake_port);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  sendto(fd, d.data(), d.size(), 0, (struct sockaddr *)&addr, sizeof(addr));
+  close(fd);
+  return NET_Wake_Wait(WAIT_MS, notice);
+}
+
+// A port nobody listens on
+static uint16_t freePort(void)
+{
+  int fd = socket(AF_INET, SOCK_DGRAM, 0);
+  struct sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  socklen_t len = sizeof(addr);
+  bind(fd, (struct sockaddr *)&addr, len);
+  getsockname(fd, (struct sockaddr *)&addr, &len);
+  close(fd);
+  return ntohs(addr.sin_port);
+}
+
+static void testAccept(void)
+{
+  NET_Wake_Notice notice;
+  CHECK(!NET_Wake_Begin(wake_port, ""));
+  CHECK(NET_Wake_Begin(wake_port, KEY));
+  CHECK(NET_Wake_Active());
+  CHECK(receive(makeNotice(100, "abc123def456", "/api/image/stream?hash=abc123def456"), &notice));
+  CHECK(notice.counter == 100);
+  CHECK(strcmp(notice.hash, "abc123def456") == 0);
+  CHECK(strcmp(notice.path, "/api/image/stream?hash=abc123def456") == 0);
+  CHECK(NET_Wake_Rejected() == 0);
+}
+
+// Nothing in an unauthenticated or malformed datagram is taken, and a
+// rejected counter is not used up
+static void testForged(void)
+{
+  NET_Wake_Notice notice;
+  UDOUBLE rejected = NET_Wake_Rejected();
+  CHECK(!receive(makeNotice(200, "abc123def456", "", "wrong-key"), &notice));
+  Datagram tampered = makeNotice(200, "abc123def456");
+  tampered[10]++;
+  CHECK(!receive(tampered, &notice));
+  CHECK(!receive(makeNotice(200, "abc123def456", "api/image/stream"), &notice));
+  CHECK(!receive(makeNotice(200, ""), &notice));
+  Datagram truncated = makeNotice(200, "abc123def456");
+  truncated.resize(12);
+  CHECK(!receive(truncated, &notice));
+  CHECK(NET_Wake_Rejected() == rejected + 5);
+  CHECK(receive(makeNotice(101, "abc123def456"), &notice));
+}
+
+// A captured notice, resent at once or later, and older counters
+static void testReplay(void)
+{
+  NET_Wake_Notice notice;
+  Datagram captured = makeNotice(102, "0123456789abcdef");
+  CHECK(receive(captured, &notice));
+  UDOUBLE rejected = NET_Wake_Rejected();
+  CHECK(!receive(captured, &notice));
+  CHECK(!receive(makeNotice(50, "0123456789abcdef"), &notice));
+  CHECK(NET_Wake_Rejected() == rejected + 2);
+
+  // Deep sleep: RTC memory is kept, the listener bound anew
+  CHECK(NET_Wake_Begin(wake_port, KEY));
+  CHECK(!receive(captured, &notice));
+
+  // Power loss: RTC memory cleared, the counter comes back from NVS
+  DEV_Host_RtcPowerLoss();
+  CHECK(NET_Wake_Begin(wake_port, KEY));
+  CHECK(!receive(captured, &notice));
+  CHECK(NET_Wake_Rejected() == rejected + 4);
+  CHECK(receive(makeNotice(103, "0123456789abcdef"), &notice));
+  CHECK(notice.counter == 103);
+}
+
+int main(void)
+{
+  wake_port = freePort();
+  RUN(testAccept());
+  RUN(testForged());
+  RUN(testReplay());
+  return Test_Result();
+}
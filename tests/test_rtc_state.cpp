@@ -0,0 +1,115 @@
+/**
+ * RtcState: the deep sleep round trip through a copy of RTC memory, the
+ * access point forgotten when no station was joined, cleared and
+ * garbage memory, and overlong strings.
+ */
+
+#include "Test.h"
+#include "RtcState.h"
+#include <string.h>
+
+static const uint8_t BSSID[6] = {0x24, 0x0a, 0xc4, 0x12, 0x34, 0x56};
+
+// What survives deep sleep is the memory, not the struct: restore from a copy
+static RtcState throughRtc(const RtcState &s)
+{
+  UBYTE rtc[sizeof(RtcState)];
+  RtcState woken;
+  memcpy(rtc, &s, sizeof(rtc));
+  memcpy(&woken, rtc, sizeof(woken));
+  return woken;
+}
+
+static void testRoundTrip(void)
+{
+  FrameUpdate u;
+  FrameUpdate_Init(&u, "unused", 0);
+  strcpy(u.last_hash, "0123456789abcdef0123456789abcdef");
+  strcpy(u.server_hash, "fedcba9876543210fedcba9876543210");
+  u.next_poll_s = 0;
+  u.info_requests = 1234;
+
+  RtcState s;
+  memset(&s, 0xA5, sizeof(s));
+  RtcState_Save(&s, &u, "frames.example.org", "8443");
+  RtcState_SetAccessPoint(&s, BSSID, 11);
+  s.clock_s = 86400;
+  RtcState woken = throughRtc(s);
+
+  FrameUpdate restored;
+  FrameUpdate_Init(&restored, "unused", 0);
+  char host[48], port[8];
+  CHECK(RtcState_Restore(&woken, &restored, host, sizeof(host), port, sizeof(port)));
+  CHECK(strcmp(restored.last_hash, u.last_hash) == 0);
+  CHECK(strcmp(restored.server_hash, u.server_hash) == 0);
+  CHECK(strcmp(host, "frames.example.org") == 0);
+  CHECK(strcmp(port, "8443") == 0);
+  CHECK(restored.next_poll_s == 0);
+  CHECK(restored.info_requests == 1234);
+  CHECK(woken.clock_s == 86400);
+  CHECK(RtcState_HasAccessPoint(&woken));
+  CHECK(memcmp(woken.wifi_bssid, BSSID, sizeof(BSSID)) == 0);
+  CHECK(woken.wifi_channel == 11);
+}
+
+// A cycle that ends without a joined station (BSSID() is NULL) must not
+// keep, or read, an access point: the next wake scans instead
+static void testNoAccessPoint(void)
+{
+  FrameUpdate u;
+  FrameUpdate_Init(&u, "unused", 0);
+  RtcState s;
+  memset(&s, 0, sizeof(s));
+  RtcState_Save(&s, &u, "host", "80");
+  RtcState_SetAccessPoint(&s, BSSID, 6);
+  CHECK(RtcState_HasAccessPoint(&s));
+  RtcState_SetAccessPoint(&s, NULL, 6);
+  CHECK(!RtcState_HasAccessPoint(&s));
+  CHECK(s.wifi_channel == 0);
+  static const uint8_t zero[6] = {0};
+  CHECK(memcmp(s.wifi_bssid, zero, sizeof(zero)) == 0);
+
+  RtcState_SetAccessPoint(&s, BSSID, 0);
+  CHECK(!RtcState_HasAccessPoint(&s));
+  RtcState_SetAccessPoint(&s, zero, 6);
+  CHECK(!RtcState_HasAccessPoint(&s));
+}
+
+// Cleared memory (power loss) and random memory restore nothing; strings
+// are bounded by the destination even without a terminator
+static void testInvalid(void)
+{
+  FrameUpdate u;
+  FrameUpdate_Init(&u, "unused", 0);
+  strcpy(u.last_hash, "kept");
+  char host[16] = "kept", port[8] = "kept";
+
+  RtcState s;
+  memset(&s, 0, sizeof(s));
+  CHECK(!RtcState_Restore(&s, &u, host, sizeof(host), port, sizeof(port)));
+  memset(&s, 0x5A, sizeof(s));
+  CHECK(!RtcState_Restore(&s, &u, host, sizeof(host), port, sizeof(port)));
+  CHECK(strcmp(u.last_hash, "kept") == 0 && strcmp(host, "kept") == 0);
+
+  s.magic = RTC_STATE_MAGIC;
+  CHECK(RtcState_Restore(&s, &u, host, sizeof(host), port, sizeof(port)));
+  CHECK(strlen(u.last_hash) == sizeof(u.last_hash) - 1);
+  CHECK(strlen(u.server_hash) == sizeof(u.server_hash) - 1);
+  CHECK(strlen(host) == sizeof(host) - 1);
+  CHECK(strlen(port) == sizeof(port) - 1);
+
+  // An overlong host is cut on the way in
+  char name[80];
+  memset(name, 'h', sizeof(name) - 1);
+  name[sizeof(name) - 1] = '\0';
+  RtcState_Save(&s, &u, name, "80");
+  CHECK(strlen(s.server_host) == sizeof(s.server_host) - 1);
+}
+
+int main(void)
+{
+  RUN(testRoundTrip());
+  RUN(testNoAccessPoint());
+  RUN(testInvalid());
+  return Test_Result();
+}
@@ -0,0 +1,95 @@
+/**
+ * Telemetry: batch header, sample clamping, oldest-first order across the
+ * ring wrap, overflow accounting and partial uploads.
+ */
+
+#include "Test.h"
+#include "Telemetry.h"
+#include <string.h>
+
+static UBYTE body[TELEMETRY_BODY_MAX];
+
+static UWORD Get16(const UBYTE *p) { return p[0] | (p[1] << 8); }
+static UDOUBLE Get32(const UBYTE *p) { return Get16(p) | ((UDOUBLE)Get16(p + 2) << 16); }
+
+static Telemetry_Sample Sample(size_t i)
+{
+  Telemetry_Sample s;
+  memcpy(&s, body + TELEMETRY_HEADER + i * sizeof(Telemetry_Sample), sizeof(s));
+  return s;
+}
+
+// Runs first: the ring lives in (host) RTC memory and starts zeroed
+static void testEncode(void)
+{
+  CHECK(Telemetry_Encode(body, sizeof(body)) == TELEMETRY_HEADER);
+  CHECK(memcmp(body, "EPDM", 4) == 0);
+  CHECK(memcmp(body, DEV_TRACE_MAGIC, 4) != 0);
+  CHECK(body[4] == TELEMETRY_VERSION);
+  CHECK(body[5] == 12 && sizeof(Telemetry_Sample) == 12);
+  CHECK(Get16(body + 6) == 0);
+
+  Telemetry_Add(100, 87, -61, 150 * 1024 + 1023, 64 * 1024, TELEMETRY_UPDATE);
+  Telemetry_Add(115, -1, -200, 0, 0, TELEMETRY_POLL);
+  Telemetry_Add(130, 5, 12, 1024, 1024, TELEMETRY_FAILED);
+  CHECK(Telemetry_Count() == 3);
+  CHECK(Telemetry_Encode(body, sizeof(body)) == TELEMETRY_HEADER + 3 * 12);
+  CHECK(Get16(body + 6) == 3);
+  CHECK(Get32(body + 8) == 0);
+  CHECK(Get32(body + 12) == 0);
+
+  Telemetry_Sample s = Sample(0);
+  CHECK(s.time_s == 100 && s.heap_kb == 150 && s.heap_block_kb == 64);
+  CHECK(s.rssi == -61 && s.battery == 87 && s.event == TELEMETRY_UPDATE);
+  s = Sample(1);
+  CHECK(s.rssi == -128 && s.battery == 0xFF && s.event == TELEMETRY_POLL);
+  s = Sample(2);
+  CHECK(s.rssi == 0 && s.battery == 5 && s.heap_kb == 1);
+
+  Telemetry_Uploaded();
+  CHECK(Telemetry_Count() == 0);
+  CHECK(Telemetry_Encode(body, sizeof(body)) == TELEMETRY_HEADER);
+  CHECK(Get32(body + 8) == 1);
+}
+
+// Overflow keeps the newest TELEMETRY_CAPACITY samples, oldest first
+static void testWrap(void)
+{
+  const UDOUBLE extra = 10;
+  for (UDOUBLE t = 0; t < TELEMETRY_CAPACITY + extra; t++) {
+    Telemetry_Add(1000 + t, 50, -70, 0, 0, TELEMETRY_POLL);
+  }
+  CHECK(Telemetry_Count() == TELEMETRY_CAPACITY);
+  CHECK(Telemetry_Encode(body, sizeof(body)) == TELEMETRY_BODY_MAX);
+  CHECK(Get16(body + 6) == TELEMETRY_CAPACITY);
+  CHECK(Get32(body + 12) == extra);
+  for (size_t i = 0; i < TELEMETRY_CAPACITY; i++) {
+    CHECK(Sample(i).time_s == 1000 + extra + i);
+  }
+}
+
+// A short buffer carries the oldest samples; the rest wait for the next batch
+static void testPartial(void)
+{
+  const size_t fit = 5;
+  CHECK(Telemetry_Encode(body, 3) == 0);
+  CHECK(Telemetry_Encode(body, TELEMETRY_HEADER + fit * 12 + 11) == TELEMETRY_HEADER + fit * 12);
+  CHECK(Get16(body + 6) == fit);
+  CHECK(Sample(0).time_s == 1010);
+
+  Telemetry_Uploaded();
+  CHECK(Telemetry_Count() == TELEMETRY_CAPACITY - fit);
+  CHECK(Telemetry_Encode(body, sizeof(body)) == TELEMETRY_HEADER + (TELEMETRY_CAPACITY - fit) * 12);
+  CHECK(Get32(body + 8) == 2);
+  CHECK(Get32(body + 12) == 0);
+  CHECK(Sample(0).time_s == 1010 + fit);
+  CHECK(Sample(TELEMETRY_CAPACITY - fit - 1).time_s == 1010 + TELEMETRY_CAPACITY - 1);
+}
+
+int main(void)
+{
+  RUN(testEncode());
+  RUN(testWrap());
+  RUN(testPartial());
+  return Test_Result();
+}